@@ -8,7 +8,11 @@
 #define ENGINE_NAME L"Crimson"
 #define ENGINE_VERSION L"0.6"
 
+#ifdef _CLIENT
 #define GAME_MODULE "Game.dll"
+#else
+#define GAME_MODULE "GameServer.dll"
+#endif
 #define DEFAULT_MODDIR "Base"
 
 typedef bool ( __cdecl* cfunc )( ModuleImportExport, int, char*[] );
@@ -15,6 +15,15 @@ int inline random( int max )
     return rand() % max;
 }
 
+// for what only changes the looks or sounds, it leaves rand() to the game
+// so the game plays out the same with or without them (demos)
+int inline cosmeticRandom( int max )
+{
+    static unsigned int seed = 1;
+    seed = seed * 1103515245 + 12345;
+    return ( int )( ( seed >> 16 ) & 0x7fff ) % max;
+}
+
 //float inline frand(int precis=4)
 //{
 //  int val=(int)pow(10,precis);
@@ -58,6 +67,28 @@ inline unsigned int getPreciseTime()
 #endif
 }
 
+// microseconds, only differences are meaningful
+inline unsigned int getMicroTime()
+{
+#ifdef WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    if ( !frequency.QuadPart )
+    {
+      QueryPerformanceFrequency( &frequency );
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    // split so counter * 1000000 cannot overflow after a long uptime
+    LONGLONG seconds = counter.QuadPart / frequency.QuadPart;
+    LONGLONG rest = counter.QuadPart % frequency.QuadPart;
+    return ( unsigned int )( seconds * 1000000 + rest * 1000000 / frequency.QuadPart );
+#else
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    return ( unsigned int )( now.tv_sec * 1000000 + now.tv_usec );
+#endif
+}
+
 
 void inline delay( int t )
 {
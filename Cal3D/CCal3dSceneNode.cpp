@@ -22,6 +22,7 @@ CCal3DSceneNode::CCal3DSceneNode( const char* cf, irr::scene::ISceneNode* parent
     bInitialized = false; 
     m_calCoreModel = NULL; 
     m_calModel = NULL; 
+    m_cache = NULL; 
 
     mediaPath = configFile.substr( 0, configFile.find_last_of( "/" ) ); 
 
@@ -83,6 +84,7 @@ void CCal3DSceneNode::UpdateAnimation( float timeStepSec )
       //    } 
       //} 
 
+#ifdef _CLIENT
       m_calModel->update( timeStepSec ); 
 
       CalVector p[8]; 
@@ -92,6 +94,12 @@ void CCal3DSceneNode::UpdateAnimation( float timeStepSec )
       {
         Box.addInternalPoint( p[i].x, p[i].y, p[i].z );
       }
+#else
+      // the bones place weapons and size the collision hulls, the skin, the
+      // springs and the bounding box are only drawn and stay as init() made them
+      m_calModel->getMixer()->updateAnimation( timeStepSec );
+      m_calModel->getMixer()->updateSkeleton();
+#endif
     } 
 
     // update bones from special animation (physic etc.) 
@@ -124,12 +132,6 @@ void CCal3DSceneNode::render()
       driver->setTransform( irr::video::ETS_WORLD, AbsoluteTransformation ); 
 
 
-      irr::video::S3DVertex tmp; 
-      irr::scene::SMeshBuffer mb; 
-
-      unsigned char meshColor[4]; // r g b a 
-
-
       // get the renderer of the model 
       CalRenderer* pCalRenderer; 
       pCalRenderer = m_calModel->getRenderer(); 
@@ -184,12 +186,24 @@ void CCal3DSceneNode::render()
       // begin the rendering loop 
       if ( pCalRenderer->beginRendering() )
       {
+        if ( !m_cache->submeshes.size() )
+        {
+          m_cache->BuildSubmeshes();
+        }
+        SSubmeshInstance blank;
+        blank.faces = blank.facesVertexCount = -1;
+        while ( submeshes.size() < m_cache->submeshes.size() )
+        {
+          submeshes.push_back( blank );
+        }
+
         // get the number of meshes 
         int meshCount; 
         meshCount = pCalRenderer->getMeshCount(); 
 
         // render all meshes of the model 
         int meshId; 
+        u32 index = 0;
         for ( meshId = 0; meshId < meshCount; meshId++ )
         {
           // get the number of submeshes 
@@ -198,102 +212,48 @@ void CCal3DSceneNode::render()
 
           // render all submeshes of the mesh 
           int submeshId; 
-          for ( submeshId = 0; submeshId < submeshCount; submeshId++ )
+          for ( submeshId = 0; ( submeshId < submeshCount ) && ( index < submeshes.size() ); submeshId++, index++ )
           {
             // select mesh and submesh for further data access 
             if ( pCalRenderer->selectMeshSubmesh( meshId, submeshId ) )
             {
-              // set the material ambient color 
-              pCalRenderer->getAmbientColor( &meshColor[0] ); 
-              material.AmbientColor.set( meshColor[3], meshColor[0], meshColor[1], meshColor[2] ); 
-
-              // set the material diffuse color 
-              pCalRenderer->getDiffuseColor( &meshColor[0] ); 
-              material.DiffuseColor.set( meshColor[3], meshColor[0], meshColor[1], meshColor[2] ); 
-
-              // set the material specular color 
-              pCalRenderer->getSpecularColor( &meshColor[0] ); 
-              material.SpecularColor.set( meshColor[3], meshColor[0], meshColor[1], meshColor[2] ); 
-
-              // set the material shininess factor 
-              material.Shininess = pCalRenderer->getShininess(); 
-
-              // get the transformed vertices of the submesh 
-              static float meshVertices[3000][3]; 
-              int vertexCount = 0; 
-              // TODO:
-              //if (KERNEL.GetTicks() % 3 == 0) //- make lod dependent?
-              vertexCount = pCalRenderer->getVertices( &meshVertices[0][0] ); 
-
-              // get the transformed normals of the submesh 
-              static float meshNormals[3000][3]; 
-              int normalsCount = 0;
-              //    if (KERNEL.GetTicks() % 3 == 0)
-              normalsCount = pCalRenderer->getNormals( &meshNormals[0][0] ); 
-
-              // get the texture coordinates of the submesh 
-              static float meshTextureCoordinates[3000][2]; 
-              int textureCoordinateCount = 0; 
-              textureCoordinateCount = pCalRenderer->getTextureCoordinates( 0, &meshTextureCoordinates[0][0] ); 
-
-              // get the faces of the submesh 
-              static CalIndex meshFaces[5000][3]; 
-              int faceCount = 0;
-              //if (KERNEL.GetTicks() % 12 == 0)
-              faceCount = pCalRenderer->getFaces( &meshFaces[0][0] ); 
-
-              if ( ( pCalRenderer->getMapCount() > 0 ) && ( textureCoordinateCount > 0 ) )
+              SCal3DSubmesh& shared = m_cache->submeshes[index];
+              SSubmeshInstance& instance = submeshes[index];
+
+              material.AmbientColor = shared.ambientColor;
+              material.DiffuseColor = shared.diffuseColor;
+              material.SpecularColor = shared.specularColor;
+              material.Shininess = shared.shininess;
+              if ( shared.bTextured )
               {
-                irr::video::ITexture* t = static_cast<irr::video::ITexture*>( pCalRenderer->getMapUserData( 0 ) ); 
-                material.Texture1 = t;
-              } 
+                material.Texture1 = shared.texture;
+              }
 
-              static S3DVertex vs[5000];
-              for ( int i = 0; i < vertexCount; i++ )
+              // the texture coordinates and colors are copied once, only
+              // the positions and normals change
+              if ( instance.vertices.size() != shared.vertices.size() )
               {
-                vs[i].Pos.set( meshVertices[i][0], meshVertices[i][1], meshVertices[i][2] ); 
-                vs[i].Normal.set( meshNormals[i][0], meshNormals[i][1], meshNormals[i][2] ); 
-                vs[i].TCoords.set( meshTextureCoordinates[i][0], meshTextureCoordinates[i][1] ); 
-                vs[i].Color = irr::video::SColor( 255, 255, 255, 255 );
-              } 
-
-              static u16 is[5000];
-              for ( int i = 0; i < faceCount; i += 1 )
+                instance.vertices = shared.vertices;
+              }
+              if ( !instance.vertices.size() )
               {
-                is[i * 3 + 0] = meshFaces[i][0]; 
-                is[i * 3 + 1] = meshFaces[i][1]; 
-                is[i * 3 + 2] = meshFaces[i][2];
-              } 
-
-              //mb.Vertices.clear(); 
-              //mb.Vertices.reallocate(vertexCount);
-              //for(int i=0;i<vertexCount;i++) 
-              //{ 
-              //    tmp.Pos.set(meshVertices[i][0],meshVertices[i][1],meshVertices[i][2]); 
-              //    tmp.Normal.set(meshNormals[i][0],meshNormals[i][1],meshNormals[i][2]); 
-              //    tmp.TCoords.set(meshTextureCoordinates[i][0],meshTextureCoordinates[i][1]); 
-              //    tmp.Color=irr::video::SColor(255,255,255,255); 
-              //    mb.Vertices.push_back(tmp); 
-              //} 
-
-              //mb.Indices.clear(); 
-              //mb.Indices.reallocate(faceCount);
-              //for(int i=0; i<faceCount; ++i)
-              //{ 
-              //    mb.Indices.push_back(meshFaces[i][0]); 
-              //    mb.Indices.push_back(meshFaces[i][1]); 
-              //    mb.Indices.push_back(meshFaces[i][2]); 
-              //} 
+                continue;
+              }
 
-              // draw 
+              int vertexCount = pCalRenderer->getVertexCount();
+              if ( vertexCount != instance.facesVertexCount )
+              {
+                instance.faces = m_cache->GetFaces( index, m_calModel->getMesh( meshId )->getSubmesh( submeshId ) );
+                instance.facesVertexCount = vertexCount;
+              }
+              SCal3DFaces& faces = shared.faces[instance.faces];
 
-              driver->setMaterial( material ); 
-              //driver->drawIndexedTriangleList(mb.Vertices.const_pointer(),mb.Vertices.size(),mb.Indices.const_pointer(),faceCount); 
-              driver->drawIndexedTriangleList( vs, vertexCount, is, faceCount ); 
-              //driver->drawMeshBuffer(&mb); 
+              // get the transformed vertices and normals of the submesh 
+              vertexCount = pCalRenderer->getVerticesAndNormals( &instance.vertices[0].Pos.X, sizeof( S3DVertex ) ); 
 
-              //CONSOLE.addx("#Verts %d #Norm %d #Tex %d #Faces %d #Map %d", 
-              //       vertexCount,normalsCount,textureCoordinateCount,faceCount, pCalRenderer->getMapCount()); 
+              // draw 
+              driver->setMaterial( material ); 
+              driver->drawIndexedTriangleList( instance.vertices.const_pointer(), vertexCount, faces.indices.const_pointer(), faces.faceCount ); 
             }
           }
         } 
@@ -333,6 +293,7 @@ bool CCal3DSceneNode::init()
       if ( cache )
       {
         ///load from cache
+        m_cache = cache;
         m_calCoreModel = cache->m_calCoreModel;
         m_scale = cache->m_scale;
         for ( int i = 0; i < 255; i++ )
@@ -354,6 +315,7 @@ bool CCal3DSceneNode::init()
       ///load from cache
       if ( cache )
       {
+        m_cache = cache;
         m_calCoreModel = cache->m_calCoreModel;
         m_scale = cache->m_scale;
         for ( int i = 0; i < 255; i++ )
@@ -490,6 +452,91 @@ CCal3DModelCache::~CCal3DModelCache()
     delete m_calCoreModel;
 }
 
+void CCal3DModelCache::BuildSubmeshes()
+{
+    submeshes.clear();
+
+    S3DVertex vertex;
+    vertex.Color = irr::video::SColor( 255, 255, 255, 255 );
+
+    for ( int meshId = 0; meshId < m_calCoreModel->getCoreMeshCount(); meshId++ )
+    {
+      CalCoreMesh* pCoreMesh = m_calCoreModel->getCoreMesh( meshId );
+      for ( int submeshId = 0; submeshId < pCoreMesh->getCoreSubmeshCount(); submeshId++ )
+      {
+        CalCoreSubmesh* pCoreSubmesh = pCoreMesh->getCoreSubmesh( submeshId );
+        submeshes.push_back( SCal3DSubmesh() );
+        SCal3DSubmesh& submesh = submeshes.getLast();
+
+        // the instances all use material set 0 
+        CalCoreMaterial* pCoreMaterial = m_calCoreModel->getCoreMaterial( m_calCoreModel->getCoreMaterialId( pCoreSubmesh->getCoreMaterialThreadId(), 0 ) );
+        if ( pCoreMaterial )
+        {
+          CalCoreMaterial::Color& a = pCoreMaterial->getAmbientColor();
+          CalCoreMaterial::Color& d = pCoreMaterial->getDiffuseColor();
+          CalCoreMaterial::Color& s = pCoreMaterial->getSpecularColor();
+          submesh.ambientColor.set( a.alpha, a.red, a.green, a.blue );
+          submesh.diffuseColor.set( d.alpha, d.red, d.green, d.blue );
+          submesh.specularColor.set( s.alpha, s.red, s.green, s.blue );
+          submesh.shininess = pCoreMaterial->getShininess();
+        }
+        else
+        {
+          submesh.ambientColor.set( 255, 255, 255, 255 );
+          submesh.diffuseColor.set( 255, 255, 255, 255 );
+          submesh.specularColor.set( 255, 0, 0, 0 );
+          submesh.shininess = 0.0f;
+        }
+
+        std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& textureCoordinates = pCoreSubmesh->getVectorVectorTextureCoordinate();
+        bool bCoordinates = ( textureCoordinates.size() > 0 ) && ( textureCoordinates[0].size() > 0 );
+
+        submesh.bTextured = pCoreMaterial && ( pCoreMaterial->getMapCount() > 0 ) && bCoordinates;
+        submesh.texture = submesh.bTextured ? static_cast<irr::video::ITexture*>( pCoreMaterial->getMapUserData( 0 ) ) : NULL;
+
+        int vertexCount = pCoreSubmesh->getVertexCount();
+        submesh.vertices.reallocate( vertexCount );
+        for ( int i = 0; i < vertexCount; i++ )
+        {
+          if ( bCoordinates )
+          {
+            vertex.TCoords.set( textureCoordinates[0][i].u, textureCoordinates[0][i].v );
+          }
+          submesh.vertices.push_back( vertex );
+        }
+      }
+    }
+}
+
+s32 CCal3DModelCache::GetFaces( s32 index, CalSubmesh* calSubmesh )
+{
+    SCal3DSubmesh& submesh = submeshes[index];
+
+    // the lod only drops vertices from the end, the vertex count tells them apart 
+    s32 vertexCount = calSubmesh->getVertexCount();
+    for ( u32 i = 0; i < submesh.faces.size(); i++ )
+    {
+      if ( submesh.faces[i].vertexCount == vertexCount )
+      {
+        return i;
+      }
+    }
+
+    submesh.faces.push_back( SCal3DFaces() );
+    SCal3DFaces& faces = submesh.faces.getLast();
+    faces.vertexCount = vertexCount;
+
+    std::vector<CalIndex> calFaces( calSubmesh->getFaceCount() * 3 + 3 );
+    faces.faceCount = calSubmesh->getFaces( &calFaces[0] );
+    faces.indices.reallocate( faces.faceCount * 3 );
+    for ( s32 i = 0; i < faces.faceCount * 3; i++ )
+    {
+      faces.indices.push_back( ( u16 )calFaces[i] );
+    }
+
+    return submesh.faces.size() - 1;
+}
+
 //! load and parse the configuration file 
 //! @param cf, configuration file name 
 //! @return true on success, false otherwise 
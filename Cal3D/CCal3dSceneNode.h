@@ -15,6 +15,28 @@ typedef irr::core::vector3df Vector3;
 
 class CCal3DModelCache;
 
+//! the faces of a submesh at one lod, keyed by the vertices it keeps
+struct SCal3DFaces
+{
+    irr::s32 vertexCount;
+    irr::s32 faceCount;
+    irr::core::array<irr::u16> indices;
+};
+
+//! what animation does not change in a submesh, shared by every instance
+struct SCal3DSubmesh
+{
+    //! texture coordinates and colors set, the positions and normals are left to the instances
+    irr::core::array<irr::video::S3DVertex> vertices;
+    //! the lods the instances were drawn at
+    irr::core::array<SCal3DFaces> faces;
+
+    irr::video::SColor ambientColor, diffuseColor, specularColor;
+    irr::f32 shininess;
+    bool bTextured;
+    irr::video::ITexture* texture;
+};
+
 class CCal3DSceneNode : public irr::scene::ISceneNode
 {
   protected: 
@@ -33,6 +55,18 @@ class CCal3DSceneNode : public irr::scene::ISceneNode
     //! instance model for cal3d 
     CalModel* m_calModel; 
 
+    //! the cache the core model came from 
+    CCal3DModelCache* m_cache; 
+
+    //! the skinned vertices of each submesh, written every draw 
+    struct SSubmeshInstance
+    {
+        irr::core::array<irr::video::S3DVertex> vertices;
+        //! into the shared faces, for the lod drawn last 
+        irr::s32 faces, facesVertexCount;
+    };
+    irr::core::array<SSubmeshInstance> submeshes; 
+
     //! indicate if animation is paused 
     bool m_bPaused; 
 
@@ -159,6 +193,15 @@ class CCal3DModelCache
     float m_scale; 
     int m_animationId[255];
 
+    //! every core mesh's submeshes in order, built on the first draw so 
+    //! the server never has them 
+    irr::core::array<SCal3DSubmesh> submeshes;
+    void BuildSubmeshes();
+
+    //! the faces of submeshes[index] at the lod of calSubmesh, built the 
+    //! first time an instance draws at it 
+    irr::s32 GetFaces( irr::s32 index, CalSubmesh* calSubmesh );
+
     //! load and parse the configuration file 
     //! @param cf, configuration file name 
     //! @return true on success, false otherwise 
@@ -12,17 +12,11 @@ CBeamEffect::CBeamEffect( vector3df OldPos, vector3df NewPos, f32 oneOverMassCon
 {
     Reset();
 
-	this->OldPos = OldPos;
-    this->Pos = NewPos;
-    beam = NULL;
-
-    fFade = 255.0f;
-    interpolator = new CQuadraticTimeInterpolator( fFade, aliveTime, 255.0f, 170.0f, 0.0f );
-
     beam = new CBeamNode( IRR.smgr->getRootSceneNode(), IRR.smgr, -1, APP.useFile( "Sprites/fireball.bmp" ).c_str() ); 
     //beam->setMaterialType(video::EMT_TRANSPARENT_ALPHA_CHANNEL);EMT_TRANSPARENT_VERTEX_ALPHA
     beam->setMaterialType( EMT_TRANSPARENT_ADD_COLOR );
-    beam->SetBeamScale( radiusConst );
+
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CBeamEffect::~CBeamEffect()
@@ -36,6 +30,29 @@ CBeamEffect::~CBeamEffect()
 void CBeamEffect::Reset()
 {
     CEffect::Reset();
+    beam = NULL;
+}
+
+void CBeamEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    CEffect::Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+
+    SetCurve( fFade, 255.0f, 170.0f, 0.0f );
+
+    if ( beam )
+    {
+      beam->SetBeamScale( radiusConst );
+    }
+    UpdateBeam();
+}
+
+void CBeamEffect::SetVisible( bool visible )
+{
+    CEffect::SetVisible( visible );
+    if ( beam )
+    {
+      beam->setVisible( visible );
+    }
 }
 
 void CBeamEffect::Think()
@@ -19,6 +19,9 @@ class CBeamEffect : public CEffect
     virtual void Think();           
     virtual void Reset();
 
+    virtual void Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
+    virtual void SetVisible( bool visible );
+
     // NULL on creation, same as with CWorldPart::node
     CBeamNode* beam;
 
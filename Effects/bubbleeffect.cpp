@@ -12,15 +12,9 @@ CBubbleEffect::CBubbleEffect( vector3df OldPos, vector3df NewPos, f32 oneOverMas
 {
     Reset();
 
-    fScale = radiusConst;
-    interpolator = NULL;
+    UseBatch( "Sprites/bubble.png", video::EMT_TRANSPARENT_ALPHA_CHANNEL, true );
 
-    dimension2d<f32> dsize( fScale, fScale );
-    node = IRR.smgr->addBillboardSceneNode( 0, dsize, NewPos );
-
-    node->setMaterialType( video::EMT_TRANSPARENT_ALPHA_CHANNEL );
-    node->setMaterialFlag( video::EMF_LIGHTING, true );
-    node->setMaterialTexture( 0, IRR.video->getTexture( APP.useFile( "Sprites/bubble.png" ).c_str() ) );
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CBubbleEffect::~CBubbleEffect()
@@ -13,29 +13,13 @@ CDustEffect::CDustEffect( vector3df OldPos, vector3df NewPos, f32 oneOverMassCon
 {
     Reset();
 
-    fScale = radiusConst * 1.0f;
-    interpolator = new CLinearTimeInterpolator( fScale, aliveTime, fScale, fScale * 2.0f );
-
-    spritenode = new CAnimSpriteSceneNode( IRR.smgr->getRootSceneNode(), IRR.smgr, -1 ); 
-    spritenode->Load( APP.useFile( "Sprites/dust.png" ).c_str(), 0, 0, 256, 256 * 4, 256, 256, false, true ); 
-    spritenode->setMaterialType( video::EMT_TRANSPARENT_ALPHA_CHANNEL );
-	spritenode->setMaterialFlag( video::EMF_LIGHTING, (bool)IRR.useLighting );
+    UseBatch( "Sprites/dust.png", video::EMT_TRANSPARENT_ALPHA_CHANNEL, ( bool )IRR.useLighting );
 
-    //spritenode->setSpeed(4);
-    //  spritenode->setStartEndFrame( 0, 3 );
-    spritenode->setFrame( random( 4 ) );
-
-    spritenode->setSize( dimension2d<f32>( fScale, fScale ) );
-    spritenode->setPosition( NewPos );
-    spritenode->updateAbsolutePosition();
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CDustEffect::~CDustEffect()
 {
-    if ( ( IRR.smgr ) && ( spritenode ) )
-    {
-      spritenode->remove();
-    }
 }
 
 void CDustEffect::Reset()
@@ -43,13 +27,30 @@ void CDustEffect::Reset()
     CEffect::Reset();
 }
 
+void CDustEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    CEffect::Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+
+    fScale = radiusConst * 1.0f;
+    SetLinearCurve( fScale, fScale, fScale * 2.0f );
+
+    SBatchParticle* p = GetParticle();
+    if ( p )
+    {
+      p->pos = NewPos;
+      p->size = dimension2d<f32>( fScale, fScale );
+      p->rotated = true;
+      p->uv = batch->getFrameRect( cosmeticRandom( 4 ), 256, 256 );
+    }
+}
+
 void CDustEffect::Think()
 {
     CEffect::Think();
 
-    if ( spritenode )
+    SBatchParticle* p = GetParticle();
+    if ( p )
     {
-      spritenode->setSize( dimension2d<f32>( fScale, fScale ) );
-      spritenode->Update();
+      p->size = dimension2d<f32>( fScale, fScale );
     }
 }   
\ No newline at end of file
@@ -3,7 +3,6 @@
 
 #include "../Engine/engine.h"
 #include "effect.h"
-#include "../Irrlicht/CAnimSprite.h"
 
 ////////////////////////////////////////////
 // CDustEffect 
@@ -18,8 +17,7 @@ class CDustEffect : public CEffect
     virtual void Think();           
     virtual void Reset();
 
-  protected:
-    CAnimSpriteSceneNode* spritenode;
+    virtual void Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "effect.h"
+#include "effectpool.h"
 
 #include "../World/world.h"
 
@@ -23,24 +24,118 @@ CEffect::CEffect( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32
 
 CEffect::~CEffect()
 {
-    if ( interpolator )
+    if ( batch )
     {
-      interpolator->Kill();
+      batch->removeParticle( particle );
     }
 }
 
 void CEffect::Reset()
 {
     CWorldPart::Reset();
-    interpolator = NULL;
+    curveTarget = NULL;
+    poolType = -1;
+    batch = NULL;
+}
+
+void CEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    this->OldPos = OldPos;
+    this->Pos = AltOldPos = NewPos;
+    Force = OldForce = vector3df( 0.0f, 0.0f, 0.0f );
+    oneOverMass = oneOverMassConst;
+    radius = radiusConst;
+    collided = false;
+
+    alive = timeOut = aliveTime;
+    bCanDie = false;
+    bInvalidEntity = false;
+
+    fScale = radiusConst;
+    curveTarget = NULL;
+
+    if ( node )
+    {
+      node->setPosition( NewPos );
+    }
+}
+
+void CEffect::SetVisible( bool visible )
+{
+    if ( node )
+    {
+      node->setVisible( visible );
+    }
+
+    if ( batch )
+    {
+      if ( visible && !GetParticle() )
+      {
+        particle = batch->addParticle();
+      }
+      else if ( !visible )
+      {
+        batch->removeParticle( particle );
+      }
+    }
+}
+
+void CEffect::UseBatch( const c8* filename, E_MATERIAL_TYPE materialType, bool lighting )
+{
+    batch = EFFECTS->GetBatch( filename, materialType, lighting );
+    if ( batch )
+    {
+      particle = batch->addParticle();
+    }
+}
+
+void CEffect::Die()
+{
+    if ( poolType < 0 )
+    {
+      CWorldPart::Die();
+      return;
+    }
+
+    SetVisible( false );
+    EFFECTS->Recycle( this );
+}
+
+void CEffect::SetCurve( f32& target, f32 sV, f32 mV, f32 eV )
+{
+    curveTarget = &target;
+    curveStart = sV;
+    curveMid = mV;
+    curveEnd = eV;
+    curveTicks = 0;
+    target = sV;
 }
 
 void CEffect::Think()
 {
+    // same steps as CQuadraticTimeInterpolator, which ran before the world task
+    if ( curveTarget )
+    {
+      curveTicks++;
+      f32 b = clamp( ( f32 )curveTicks / ( f32 )timeOut, 0.0f, 1.0f ), a = 1.0f - b;
+      *curveTarget = curveStart * a * a + curveMid * 2.0f * a * b + curveEnd * b * b;
+      if ( curveTicks > timeOut )
+      {
+        curveTarget = NULL;
+      }
+    }
+
     CWorldPart::Think();
 
     if ( node )
     {
       node->setSize( dimension2d<f32>( -fScale, -fScale ) ); //the sprite is somehow inverted?
     }
-}   
\ No newline at end of file
+
+    SBatchParticle* p = GetParticle();
+    if ( p )
+    {
+      p->pos = Pos;
+      p->size = dimension2d<f32>( -fScale, -fScale ); // same as the node above
+    }
+}   
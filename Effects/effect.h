@@ -3,9 +3,12 @@
 
 #include "../Engine/engine.h"
 #include "../World/worldpart.h"
+#include "../Irrlicht/CParticleBatchSceneNode.h"
 
 ////////////////////////////////////////////
 // CEffect 
+// - effects are spawned through EFFECTS->Spawn() and recycled on death,
+//   the constructor creates the scene nodes and Respawn() sets up one spawn
 ////////////////////////////////////////////
 
 class CEffect : public CWorldPart
@@ -18,9 +21,45 @@ class CEffect : public CWorldPart
     virtual void Think();           
     virtual void Reset();
 
+    // per spawn state, called by the constructor and again each time the pool reuses the effect
+    virtual void Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
+    virtual void SetVisible( bool visible );
+
   protected:
+    friend class CEffectPool;
+
+    virtual void Die();
+
+    // draw as a particle in the shared batch for this texture and material
+    // instead of through an own scene node, call once from the constructor
+    void UseBatch( const c8* filename, E_MATERIAL_TYPE materialType, bool lighting );
+    // NULL while the effect is hidden or doesn't use a batch
+    SBatchParticle* GetParticle()
+    {
+        return batch ? batch->getParticle( particle ) : NULL;
+    }
+
+    // animates target from sV through mV to eV over the effect's lifetime,
+    // stepped in Think() so a spawn doesn't allocate an interpolator
+    void SetCurve( f32& target, f32 sV, f32 mV, f32 eV );
+    void SetLinearCurve( f32& target, f32 sV, f32 eV )
+    {
+        SetCurve( target, sV, ( sV + eV ) * 0.5f, eV );
+    }
+
     f32 fScale;
-    ITimebasedInterpolator* interpolator;
+
+    CParticleBatchSceneNode* batch;
+
+  private:
+    SSlotHandle particle;
+
+    f32* curveTarget;
+    f32 curveStart, curveMid, curveEnd;
+    int curveTicks;
+
+    // factory index for the pool, -1 if the effect was not made by the pool
+    s32 poolType;
 };
 
-#endif
\ No newline at end of file
+#endif
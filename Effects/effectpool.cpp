@@ -0,0 +1,140 @@
+#include "effectpool.h"
+#include "effect.h"
+
+#include "../World/world.h"
+// CONSOLE.
+#include "../IrrConsole/console.h"
+// IRR.
+#include "../Irrlicht/IrrlichtTask.h"
+
+////////////////////////////////////////////
+// CEffectPool 
+////////////////////////////////////////////
+
+CEffectPool::CEffectPool()
+{
+    spawnCount = allocCount = reuseCount = 0;
+}
+
+s32 CEffectPool::GetType( const c8* name )
+{
+    String n = name;
+    for ( u32 i = 0; i < FACTORY->Effects.indexArray.size(); i++ )
+    {
+      if ( FACTORY->Effects.indexArray[i] == n )
+      {
+        return i;
+      }
+    }
+
+    APPLOG.Write( "CEffectPool: no effect named %s", name );
+    return -1;
+}
+
+CEffect* CEffectPool::Spawn( s32 type, vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    if ( ( type < 0 ) || ( type >= ( s32 )FACTORY->Effects.indexArray.size() ) )
+    {
+      return NULL;
+    }
+
+#ifdef _CLIENT
+    while ( ( s32 )freeLists.size() <= type )
+    {
+      freeLists.push_back( array<CEffect*>() );
+    }
+
+    spawnCount++;
+
+    array<CEffect*>& freeList = freeLists[type];
+    if ( freeList.size() > 0 )
+    {
+      CEffect* e = freeList[freeList.size() - 1];
+      freeList.set_used( freeList.size() - 1 );
+
+      e->JoinWorld();
+      e->SetVisible( true );
+      e->Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+      reuseCount++;
+      return e;
+    }
+
+    CEffect* e = FACTORY->Effects.Create( FACTORY->Effects.indexArray[type], OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+    if ( e )
+    {
+      e->poolType = type;
+      allocCount++;
+    }
+    return e;
+#else
+    // effects and their world parts are only seen, the server has no one to show them to
+    return NULL;
+#endif
+}
+
+void CEffectPool::Recycle( CEffect* e )
+{
+    e->LeaveWorld();
+    freeLists[e->poolType].push_back( e );
+}
+
+CParticleBatchSceneNode* CEffectPool::GetBatch( const c8* filename, E_MATERIAL_TYPE materialType, bool lighting )
+{
+    for ( u32 i = 0; i < batches.size(); i++ )
+    {
+      if ( ( batches[i].materialType == materialType ) && ( batches[i].lighting == lighting ) && ( batches[i].filename == filename ) )
+      {
+        return batches[i].node;
+      }
+    }
+
+    if ( !IRR.smgr )
+    {
+      return NULL;
+    }
+
+    SBatch b;
+    b.filename = filename;
+    b.materialType = materialType;
+    b.lighting = lighting;
+    b.node = new CParticleBatchSceneNode( IRR.smgr->getRootSceneNode(), IRR.smgr, -1, IRR.video->getTexture( APP.useFile( filename ).c_str() ), materialType, lighting );
+    b.node->drop(); // the root node holds it
+    batches.push_back( b );
+    return b.node;
+}
+
+void CEffectPool::Clear()
+{
+    for ( u32 i = 0; i < freeLists.size(); i++ )
+    {
+      for ( u32 j = 0; j < freeLists[i].size(); j++ )
+      {
+        delete freeLists[i][j];
+      }
+      freeLists[i].clear();
+    }
+
+    for ( u32 i = 0; i < batches.size(); i++ )
+    {
+      if ( IRR.smgr )
+      {
+        batches[i].node->remove();
+      }
+    }
+    batches.clear();
+}
+
+void CEffectPool::PrintStats()
+{
+    u32 pooled = 0;
+    for ( u32 i = 0; i < freeLists.size(); i++ )
+    {
+      pooled += freeLists[i].size();
+    }
+
+    CONSOLE.addx( "Effects: %u spawned, %u allocated, %u reused, %u waiting in free lists", spawnCount, allocCount, reuseCount, pooled );
+    for ( u32 i = 0; i < batches.size(); i++ )
+    {
+      CONSOLE.addx( "  batch %s: %u particles", batches[i].filename.c_str(), batches[i].node->getParticleCount() );
+    }
+}
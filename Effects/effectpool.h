@@ -0,0 +1,63 @@
+#ifndef EFFECTPOOL_H_INCLUDED
+#define EFFECTPOOL_H_INCLUDED
+
+#include "../Engine/engine.h"
+
+#include "../Irrlicht/CParticleBatchSceneNode.h"
+
+class CEffect;
+
+////////////////////////////////////////////
+// CEffectPool 
+// - effects are spawned by type id instead of by name, resolve the id once
+//   with GetType() and keep it
+// - a dead effect keeps its scene nodes and waits in its type's free list,
+//   FACTORY->Effects.Create() is only called when that list is empty
+////////////////////////////////////////////
+
+#define EFFECTS CEffectPool::Instance()
+
+class CEffectPool
+{
+  public:
+    static CEffectPool* Instance()
+    {
+        static CEffectPool inst;
+        return &inst;
+    }
+
+    // factory index of the effect name, -1 if no such effect is registered
+    s32 GetType( const c8* name );
+
+    CEffect* Spawn( s32 type, vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
+
+    // called by CEffect::Die()
+    void Recycle( CEffect* e );
+
+    // shared particle batch, created on first use
+    CParticleBatchSceneNode* GetBatch( const c8* filename, E_MATERIAL_TYPE materialType, bool lighting );
+
+    // deletes the pooled effects and the batches, must be called before the scene is cleared
+    void Clear();
+
+    void PrintStats();
+
+    // spawns, spawns that had to allocate a new effect, spawns served from a free list
+    u32 spawnCount, allocCount, reuseCount;
+
+  private:
+    CEffectPool();
+
+    array< array<CEffect*> > freeLists;
+
+    struct SBatch
+    {
+        String filename;
+        E_MATERIAL_TYPE materialType;
+        bool lighting;
+        CParticleBatchSceneNode* node;
+    };
+    array<SBatch> batches;
+};
+
+#endif
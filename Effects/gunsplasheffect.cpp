@@ -12,14 +12,9 @@ CGunSplashEffect::CGunSplashEffect( vector3df OldPos, vector3df NewPos, f32 oneO
 {
     Reset();
 
-    fStartScale = fScale = radiusConst;
-    interpolator = new CQuadraticTimeInterpolator( fScale, aliveTime, fScale, radiusConst * 17.0f, radiusConst * 0.5f );
+    UseBatch( "Sprites/gunsplash.png", video::EMT_TRANSPARENT_ALPHA_CHANNEL, true );
 
-    dimension2d<f32> dsize( fScale, fScale );
-    node = IRR.smgr->addBillboardSceneNode( 0, dsize, NewPos );
-
-    node->setMaterialType( video::EMT_TRANSPARENT_ALPHA_CHANNEL );
-    node->setMaterialTexture( 0, IRR.video->getTexture( APP.useFile( "Sprites/gunsplash.png" ).c_str() ) );
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CGunSplashEffect::~CGunSplashEffect()
@@ -31,12 +26,21 @@ void CGunSplashEffect::Reset()
     CEffect::Reset();
 }
 
+void CGunSplashEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    CEffect::Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+
+    fStartScale = radiusConst;
+    SetCurve( fScale, radiusConst, radiusConst * 17.0f, radiusConst * 0.5f );
+}
+
 void CGunSplashEffect::Think()
 {
     CEffect::Think();
 
-    if ( node )
+    SBatchParticle* p = GetParticle();
+    if ( p )
     {
-      node->setSize( dimension2d<f32>( -fStartScale, -fScale ) );
+      p->size = dimension2d<f32>( -fStartScale, -fScale );
     }
 }   
\ No newline at end of file
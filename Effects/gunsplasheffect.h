@@ -17,6 +17,8 @@ class CGunSplashEffect : public CEffect
     virtual void Think();           
     virtual void Reset();
 
+    virtual void Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
+
   protected:
 
     f32 fStartScale;
@@ -7,35 +7,21 @@
 // CMachineHitEffect 
 ////////////////////////////////////////////
 
+#define MACHINEHIT_FRAMES 8
+
 bool bRegistered_CMachineHitEffect = FACTORY->Effects.Register<CMachineHitEffect>( "machinehit" );
 
 CMachineHitEffect::CMachineHitEffect( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime ) : CEffect( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime )
 {
     Reset();
 
-    fScale = radiusConst * 1.0f;
-    interpolator = NULL;
-    int frames = 8;
-
-    spritenode = new CAnimSpriteSceneNode( IRR.smgr->getRootSceneNode(), IRR.smgr, -1 ); 
-    spritenode->Load( APP.useFile( "Sprites/smallhit.png" ).c_str(), 0, 0, 256, 256 * frames, 256, 256, false, true ); 
-    spritenode->setMaterialType( video::EMT_TRANSPARENT_ALPHA_CHANNEL );
-
-    spritenode->setSpeed( aliveTime / frames );
-    spritenode->setStartEndFrame( 0, frames );
-    spritenode->setFrame( 0 );
+    UseBatch( "Sprites/smallhit.png", video::EMT_TRANSPARENT_ALPHA_CHANNEL, ( bool )IRR.useLighting );
 
-    spritenode->setSize( dimension2d<f32>( fScale, fScale ) );
-    spritenode->setPosition( NewPos );
-    spritenode->updateAbsolutePosition();
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CMachineHitEffect::~CMachineHitEffect()
 {
-    if ( ( IRR.smgr ) && ( spritenode ) )
-    {
-      spritenode->remove();
-    }
 }
 
 void CMachineHitEffect::Reset()
@@ -43,12 +29,32 @@ void CMachineHitEffect::Reset()
     CEffect::Reset();
 }
 
+void CMachineHitEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    CEffect::Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+
+    fScale = radiusConst * 1.0f;
+
+    SBatchParticle* p = GetParticle();
+    if ( p )
+    {
+      p->pos = NewPos;
+      p->size = dimension2d<f32>( fScale, fScale );
+      p->rotated = true;
+      p->uv = batch->getFrameRect( 0, 256, 256 );
+    }
+}
+
 void CMachineHitEffect::Think()
 {
     CEffect::Think();
 
-    if ( spritenode )
+    SBatchParticle* p = GetParticle();
+    if ( p )
     {
-      spritenode->Update();
+      // the whole animation plays once over the effect's lifetime
+      s32 frame = ( ( timeOut - alive ) / ( timeOut / MACHINEHIT_FRAMES + 1 ) ) % MACHINEHIT_FRAMES;
+      p->size = dimension2d<f32>( fScale, fScale );
+      p->uv = batch->getFrameRect( frame, 256, 256 );
     }
 }   
\ No newline at end of file
@@ -13,26 +13,13 @@ CSurfaceSplashEffect::CSurfaceSplashEffect( vector3df OldPos, vector3df NewPos,
 {
     Reset();
 
-    fScale = radiusConst * 0.1f;
-    interpolator = new CLinearTimeInterpolator( fScale, aliveTime, fScale, fScale * 3.0f );
-
-    spritenode = new CAnimSpriteSceneNode( IRR.smgr->getRootSceneNode(), IRR.smgr, -1 ); 
-    spritenode->Load( APP.useFile( "Sprites/bigsplash.png" ).c_str(), false, false ); 
-    spritenode->setMaterialType( video::EMT_TRANSPARENT_ALPHA_CHANNEL );
-	spritenode->setMaterialFlag( video::EMF_LIGHTING, (bool)IRR.useLighting );
+    UseBatch( "Sprites/bigsplash.png", video::EMT_TRANSPARENT_ALPHA_CHANNEL, ( bool )IRR.useLighting );
 
-    spritenode->setScale( vector3df( fScale, fScale, fScale ) );
-    spritenode->setPosition( NewPos - vector3df( 0.0f, 0.1f, 0.0f ) );
-    spritenode->setRotation( vector3df( 90, 0, 0 ) );
-    spritenode->updateAbsolutePosition();
+    Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
 }
 
 CSurfaceSplashEffect::~CSurfaceSplashEffect()
 {
-    if ( ( IRR.smgr ) && ( spritenode ) )
-    {
-      spritenode->remove();
-    }
 }
 
 void CSurfaceSplashEffect::Reset()
@@ -40,12 +27,39 @@ void CSurfaceSplashEffect::Reset()
     CEffect::Reset();
 }
 
+void CSurfaceSplashEffect::Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime )
+{
+    CEffect::Respawn( OldPos, NewPos, oneOverMassConst, radiusConst, aliveTime );
+
+    fScale = radiusConst * 0.1f;
+    SetLinearCurve( fScale, fScale, fScale * 3.0f );
+
+    SBatchParticle* p = GetParticle();
+    if ( p )
+    {
+      p->billboard = false;
+    }
+    UpdateQuad();
+}
+
 void CSurfaceSplashEffect::Think()
 {
     CEffect::Think();
 
-    if ( spritenode )
+    UpdateQuad();
+}
+
+void CSurfaceSplashEffect::UpdateQuad()
+{
+    SBatchParticle* p = GetParticle();
+    if ( !p || !batch->getTexture() )
     {
-      spritenode->setScale( vector3df( fScale, 3 * fScale, fScale ) );
+      return;
     }
+
+    // lies in the XZ plane, stretched 3 times along Z
+    dimension2d<s32> size = batch->getTexture()->getOriginalSize();
+    p->pos = Pos - vector3df( 0.0f, 0.1f, 0.0f );
+    p->axisU = vector3df( size.Width * 0.5f * fScale, 0.0f, 0.0f );
+    p->axisV = vector3df( 0.0f, 0.0f, -size.Height * 0.5f * 3.0f * fScale );
 }   
\ No newline at end of file
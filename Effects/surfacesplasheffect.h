@@ -3,7 +3,6 @@
 
 #include "../Engine/engine.h"
 #include "effect.h"
-#include "../Irrlicht/CAnimSprite.h"
 
 ////////////////////////////////////////////
 // CSurfaceSplashEffect 
@@ -18,8 +17,11 @@ class CSurfaceSplashEffect : public CEffect
     virtual void Think();           
     virtual void Reset();
 
+    virtual void Respawn( vector3df OldPos, vector3df NewPos, f32 oneOverMassConst, f32 radiusConst, int aliveTime );
+
   protected:
-    CAnimSpriteSceneNode* spritenode;
+    // flat quad on the water surface, sized like the texture
+    void UpdateQuad();
 };
 
 #endif
\ No newline at end of file
@@ -40,6 +40,7 @@ using std::ostream;
 #include "singleton.h"
 #include "functor.h"
 #include "ringbuf.h"
+#include "slotmap.h"
 #include "serialize.h"
 #include "kernel.h"
 #include "interpolators.h"
@@ -0,0 +1,398 @@
+#ifndef USING_ENGINUITY
+#define USING_ENGINUITY
+#endif
+#include "engine.h"
+#include "jobs.h"
+#include "misc.h"
+
+#ifndef WIN32
+#include <sched.h>
+#endif
+
+#ifdef WIN32
+#define ATOMIC_ADD( var, value ) ( InterlockedExchangeAdd( ( LONG * )&( var ), ( value ) ) + ( value ) )
+#else
+#define ATOMIC_ADD( var, value ) __sync_add_and_fetch( &( var ), ( value ) )
+#endif
+
+static int getCoresNum()
+{
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return info.dwNumberOfProcessors;
+#else
+    return ( int )sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+}
+
+////////////////////////////////////////////
+// CJobLock
+////////////////////////////////////////////
+
+CJobLock::CJobLock()
+{
+#ifdef WIN32
+    InitializeCriticalSection( &section );
+#else
+    pthread_mutex_init( &mutex, NULL );
+#endif
+}
+
+CJobLock::~CJobLock()
+{
+#ifdef WIN32
+    DeleteCriticalSection( &section );
+#else
+    pthread_mutex_destroy( &mutex );
+#endif
+}
+
+void CJobLock::Lock()
+{
+#ifdef WIN32
+    EnterCriticalSection( &section );
+#else
+    pthread_mutex_lock( &mutex );
+#endif
+}
+
+void CJobLock::Unlock()
+{
+#ifdef WIN32
+    LeaveCriticalSection( &section );
+#else
+    pthread_mutex_unlock( &mutex );
+#endif
+}
+
+////////////////////////////////////////////
+// CJobQueue
+////////////////////////////////////////////
+
+void CJobQueue::Push( const SJob& job )
+{
+    lock.Lock();
+    jobs.push_back( job );
+    lock.Unlock();
+}
+
+bool CJobQueue::Pop( SJob& job )
+{
+    bool bFound = false;
+    lock.Lock();
+    if ( !jobs.empty() )
+    {
+      job = jobs.back();
+      jobs.pop_back();
+      bFound = true;
+    }
+    lock.Unlock();
+    return bFound;
+}
+
+bool CJobQueue::Steal( SJob& job )
+{
+    bool bFound = false;
+    lock.Lock();
+    if ( !jobs.empty() )
+    {
+      job = jobs.front();
+      jobs.pop_front();
+      bFound = true;
+    }
+    lock.Unlock();
+    return bFound;
+}
+
+////////////////////////////////////////////
+// CJobSystem
+////////////////////////////////////////////
+
+CJobSystem::CJobSystem()
+{
+    threadsNum = 1;
+    bQuit = 0;
+    phasesNum = 0;
+    jobZone = CProfileSample::RegisterZone( "Job", true );
+
+#ifdef WIN32
+    wake = CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+    tlsIndex = TlsAlloc();
+#else
+    sem_init( &wake, 0, 0 );
+    pthread_key_create( &tlsKey, NULL );
+#endif
+}
+
+CJobSystem::~CJobSystem()
+{
+    Stop();
+
+#ifdef WIN32
+    CloseHandle( wake );
+    TlsFree( tlsIndex );
+#else
+    sem_destroy( &wake );
+    pthread_key_delete( tlsKey );
+#endif
+}
+
+void CJobSystem::Start( int workersNum )
+{
+    Stop();
+
+    if ( workersNum <= 0 )
+    {
+      workersNum = getCoresNum() - 1;
+    }
+    workersNum = max( 0, min( workersNum, MAX_JOB_WORKERS ) );
+
+    bQuit = 0;
+    threadsNum = 1;
+    for ( int i = 0; i < workersNum; i++ )
+    {
+      // queue 0 is the main thread's
+      workers[i].system = this;
+      workers[i].index = i + 1;
+#ifdef WIN32
+      workers[i].thread = CreateThread( NULL, 0, WorkerProc, &workers[i], 0, NULL );
+      if ( workers[i].thread == NULL )
+      {
+        break;
+      }
+#else
+      if ( pthread_create( &workers[i].thread, NULL, WorkerProc, &workers[i] ) != 0 )
+      {
+        break;
+      }
+#endif
+      threadsNum++;
+    }
+
+    APPLOG.Write( "Job system: %i worker threads", threadsNum - 1 );
+}
+
+void CJobSystem::Stop()
+{
+    int workersNum = threadsNum - 1;
+    if ( workersNum == 0 )
+    {
+      return;
+    }
+
+    bQuit = 1;
+    for ( int i = 0; i < workersNum; i++ )
+    {
+#ifdef WIN32
+      ReleaseSemaphore( wake, 1, NULL );
+#else
+      sem_post( &wake );
+#endif
+    }
+    for ( int i = 0; i < workersNum; i++ )
+    {
+#ifdef WIN32
+      WaitForSingleObject( workers[i].thread, INFINITE );
+      CloseHandle( workers[i].thread );
+#else
+      pthread_join( workers[i].thread, NULL );
+#endif
+    }
+
+    threadsNum = 1;
+    bQuit = 0;
+}
+
+#ifdef WIN32
+DWORD WINAPI CJobSystem::WorkerProc( LPVOID param )
+#else
+void* CJobSystem::WorkerProc( void* param )
+#endif
+{
+    SWorker* worker = ( SWorker* )param;
+    CJobSystem* system = worker->system;
+
+#ifdef WIN32
+    TlsSetValue( system->tlsIndex, ( LPVOID )( size_t )worker->index );
+#else
+    pthread_setspecific( system->tlsKey, ( void* )( size_t )worker->index );
+#endif
+
+    while ( 1 )
+    {
+#ifdef WIN32
+      WaitForSingleObject( system->wake, INFINITE );
+#else
+      sem_wait( &system->wake );
+#endif
+      if ( system->bQuit )
+      {
+        break;
+      }
+
+      // one wake up per job, but keep going while there is work anywhere
+      while ( system->RunOne( worker->index ) )
+      {
+      }
+    }
+
+    return 0;
+}
+
+int CJobSystem::Self()
+{
+#ifdef WIN32
+    return ( int )( size_t )TlsGetValue( tlsIndex );
+#else
+    return ( int )( size_t )pthread_getspecific( tlsKey );
+#endif
+}
+
+void CJobSystem::Submit( JobFunction function, void* data, u32 begin, u32 end, SJobCounter& counter, s32 phase )
+{
+    SJob job;
+    job.function = function;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = &counter;
+    job.phase = phase;
+
+    ATOMIC_ADD( counter.pending, 1 );
+    queues[Self()].Push( job );
+
+    if ( threadsNum > 1 )
+    {
+#ifdef WIN32
+      ReleaseSemaphore( wake, 1, NULL );
+#else
+      sem_post( &wake );
+#endif
+    }
+}
+
+void CJobSystem::Wait( SJobCounter& counter )
+{
+    int self = Self();
+    while ( counter.pending > 0 )
+    {
+      if ( !RunOne( self ) )
+      {
+        // the last jobs are running on other threads
+#ifdef WIN32
+        Sleep( 0 );
+#else
+        sched_yield();
+#endif
+      }
+    }
+}
+
+bool CJobSystem::RunOne( int self )
+{
+    SJob job;
+
+    if ( queues[self].Pop( job ) )
+    {
+      Run( job );
+      return true;
+    }
+
+    for ( int i = 1; i < threadsNum; i++ )
+    {
+      if ( queues[( self + i ) % threadsNum].Steal( job ) )
+      {
+        Run( job );
+        return true;
+      }
+    }
+
+    return false;
+}
+
+void CJobSystem::Run( SJob& job )
+{
+#ifdef PROFILER
+    ProfileTime traceStart = CProfileSample::GetTime();
+#endif
+    u32 start = getMicroTime();
+    job.function( job.data, job.begin, job.end );
+
+#ifdef PROFILER
+    CProfileSample::Trace( ( job.phase >= 0 ) ? phases[job.phase].zone : jobZone, traceStart, CProfileSample::GetTime() );
+#endif
+
+    if ( job.phase >= 0 )
+    {
+      ATOMIC_ADD( phases[job.phase].busy, ( long )( getMicroTime() - start ) );
+      ATOMIC_ADD( phases[job.phase].jobs, 1 );
+    }
+    ATOMIC_ADD( job.counter->pending, -1 );
+}
+
+void CJobSystem::ParallelFor( const c8* phaseName, JobFunction function, void* data, u32 count, u32 grain )
+{
+    if ( count == 0 )
+    {
+      return;
+    }
+
+    s32 phase = Phase( phaseName );
+    u32 start = getMicroTime();
+
+    // a few batches per thread so a slow one can be balanced by stealing
+    u32 batches = count / max( grain, ( u32 )1 );
+    batches = max( ( u32 )1, min( batches, ( u32 )threadsNum * 4 ) );
+    u32 batchSize = ( count + batches - 1 ) / batches;
+
+    SJobCounter counter;
+    for ( u32 begin = 0; begin < count; begin += batchSize )
+    {
+      Submit( function, data, begin, min( begin + batchSize, count ), counter, phase );
+    }
+    Wait( counter );
+
+    if ( phase >= 0 )
+    {
+      phases[phase].wall += ( long )( getMicroTime() - start );
+    }
+}
+
+s32 CJobSystem::Phase( const c8* phaseName )
+{
+    for ( int i = 0; i < phasesNum; i++ )
+    {
+      if ( phases[i].name == phaseName )
+      {
+        return i;
+      }
+    }
+
+    if ( phasesNum == MAX_JOB_PHASES )
+    {
+      return -1;
+    }
+
+    phases[phasesNum].name = phaseName;
+    phases[phasesNum].zone = CProfileSample::RegisterZone( phaseName, true );
+    phases[phasesNum].wall = phases[phasesNum].busy = phases[phasesNum].jobs = 0;
+    return phasesNum++;
+}
+
+void CJobSystem::OutputUtilization( IProfilerOutputHandler* handler )
+{
+    for ( int i = 0; i < phasesNum; i++ )
+    {
+      if ( phases[i].jobs == 0 )
+      {
+        continue;
+      }
+
+      f32 wall = phases[i].wall / 1000.0f;
+      f32 busy = phases[i].busy / 1000.0f;
+      handler->Utilization( wall, busy, phases[i].jobs, threadsNum, phases[i].name );
+
+      phases[i].wall = phases[i].busy = phases[i].jobs = 0;
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef JOBS_H_INCLUDED
+#define JOBS_H_INCLUDED
+
+#ifndef WIN32
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+#define MAX_JOB_WORKERS 32
+#define MAX_JOB_PHASES 32
+
+class IProfilerOutputHandler;
+
+// a job runs function( data, begin, end ) over its part of a range
+typedef void ( *JobFunction )( void* data, u32 begin, u32 end );
+
+// counts the unfinished jobs of a batch, Wait() on it to join the batch
+struct SJobCounter
+{
+    SJobCounter()
+    {
+        pending = 0;
+    }
+    volatile long pending;
+};
+
+struct SJob
+{
+    JobFunction function;
+    void* data;
+    u32 begin, end;
+    SJobCounter* counter;
+    s32 phase;
+};
+
+////////////////////////////////////////////
+// CJobLock
+////////////////////////////////////////////
+
+class CJobLock
+{
+  public:
+    CJobLock();
+    ~CJobLock();
+
+    void Lock();
+    void Unlock();
+
+  private:
+#ifdef WIN32
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+////////////////////////////////////////////
+// CJobQueue
+// - one per thread, the owner takes the newest job from the back,
+//   idle threads steal the oldest from the front
+////////////////////////////////////////////
+
+class CJobQueue
+{
+  public:
+    void Push( const SJob& job );
+    bool Pop( SJob& job );
+    bool Steal( SJob& job );
+
+  private:
+    CJobLock lock;
+    std::deque<SJob> jobs;
+};
+
+////////////////////////////////////////////
+// CJobSystem
+// - worker threads run jobs that tasks submit from their Update(), the
+//   thread that waits for a batch runs jobs too instead of blocking
+// - jobs must not touch Irrlicht, Newton, scripts or sound, only data the
+//   job owns for the length of the batch
+////////////////////////////////////////////
+
+#define JOBS KERNEL.Jobs()
+
+class CJobSystem
+{
+  public:
+    CJobSystem();
+    ~CJobSystem();
+
+    // 0 starts one worker for every core but the calling one
+    void Start( int workers );
+    void Stop();
+
+    // workers and the main thread
+    int getThreads()
+    {
+        return threadsNum;
+    }
+
+    void Submit( JobFunction function, void* data, u32 begin, u32 end, SJobCounter& counter, s32 phase = -1 );
+    void Wait( SJobCounter& counter );
+
+    // runs function over [0, count) in batches of at least grain items and
+    // returns when all of them are done, the time is kept under phaseName
+    void ParallelFor( const c8* phaseName, JobFunction function, void* data, u32 count, u32 grain );
+
+    // a named phase for Submit()
+    s32 Phase( const c8* phaseName );
+
+    // how busy the threads were in each phase since the last output
+    void OutputUtilization( IProfilerOutputHandler* handler );
+
+    // the calling thread's queue, 0 for the main thread and threads that are not workers
+    int Self();
+
+  private:
+    bool RunOne( int self );
+    void Run( SJob& job );
+
+#ifdef WIN32
+    static DWORD WINAPI WorkerProc( LPVOID param );
+#else
+    static void* WorkerProc( void* param );
+#endif
+
+    struct SWorker
+    {
+        CJobSystem* system;
+        int index;
+#ifdef WIN32
+        HANDLE thread;
+#else
+        pthread_t thread;
+#endif
+    };
+
+    struct SJobPhase
+    {
+        std::string name;
+        // the profiler's trace zone of its jobs
+        s32 zone;
+        // microseconds
+        volatile long wall, busy;
+        volatile long jobs;
+    };
+
+    int threadsNum;
+    volatile long bQuit;
+
+    // queue 0 belongs to the main thread and to threads that are not workers
+    CJobQueue queues[MAX_JOB_WORKERS + 1];
+    SWorker workers[MAX_JOB_WORKERS];
+
+    SJobPhase phases[MAX_JOB_PHASES];
+    int phasesNum;
+    // the trace zone of jobs outside a phase
+    s32 jobZone;
+
+#ifdef WIN32
+    HANDLE wake;
+    DWORD tlsIndex;
+#else
+    sem_t wake;
+    pthread_key_t tlsKey;
+#endif
+};
+
+#endif
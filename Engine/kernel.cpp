@@ -25,6 +25,11 @@ CKernel::CKernel()
     Frames = FramesPerSecond = 0;
     TickTime = TickTimeLast = 0;
     frc = fps = frp = 0;
+
+    workersNum = 0;
+
+    bLockstep = bFreeRun = bTimeTasks = false;
+    pendingTicks = lastLoopTicks = 0;
 }
 
 CKernel::~CKernel()
@@ -35,6 +40,8 @@ int CKernel::Execute()
 {
     int i, mainControl, loopTicks;
 
+    jobs.Start( workersNum );
+
     while ( !taskList.empty() )
     {
       {
@@ -46,6 +53,19 @@ int CKernel::Execute()
 
           // frame-rate independent tasks
           loopTicks = TickTime - TickTimeLast;
+          if ( bFreeRun )
+          {
+            loopTicks = 1;
+          }
+          else if ( bLockstep )
+          {
+            // the ticks that are due run in the next loops, one each
+            pendingTicks += loopTicks;
+            loopTicks = min( pendingTicks, 1 );
+            pendingTicks -= loopTicks;
+          }
+          lastLoopTicks = loopTicks;
+
           for ( mainControl = 0; mainControl < loopTicks; mainControl++ )
           {
             Ticks += 1;
@@ -57,7 +77,7 @@ int CKernel::Execute()
               ++it;
               if ( ( !t->canKill ) && ( t->framerate_independent ) )
               {
-                t->Update();
+                UpdateTask( t );
               }
             }
           }
@@ -69,10 +89,18 @@ int CKernel::Execute()
             ++it;
             if ( ( !t->canKill ) && ( !t->framerate_independent ) )
             {
-              t->Update();
+              UpdateTask( t );
             }
           }
 
+#ifndef _CLIENT
+          // nothing is drawn, wait for the next tick instead of spinning
+          if ( loopTicks == 0 )
+          {
+            delay( 1 );
+          }
+#endif
+
           //loop again to remove dead tasks
           for ( it = taskList.begin(); it != taskList.end(); )
           {
@@ -93,9 +121,13 @@ int CKernel::Execute()
       CProfileSample::Output();
 #endif
 
-      delay( 1 );
+      if ( !bFreeRun )
+      {
+        delay( 1 );
+      }
     }
 
+    jobs.Stop();
 
     return 0;
 }
@@ -118,9 +150,58 @@ bool CKernel::AddTask( const CMMPointer<ITask>& t )
       }
     }
     taskList.insert( it, t );
+    SortTasks();
     return true;
 }
 
+void CKernel::UpdateTask( ITask* t )
+{
+    if ( !bTimeTasks )
+    {
+      t->Update();
+      return;
+    }
+
+    u32 start = getMicroTime();
+    t->Update();
+    t->updateTime += getMicroTime() - start;
+    t->updates++;
+}
+
+void CKernel::SetLockstep( bool lockstep, bool freeRun )
+{
+    bLockstep = lockstep || freeRun;
+    bFreeRun = freeRun;
+    pendingTicks = 0;
+}
+
+void CKernel::TimeTasks( bool on )
+{
+    bTimeTasks = on;
+    if ( !on )
+    {
+      return;
+    }
+
+    std::list<CMMPointer<ITask> >::iterator it;
+    for ( it = taskList.begin(); it != taskList.end(); it++ )
+    {
+      ( *it )->updateTime = ( *it )->updates = 0;
+    }
+}
+
+void CKernel::LogTaskTimes( u32 ticks )
+{
+    ticks = max( ticks, ( u32 )1 );
+
+    std::list<CMMPointer<ITask> >::iterator it;
+    for ( it = taskList.begin(); it != taskList.end(); it++ )
+    {
+      ITask* t = ( *it );
+      APPLOG.Write( "  %-20s : %8.1f us a tick : %6u updates", t->name, ( f32 )t->updateTime / ticks, t->updates );
+    }
+}
+
 void CKernel::SuspendTask( const CMMPointer<ITask>& t )
 {
     //check that this task is in our list - we don't want to suspend a task that isn't running
@@ -149,6 +230,7 @@ void CKernel::ResumeTask( const CMMPointer<ITask>& t )
         }
       }
       taskList.insert( it, t );
+      SortTasks();
     }
 }
 
@@ -186,6 +268,50 @@ void CKernel::KillAllTasks()
     pausedTaskList.clear();
 }
 
+void CKernel::SortTasks()
+{
+    // moves tasks within the list, the iterators of a running Execute() stay valid
+    std::list<CMMPointer<ITask> >::iterator placed, it, dep;
+    std::list<ITask*>::iterator d;
+
+    placed = taskList.begin();
+    while ( placed != taskList.end() )
+    {
+      // the first task in priority order whose dependencies are all placed
+      std::list<CMMPointer<ITask> >::iterator ready = placed;
+      for ( it = placed; it != taskList.end(); it++ )
+      {
+        bool bWaiting = false;
+        for ( d = ( *it )->dependencies.begin(); ( d != ( *it )->dependencies.end() ) && !bWaiting; d++ )
+        {
+          for ( dep = placed; dep != taskList.end(); dep++ )
+          {
+            if ( ( dep != it ) && ( ( ITask * )( *dep ) == *d ) )
+            {
+              bWaiting = true;
+              break;
+            }
+          }
+        }
+        if ( !bWaiting )
+        {
+          ready = it;
+          break;
+        }
+      }
+
+      // a cycle falls back to priority order
+      if ( ready == placed )
+      {
+        ++placed;
+      }
+      else
+      {
+        taskList.splice( placed, taskList, ready );
+      }
+    }
+}
+
 void CKernel::Number27Timing()
 {
     TimeInMilLast = TimeInMil;
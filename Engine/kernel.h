@@ -10,6 +10,7 @@
 #endif // _MSC_VER > 1000
 
 #include "singleton.h"
+#include "jobs.h"
 
 #define DEFAULT_GOALTICKS 60
 
@@ -41,11 +42,55 @@ class CKernel : public Singleton<CKernel>
         GoalTicks = g; Number27Timing();
     }
 
+    // 0 for one worker per core, takes effect in Execute()
+    void SetWorkers( int w )
+    {
+        workersNum = w;
+    }
+
+    CJobSystem& Jobs()
+    {
+        return jobs;
+    }
+
+    // lockstep runs at most one tick a loop and the physics gets whole ticks,
+    // so the same input plays out the same, freeRun does not wait for the ticks
+    void SetLockstep( bool lockstep, bool freeRun );
+    bool isLockstep()
+    {
+        return bLockstep;
+    }
+    // ticks run by the last loop
+    int GetLoopTicks()
+    {
+        return lastLoopTicks;
+    }
+    int GetGoalTicks()
+    {
+        return GoalTicks;
+    }
+
+    // adds up each task's Update() time while on
+    void TimeTasks( bool on );
+    void LogTaskTimes( u32 ticks );
+
+    // tasks run in priority order, except that a task runs after the tasks it depends on,
+    // done when a task is added and after changing dependencies
+    void SortTasks();
+
   protected:
     std::list<CMMPointer<ITask> > taskList;
     std::list<CMMPointer<ITask> > pausedTaskList;
 
   private:
+    void UpdateTask( ITask* t );
+
+    CJobSystem jobs;
+    int workersNum;
+
+    bool bLockstep, bFreeRun, bTimeTasks;
+    int pendingTicks, lastLoopTicks;
+
     //{********** NUMBER27's TIMING ROUTINES ***********}
     void Number27Timing();
 
@@ -65,6 +110,8 @@ class ITask : virtual public IMMObject
     ITask()
     {
         canKill = false;priority = 5000;
+        name = "task";
+        updateTime = updates = 0;
     }
     virtual bool Start() = 0;
     virtual void OnSuspend()
@@ -76,12 +123,29 @@ class ITask : virtual public IMMObject
     };
     virtual void Stop() = 0;
 
+    // this task updates after t, whatever their priorities say
+    void DependsOn( ITask* t )
+    {
+        dependencies.push_back( t );
+    }
+    void RemoveDependency( ITask* t )
+    {
+        dependencies.remove( t );
+    }
+
     bool canKill;
     long priority;
     bool framerate_independent;
+    std::list<ITask*> dependencies;
+
+    // for the task timings
+    const char* name;
+    // microseconds
+    unsigned int updateTime, updates;
 };
 
 #define ADDTASK(TaskName, TaskPriority, TaskFramerate_independent) \
+    TaskName->name = #TaskName; \
     TaskName->priority = TaskPriority; \
     TaskName->framerate_independent = TaskFramerate_independent;\
     KERNEL.AddTask(CMMPointer<ITask>(TaskName));\
@@ -22,4 +22,38 @@ inline bool wordInString( String input, String word )
     return false;
 }
 
+// FNV-1a, for cache names and for telling whether a file changed
+#define HASH_OFFSET 2166136261u
+#define HASH_PRIME 16777619u
+
+inline u32 HashBytes( u32 hash, const void* data, u32 size )
+{
+    const u8* p = ( const u8* )data;
+    for ( u32 i = 0; i < size; i++ )
+    {
+      hash = ( hash ^ p[i] ) * HASH_PRIME;
+    }
+    return hash;
+}
+
+// 0 if the file cannot be read
+inline u32 HashFile( const c8* filename )
+{
+    FILE* pFile = fopen( filename, "rb" );
+    if ( pFile == NULL )
+    {
+      return 0;
+    }
+
+    u32 hash = HASH_OFFSET;
+    u8 buffer[4096];
+    size_t read;
+    while ( ( read = fread( buffer, 1, sizeof( buffer ), pFile ) ) > 0 )
+    {
+      hash = HashBytes( hash, buffer, ( u32 )read );
+    }
+    fclose( pFile );
+    return hash;
+}
+
 #endif
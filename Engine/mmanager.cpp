@@ -1,27 +1,110 @@
 #include "engine.h"
 #include "misc.h"
 
+// every block handed out by IMMObject::operator new is preceded by this header
+struct MMBlockHeader
+{
+    unsigned long magic;
+    unsigned long size;     //requested object size, used for heapUsage
+    int sizeClass;          //pool index or -1 if the block came straight from malloc
+    MMBlockHeader* nextFree;//link in the pool free list while the block is unused
+};
+
+#define MM_HEAP_MAGIC 0x4D4D4F42 // 'MMOB'
+#define MM_FREE_MAGIC 0x46524545 // 'FREE'
+
+// size classes are multiples of MM_POOL_GRANULARITY up to MM_POOL_MAXSIZE,
+// anything bigger goes directly to malloc
+#define MM_POOL_GRANULARITY 16
+#define MM_POOL_CLASSES 32
+#define MM_POOL_MAXSIZE ( MM_POOL_GRANULARITY * MM_POOL_CLASSES )
+#define MM_POOL_CHUNK_BLOCKS 64
+
+// blocks allocated but not yet reached by the IMMObject constructor, nested
+// news can leave more than this pending, the list grows then
+#define MM_PENDING_RESERVE 16
+
+static MMBlockHeader* poolFreeLists[MM_POOL_CLASSES];
+static std::vector<void*> poolChunks;
+static std::vector<MMBlockHeader*> pendingBlocks;
+
 IMMObject* IMMObject::liveObjects = 0;
 IMMObject* IMMObject::deadObjects = 0;
-std::list<IMMObject*> IMMObject::heapObjects;
 unsigned long IMMObject::heapUsage = 0;
 int IMMObject::newNum = 0;
 int IMMObject::deleteNum = 0;
+int IMMObject::poolHits = 0;
 
-IMMObject::IMMObject()
+static MMBlockHeader* AllocateBlock( size_t objsize )
 {
-    nextObject = prevObject = 0;
-    refCount = 0;
-    std::list<IMMObject*>::iterator it = std::find( heapObjects.begin(), heapObjects.end(), this );
-    if ( it == heapObjects.end() )
+    MMBlockHeader* header;
+
+    if ( objsize == 0 || objsize > MM_POOL_MAXSIZE )
+    {
+      header = ( MMBlockHeader * )malloc( sizeof( MMBlockHeader ) + objsize );
+      header->sizeClass = -1;
+      return header;
+    }
+
+    int sizeClass = ( int )( ( objsize - 1 ) / MM_POOL_GRANULARITY );
+    if ( !poolFreeLists[sizeClass] )
     {
-      bIsStackAllocated = true;
+      //carve a new chunk into blocks of this class
+      size_t blockSize = sizeof( MMBlockHeader ) + ( sizeClass + 1 ) * MM_POOL_GRANULARITY;
+      char* chunk = ( char* )malloc( blockSize * MM_POOL_CHUNK_BLOCKS );
+      poolChunks.push_back( chunk );
+      for ( int i = MM_POOL_CHUNK_BLOCKS - 1; i >= 0; i-- )
+      {
+        MMBlockHeader* block = ( MMBlockHeader * )( chunk + i * blockSize );
+        block->magic = MM_FREE_MAGIC;
+        block->sizeClass = sizeClass;
+        block->nextFree = poolFreeLists[sizeClass];
+        poolFreeLists[sizeClass] = block;
+      }
     }
     else
     {
-      bIsStackAllocated = false;
-      heapObjects.erase( it );
+      IMMObject::poolHits++;
+    }
+
+    header = poolFreeLists[sizeClass];
+    poolFreeLists[sizeClass] = header->nextFree;
+    return header;
+}
+
+static void ReleaseBlock( MMBlockHeader* header )
+{
+    header->magic = MM_FREE_MAGIC;
+    if ( header->sizeClass < 0 )
+    {
+      free( header );
+      return;
+    }
+    header->nextFree = poolFreeLists[header->sizeClass];
+    poolFreeLists[header->sizeClass] = header;
+}
+
+IMMObject::IMMObject()
+{
+    nextObject = prevObject = 0;
+    refCount = 0;
+
+    //look for the block we are being constructed in, it is almost always the last one allocated
+    bIsStackAllocated = true;
+    for ( int i = ( int )pendingBlocks.size() - 1; i >= 0; i-- )
+    {
+      char* block = ( char* )( pendingBlocks[i] + 1 );
+      if ( ( ( char* )this >= block ) && ( ( char* )this < block + pendingBlocks[i]->size ) )
+      {
+        //an IMMObject that is a virtual base does not start the block, those were never
+        //garbage collected and still aren't
+        bIsStackAllocated = ( ( char* )this != block );
+        pendingBlocks[i] = pendingBlocks.back();
+        pendingBlocks.pop_back();
+        break;
+      }
     }
+
     if ( !bIsStackAllocated )
     {
       //start on the deadObjects list
@@ -73,7 +156,7 @@ void IMMObject::AddRef()
         deadObjects = nextObject;
       }
       prevObject = 0;
-      nextObject = liveObjects; 
+      nextObject = liveObjects;
       if ( liveObjects )
       {
         liveObjects->prevObject = this;
@@ -132,25 +215,92 @@ void IMMObject::CollectRemainingObjects( bool bEmitWarnings )
     if ( bEmitWarnings )
     {
       APPLOG.Write( "MManager: objects created %i; deleted %i; difference %i", newNum, deleteNum, newNum - deleteNum );
+      APPLOG.Write( "MManager: heap usage %u bytes; %i allocations served from pool free lists; %i pool chunks", heapUsage, poolHits, ( int )poolChunks.size() );
     }
 }
 
+bool IMMObject::IsHeapBlock( void* p )
+{
+    return ( ( ( MMBlockHeader * )p ) - 1 )->magic == MM_HEAP_MAGIC;
+}
+
 void* IMMObject::operator new( size_t objsize )
 {
     newNum++;
-    void* newObj = malloc( objsize );
+    MMBlockHeader* header = AllocateBlock( objsize );
+    header->magic = MM_HEAP_MAGIC;
+    header->size = objsize;
+    header->nextFree = 0;
     heapUsage += objsize;
-    heapObjects.push_back( ( IMMObject * )newObj );
-    ( ( IMMObject * )newObj )->heapAllocSize = objsize;
-    return newObj;
+
+    if ( pendingBlocks.capacity() < MM_PENDING_RESERVE )
+    {
+      pendingBlocks.reserve( MM_PENDING_RESERVE );
+    }
+    pendingBlocks.push_back( header );
+
+    return header + 1;
 }
 
 void IMMObject::operator delete( void* obj )
 {
-    if ( !( ( IMMObject * )obj )->bIsStackAllocated )
+    if ( !obj )
+    {
+      return;
+    }
+    MMBlockHeader* header = ( ( MMBlockHeader * )obj ) - 1;
+    assert( header->magic == MM_HEAP_MAGIC && "Tried to delete an IMMObject that is not on the heap" );
+    deleteNum++;
+    heapUsage -= header->size;
+
+    // a constructor that threw never took its block off the pending list
+    for ( int i = ( int )pendingBlocks.size() - 1; i >= 0; i-- )
+    {
+      if ( pendingBlocks[i] == header )
+      {
+        pendingBlocks[i] = pendingBlocks.back();
+        pendingBlocks.pop_back();
+        break;
+      }
+    }
+
+    ReleaseBlock( header );
+}
+
+void IMMObject::Benchmark( int maxLiveObjects, int cycles )
+{
+    typedef CMMBlob<char, 32> BenchBlob;
+
+    std::vector<BenchBlob*> live;
+    int liveCount = 1;
+
+    APPLOG.Write( "MManager benchmark: %i allocate/release cycles per step", cycles );
+    while ( liveCount <= maxLiveObjects )
+    {
+      while ( ( int )live.size() < liveCount )
+      {
+        BenchBlob* b = new BenchBlob();
+        b->AddRef();
+        live.push_back( b );
+      }
+
+      unsigned int start = getPreciseTime();
+      for ( int i = 0; i < cycles; i++ )
+      {
+        {
+            CMMPointer<BenchBlob> b = new BenchBlob();
+        }
+        CollectGarbage();
+      }
+      unsigned int elapsed = getPreciseTime() - start;
+
+      APPLOG.Write( "MManager benchmark: %8i live objects - %u ms (%.3f us per cycle)", liveCount, elapsed, ( elapsed * 1000.0f ) / cycles );
+      liveCount *= 4;
+    }
+
+    for ( unsigned int i = 0; i < live.size(); i++ )
     {
-      deleteNum++;
-      heapUsage -= ( ( IMMObject * )obj )->heapAllocSize;
-      free( obj );
+      live[i]->Release();
     }
-}
\ No newline at end of file
+    CollectGarbage();
+}
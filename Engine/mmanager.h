@@ -25,13 +25,17 @@ class IMMObject
     void* operator new( size_t size );
     void operator delete( void* obj );
 
-    static std::list<IMMObject*> heapObjects;
+    // true if p was returned by IMMObject::operator new and not freed yet
+    static bool IsHeapBlock( void* p );
+    // times allocation/release cycles against a growing number of live objects
+    static void Benchmark( int maxLiveObjects, int cycles );
+
     static unsigned long heapUsage;
-    unsigned long heapAllocSize;
     bool bIsStackAllocated;
 
     static int newNum;
     static int deleteNum;
+    static int poolHits;
 };
 
 #define AUTO_SIZE unsigned long size(){return sizeof(*this);}
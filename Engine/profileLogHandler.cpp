@@ -42,6 +42,14 @@ void CProfileLogHandler::Sample( float fMin, float fAvg, float fMax, float tAvg,
     APPLOG.Write( "%5s : %5s : %5s : %5s : %3s : %s", min, avg, max, time, num, indentedName );
 }
 
+void CProfileLogHandler::Utilization( float tWall, float tBusy, int jobCount, int threads, std::string name )
+{
+    // 100% means every thread was busy for the whole phase
+    float fUsed = ( tWall > 0.0f ) ? tBusy / ( tWall * threads ) * 100.0f : 0.0f;
+
+    APPLOG.Write( "  Jobs: %5.1f%% of %i threads : %5.2f ms : %3d jobs : %s", fUsed, threads, tWall, jobCount, name.c_str() );
+}
+
 void CProfileLogHandler::EndOutput()
 {
     APPLOG.Write( "\n" );
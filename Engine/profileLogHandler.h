@@ -17,6 +17,7 @@ class CProfileLogHandler : public IProfilerOutputHandler
     virtual void BeginOutput( float tTime );
     virtual void EndOutput();
     virtual void Sample( float fMin, float fAvg, float fMax, float tAvg, int callCount, std::string name, int parentCount );
+    virtual void Utilization( float tWall, float tBusy, int jobCount, int threads, std::string name );
 };
 
 #endif // !defined(AFX_PROFILELOGHANDLER_H__CAD57C2F_2BF7_492C_8ED3_EFE606EF3EAC__INCLUDED_)
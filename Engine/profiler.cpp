@@ -8,104 +8,291 @@ int CProfileSample::lastOpenedSample = -1;
 int CProfileSample::openSampleCount = 0;
 CProfileSample::profileSample CProfileSample::samples[MAX_PROFILER_SAMPLES];
 IProfilerOutputHandler* CProfileSample::outputHandler = 0;
-float CProfileSample::rootBegin = 0.0f;
-float CProfileSample::rootEnd = 0.0f;
+ProfileTime CProfileSample::rootBegin = 0;
+ProfileTime CProfileSample::rootEnd = 0;
 bool CProfileSample::bProfilerIsRunning = true;
+CJobLock CProfileSample::registerLock;
+CProfileSample::profileThread CProfileSample::threads[MAX_PROFILER_THREADS];
+int CProfileSample::captureFrames = 0;
+ProfileTime CProfileSample::captureBegin = 0;
+std::string CProfileSample::captureFilename;
 
-CProfileSample::CProfileSample( std::string sampleName )
+CProfileSample::CProfileSample( SProfileZone& zone )
 {
+    iSampleIndex = -1;
     if ( !bProfilerIsRunning )
     {
       return;
     }
-    //find the sample
-    int i = 0;
-    int storeIndex = -1;
-    for ( i = 0; i < MAX_PROFILER_SAMPLES; ++i )
+    //the call site looks its sample up once
+    if ( zone.index < 0 )
     {
-      if ( !samples[i].bIsValid )
-      {
-        if ( storeIndex < 0 )
-        {
-          storeIndex = i;
-        }
-      }
-      else
+      zone.index = RegisterZone( zone.name );
+      if ( zone.index < 0 )
       {
-        if ( samples[i].name == sampleName )
-        {
-          //this is the sample we want
-          //check that it's not already open
-          assert( !samples[i].bIsOpen && "Tried to profile a sample which was already being profiled" );
-          //first, store it's index
-          iSampleIndex = i;
-          //the parent sample is the last opened sample
-          iParentIndex = lastOpenedSample;
-          lastOpenedSample = i;
-          samples[i].parentCount = openSampleCount;
-          ++openSampleCount;
-          samples[i].bIsOpen = true;
-          ++samples[i].callCount;
-          samples[i].startTime = GetTime();
-          //if this has no parent, it must be the 'main loop' sample, so do the global timer
-          if ( iParentIndex < 0 )
-          {
-            rootBegin = samples[i].startTime;
-          }
-          return;
-        }
+        return;
       }
     }
-    //we've not found it, so it must be a new sample
-    //use the storeIndex value to store the new sample
-    assert( storeIndex >= 0 && "Profiler has run out of sample slots!" );
-    samples[storeIndex].bIsValid = true;
-    samples[storeIndex].name = sampleName;
-    iSampleIndex = storeIndex;
+
+    iSampleIndex = zone.index;
+    iThread = ThreadIndex();
+    startTime = GetTime();
+
+    //only the main thread's zones nest into a frame
+    if ( iThread != 0 )
+    {
+      return;
+    }
+
+    profileSample& sample = samples[iSampleIndex];
+    //check that it's not already open
+    assert( !sample.bIsOpen && "Tried to profile a sample which was already being profiled" );
+    //the parent sample is the last opened sample
     iParentIndex = lastOpenedSample;
-    lastOpenedSample = storeIndex;
-    samples[i].parentCount = openSampleCount;
-    openSampleCount++;
-    samples[storeIndex].bIsOpen = true;
-    samples[storeIndex].callCount = 1;
-
-    samples[storeIndex].totalTicks = 0.0f;
-    samples[storeIndex].childTime = 0.0f;
-    samples[storeIndex].startTime = GetTime();
+    lastOpenedSample = iSampleIndex;
+    sample.parentCount = openSampleCount;
+    ++openSampleCount;
+    sample.bIsOpen = true;
+    ++sample.callCount;
+    sample.startTime = startTime;
+    //if this has no parent, it must be the 'main loop' sample, so do the global timer
     if ( iParentIndex < 0 )
     {
-      rootBegin = samples[storeIndex].startTime;
+      rootBegin = startTime;
     }
 }
 
 CProfileSample::~CProfileSample()
 {
-    if ( !bProfilerIsRunning )
+    if ( iSampleIndex < 0 )
+    {
+      return;
+    }
+    ProfileTime endTime = GetTime();
+    Trace( iThread, iSampleIndex, startTime, endTime );
+
+    if ( iThread != 0 )
     {
       return;
     }
-    float fEndTime = GetTime();
+
     //phew... ok, we're done timing
     samples[iSampleIndex].bIsOpen = false;
     //calculate the time taken this profile, for ease of use later on
-    float fTimeTaken = fEndTime - samples[iSampleIndex].startTime;
+    ProfileTime timeTaken = endTime - startTime;
 
     if ( iParentIndex >= 0 )
     {
-      samples[iParentIndex].childTime += fTimeTaken;
+      samples[iParentIndex].childTime += timeTaken;
     }
     else
     {
       //no parent, so this is the end of the main loop sample
-      rootEnd = fEndTime;
+      rootEnd = endTime;
     }
-    samples[iSampleIndex].totalTicks += fTimeTaken;
+    samples[iSampleIndex].totalTicks += timeTaken;
     lastOpenedSample = iParentIndex;
     --openSampleCount;
 }
 
+s32 CProfileSample::RegisterZone( const c8* name, bool traceOnly )
+{
+    // two threads may get to a call site for the first time together
+    registerLock.Lock();
+
+    s32 found = -1, storeIndex = -1;
+    for ( int i = 0; i < MAX_PROFILER_SAMPLES; ++i )
+    {
+      if ( !samples[i].bIsValid )
+      {
+        if ( storeIndex < 0 )
+        {
+          storeIndex = i;
+        }
+      }
+      else if ( samples[i].name == name )
+      {
+        found = i;
+        break;
+      }
+    }
+
+    if ( ( found < 0 ) && ( storeIndex >= 0 ) )
+    {
+      profileSample& sample = samples[storeIndex];
+      sample.bIsValid = true;
+      sample.bTraceOnly = traceOnly;
+      sample.bIsOpen = false;
+      sample.name = name;
+      sample.callCount = 0;
+      sample.totalTicks = sample.childTime = 0;
+      sample.parentCount = 0;
+      found = storeIndex;
+    }
+
+    registerLock.Unlock();
+
+    assert( ( found >= 0 || traceOnly ) && "Profiler has run out of sample slots!" );
+    return found;
+}
+
+int CProfileSample::ThreadIndex()
+{
+    return KERNEL.Jobs().Self();
+}
+
+ProfileTime CProfileSample::GetTime()
+{
+#ifdef WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    if ( !frequency.QuadPart )
+    {
+      QueryPerformanceFrequency( &frequency );
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+    ProfileTime ticks = counter.QuadPart, rate = frequency.QuadPart;
+    // split so the multiply does not overflow
+    return ( ticks / rate ) * 1000000000 + ( ticks % rate ) * 1000000000 / rate;
+#else
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( ProfileTime )now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+void CProfileSample::Trace( s32 zone, ProfileTime begin, ProfileTime end )
+{
+    if ( bProfilerIsRunning && ( zone >= 0 ) )
+    {
+      Trace( ThreadIndex(), zone, begin, end );
+    }
+}
+
+void CProfileSample::Trace( int thread, s32 zone, ProfileTime begin, ProfileTime end )
+{
+    profileThread& t = threads[thread];
+    if ( !t.events )
+    {
+      t.events = new profileEvent[PROFILER_EVENTS];
+    }
+
+    profileEvent& e = t.events[t.written % PROFILER_EVENTS];
+    e.zone = zone;
+    e.begin = begin;
+    e.end = end;
+    // the event is complete before it counts
+    t.written++;
+}
+
+bool CProfileSample::Capture( int frames, const c8* filename )
+{
+#ifndef PROFILER
+    APPLOG.Write( "Profiler: not built with PROFILER, nothing to capture" );
+    return false;
+#else
+    if ( captureFrames > 0 )
+    {
+      return false;
+    }
+
+    captureFrames = max( frames, 1 );
+    captureFilename = filename;
+    captureBegin = GetTime();
+    return true;
+#endif
+}
+
+static void WriteJsonString( FILE* pFile, const char* str )
+{
+    fputc( '"', pFile );
+    for ( ; *str; str++ )
+    {
+      if ( ( *str == '"' ) || ( *str == '\\' ) )
+      {
+        fputc( '\\', pFile );
+      }
+      fputc( *str, pFile );
+    }
+    fputc( '"', pFile );
+}
+
+void CProfileSample::WriteTrace()
+{
+    FILE* pFile = fopen( captureFilename.c_str(), "w" );
+    if ( pFile == NULL )
+    {
+      APPLOG.Write( "Profiler: could not write '%s'", captureFilename.c_str() );
+      return;
+    }
+
+    int eventsNum = 0, lostThreads = 0;
+    bool bFirst = true;
+    fprintf( pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    for ( int t = 0; t < MAX_PROFILER_THREADS; t++ )
+    {
+      if ( !threads[t].events )
+      {
+        continue;
+      }
+
+      fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", bFirst ? "" : ",\n", t );
+      bFirst = false;
+      char threadName[32];
+      if ( t == 0 )
+      {
+        strcpy( threadName, "main" );
+      }
+      else
+      {
+        sprintf( threadName, "job worker %i", t );
+      }
+      WriteJsonString( pFile, threadName );
+      fprintf( pFile, "}}" );
+
+      // the workers are idle between frames, nothing is written meanwhile
+      long written = threads[t].written;
+      long first = max( written - PROFILER_EVENTS, 0L );
+      if ( ( first > 0 ) && ( threads[t].events[first % PROFILER_EVENTS].begin > captureBegin ) )
+      {
+        lostThreads++;
+      }
+
+      for ( long i = first; i < written; i++ )
+      {
+        profileEvent& e = threads[t].events[i % PROFILER_EVENTS];
+        if ( e.begin < captureBegin )
+        {
+          continue;
+        }
+
+        fprintf( pFile, ",\n{\"name\":" );
+        WriteJsonString( pFile, samples[e.zone].name.c_str() );
+        // microseconds, with the nanoseconds as decimals
+        fprintf( pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}", t, ( double )( e.begin - captureBegin ) / 1000.0, ( double )( e.end - e.begin ) / 1000.0 );
+        eventsNum++;
+      }
+    }
+    fprintf( pFile, "\n]}\n" );
+    fclose( pFile );
+
+    APPLOG.Write( "Profiler: %i events of %.2f ms written to '%s'", eventsNum, ( double )( GetTime() - captureBegin ) / 1000000.0, captureFilename.c_str() );
+    if ( lostThreads )
+    {
+      APPLOG.Write( "Profiler: %i threads wrote more than %i events, the capture starts late for them", lostThreads, PROFILER_EVENTS );
+    }
+}
+
 void CProfileSample::Output()
 {
+    if ( captureFrames > 0 )
+    {
+      if ( --captureFrames == 0 )
+      {
+        WriteTrace();
+      }
+    }
+
     if ( !bProfilerIsRunning )
     {
       return;
@@ -113,16 +300,22 @@ void CProfileSample::Output()
 
     assert( outputHandler && "Profiler has no output handler set" );
 
-    outputHandler->BeginOutput( rootEnd - rootBegin );
+    float rootTime = ( float )( rootEnd - rootBegin ) / 1000000000.0f;
+    if ( rootTime <= 0.0f )
+    {
+      return;
+    }
+
+    outputHandler->BeginOutput( rootTime );
 
     for ( int i = 0; i < MAX_PROFILER_SAMPLES; ++i )
     {
-      if ( samples[i].bIsValid )
+      if ( samples[i].bIsValid && !samples[i].bTraceOnly )
       {
         float sampleTime, percentage;
         //calculate the time spend on the sample itself (excluding children)
-        sampleTime = samples[i].totalTicks - samples[i].childTime;
-        percentage = ( sampleTime / ( rootEnd - rootBegin ) ) * 100.0f;
+        sampleTime = ( float )( samples[i].totalTicks - samples[i].childTime ) / 1000000000.0f;
+        percentage = ( sampleTime / rootTime ) * 100.0f;
 
         //add it to the sample's values
         float totalPc;
@@ -148,6 +341,8 @@ void CProfileSample::Output()
       }
     }
 
+    KERNEL.Jobs().OutputUtilization( outputHandler );
+
     outputHandler->EndOutput();
 }
 
@@ -169,16 +364,13 @@ void CProfileSample::ResetSample( std::string strName )
 
 void CProfileSample::ResetAll()
 {
+    // the samples stay registered, call sites keep their indices
     for ( int i = 0; i < MAX_PROFILER_SAMPLES; ++i )
     {
       if ( samples[i].bIsValid )
       {
         samples[i].maxPc = samples[i].minPc = -1;
         samples[i].dataCount = 0;
-        if ( !samples[i].bIsOpen )
-        {
-          samples[i].bIsValid = false;
-        }
       }
     }
-}
\ No newline at end of file
+}
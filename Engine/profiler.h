@@ -2,23 +2,63 @@
 #define PROFILER_H_INCLUDED
 
 #include "misc.h"
+#include "jobs.h"
 
 #define MAX_PROFILER_SAMPLES 50
+// trace events kept per thread, the oldest are overwritten
+#define PROFILER_EVENTS 8192
+// the main thread and the job workers
+#define MAX_PROFILER_THREADS ( MAX_JOB_WORKERS + 1 )
+
+// nanoseconds, only differences are meaningful
+#ifdef _MSC_VER
+typedef unsigned __int64 ProfileTime;
+#else
+typedef unsigned long long ProfileTime;
+#endif
 
 class IProfilerOutputHandler;
 class CProfileSample;
 
+// one per PROFILE() call site, index is -1 until the first time it runs
+struct SProfileZone
+{
+    const c8* name;
+    s32 index;
+};
+
+////////////////////////////////////////////
+// CProfileSample
+// - a zone is looked up by the index its call site registered, not by name
+// - the main thread adds up min/avg/max per zone for the output handler
+// - every thread writes its zones to its own ring of trace events, Capture()
+//   saves the next frames of them as Chrome trace event JSON, to open in
+//   chrome://tracing or Perfetto
+// - zones run under the kernel, the thread is the job system's
+////////////////////////////////////////////
+
 class CProfileSample
 {
   public:
-    CProfileSample( std::string sampleName );
-    virtual ~CProfileSample();
+    CProfileSample( SProfileZone& zone );
+    ~CProfileSample();
 
     static void Output();
 
     static void ResetSample( std::string sampleName );
     static void ResetAll();
 
+    // traceOnly zones are left out of the output handler, like jobs that
+    // are timed with Trace()
+    static s32 RegisterZone( const c8* name, bool traceOnly = false );
+    // a finished zone of the calling thread
+    static void Trace( s32 zone, ProfileTime begin, ProfileTime end );
+
+    // writes the trace of the next frames to filename, false if a capture is running
+    static bool Capture( int frames, const c8* filename );
+
+    static ProfileTime GetTime();
+
     static IProfilerOutputHandler* outputHandler;
 
     static bool bProfilerIsRunning;
@@ -27,29 +67,32 @@ class CProfileSample
     //index into the array of samples
     int iSampleIndex;
     int iParentIndex;
+    int iThread;
+    ProfileTime startTime;
 
-    inline float GetTime()
-    {
-        return ( ( float ) getPreciseTime() ) / 1000.0f;
-    }
+    static int ThreadIndex();
+    static void Trace( int thread, s32 zone, ProfileTime begin, ProfileTime end );
+    static void WriteTrace();
 
     static struct profileSample
     {
         profileSample()
         {
             bIsValid = false;
+            bTraceOnly = false;
             dataCount = 0;
             averagePc = minPc = maxPc = -1;
         }
 
         bool bIsValid;      //whether or not this sample is valid (for use with fixed-size arrays)
+        bool bTraceOnly;    //timed by Trace() only, not shown by the output handler
         bool bIsOpen;       //is this sample currently being profiled?
         unsigned int callCount; //number of times this sample has been profiled this frame
         std::string name;   //name of the sample
 
-        float startTime;    //starting time on the clock, in seconds
-        float totalTicks;   //total time recorded across all profiles of this sample
-        float childTime;    //total time taken by children of this sample
+        ProfileTime startTime;  //starting time on the clock
+        ProfileTime totalTicks; //total time recorded across all profiles of this sample
+        ProfileTime childTime;  //total time taken by children of this sample
 
         int parentCount;    //number of parents this sample has (useful for indenting)
 
@@ -60,7 +103,25 @@ class CProfileSample
     } samples[MAX_PROFILER_SAMPLES];
     static int lastOpenedSample;
     static int openSampleCount;
-    static float rootBegin, rootEnd;
+    static ProfileTime rootBegin, rootEnd;
+    static CJobLock registerLock;
+
+    struct profileEvent
+    {
+        s32 zone;
+        ProfileTime begin, end;
+    };
+
+    // written only by its own thread
+    static struct profileThread
+    {
+        profileEvent* events;
+        volatile long written;
+    } threads[MAX_PROFILER_THREADS];
+
+    static int captureFrames;
+    static ProfileTime captureBegin;
+    static std::string captureFilename;
 };
 
 class IProfilerOutputHandler
@@ -69,10 +130,14 @@ class IProfilerOutputHandler
     virtual void BeginOutput( float tTotal ) = 0;
     virtual void Sample( float fMin, float fAvg, float fMax, float tAvg, int callCount, std::string name, int parentCount ) = 0;
     virtual void EndOutput() = 0;
+    // a job system phase, busy is the time all threads spent on its jobs
+    virtual void Utilization( float tWall, float tBusy, int jobCount, int threads, std::string name )
+    {
+    }
 };
 
 #ifdef PROFILER
-#define PROFILE(name) CProfileSample _profile_sample(name);
+#define PROFILE(name) static SProfileZone _profile_zone = { name, -1 }; CProfileSample _profile_sample( _profile_zone );
 #else
 #define PROFILE(name)
 #endif
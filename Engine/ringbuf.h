@@ -60,6 +60,20 @@ class ringbuffer
         }
         return wc - read - 1;
     }
+    // the entry pushed age pushes before the newest, NULL past the oldest
+    T* peek( unsigned long age )
+    {
+        if ( age >= dataSize() )
+        {
+          return NULL;
+        }
+        long i = write - 1 - ( long )age;
+        while ( i < 0 )
+        {
+          i += bufSize;
+        }
+        return &buf[i];
+    }
     void flood( const T& value )
     {
         //loop through all indices, flooding them
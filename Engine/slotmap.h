@@ -0,0 +1,163 @@
+#ifndef SLOTMAP_H_INCLUDED
+#define SLOTMAP_H_INCLUDED
+
+////////////////////////////////////////////
+// CSlotMap
+// - items live in a dense array for fast iteration, removal is swap-and-pop
+// - handles stay valid while other items are added and removed, a handle to
+//   a removed item is detected by its generation
+////////////////////////////////////////////
+
+struct SSlotHandle
+{
+    SSlotHandle()
+    {
+        index = -1; generation = 0;
+    }
+
+    bool isValid() const
+    {
+        return ( index >= 0 );
+    }
+
+    bool operator ==( const SSlotHandle& h ) const
+    {
+        return ( index == h.index ) && ( generation == h.generation );
+    }
+
+    s32 index;
+    u32 generation;
+};
+
+template <class T>
+class CSlotMap
+{
+  public:
+    CSlotMap()
+    {
+        freeSlot = -1;
+    }
+
+    SSlotHandle Add( const T& item )
+    {
+        s32 s;
+        if ( freeSlot >= 0 )
+        {
+          s = freeSlot;
+          freeSlot = slots[s].nextFree;
+        }
+        else
+        {
+          SSlot slot;
+          slot.generation = 0;
+          slots.push_back( slot );
+          s = slots.size() - 1;
+        }
+
+        slots[s].dense = dense.size();
+        slots[s].nextFree = -1;
+        dense.push_back( item );
+        denseToSlot.push_back( s );
+
+        SSlotHandle h;
+        h.index = s;
+        h.generation = slots[s].generation;
+        return h;
+    }
+
+    // moves the last item into the removed one's place
+    bool Remove( const SSlotHandle& h )
+    {
+        if ( !Contains( h ) )
+        {
+          return false;
+        }
+
+        s32 d = slots[h.index].dense;
+        s32 last = dense.size() - 1;
+        if ( d != last )
+        {
+          dense[d] = dense[last];
+          denseToSlot[d] = denseToSlot[last];
+          slots[denseToSlot[d]].dense = d;
+        }
+        dense.erase( last );
+        denseToSlot.erase( last );
+
+        slots[h.index].generation++;
+        slots[h.index].dense = -1;
+        slots[h.index].nextFree = freeSlot;
+        freeSlot = h.index;
+        return true;
+    }
+
+    bool Contains( const SSlotHandle& h ) const
+    {
+        return ( h.index >= 0 ) && ( h.index < ( s32 )slots.size() ) && ( slots[h.index].generation == h.generation ) && ( slots[h.index].dense >= 0 );
+    }
+
+    // NULL if the handle is stale
+    T* Get( const SSlotHandle& h )
+    {
+        if ( !Contains( h ) )
+        {
+          return NULL;
+        }
+        return &dense[slots[h.index].dense];
+    }
+
+    // position in the dense array, -1 if the handle is stale
+    s32 GetIndex( const SSlotHandle& h ) const
+    {
+        if ( !Contains( h ) )
+        {
+          return -1;
+        }
+        return slots[h.index].dense;
+    }
+
+    void clear()
+    {
+        // bump generations so old handles stay invalid
+        freeSlot = -1;
+        for ( s32 i = slots.size() - 1; i >= 0; i-- )
+        {
+          slots[i].generation++;
+          slots[i].dense = -1;
+          slots[i].nextFree = freeSlot;
+          freeSlot = i;
+        }
+        dense.clear();
+        denseToSlot.clear();
+    }
+
+    u32 size() const
+    {
+        return dense.size();
+    }
+
+    T& operator []( u32 i )
+    {
+        return dense[i];
+    }
+
+    const T& operator []( u32 i ) const
+    {
+        return dense[i];
+    }
+
+  private:
+    struct SSlot
+    {
+        s32 dense;
+        u32 generation;
+        s32 nextFree;
+    };
+
+    array<T> dense;
+    array<s32> denseToSlot;
+    array<SSlot> slots;
+    s32 freeSlot;
+};
+
+#endif
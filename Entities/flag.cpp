@@ -14,8 +14,7 @@ CFlag::CFlag( const c8* scriptFilename )
 
     if ( scriptFilename != "" )
     {
-      Load( scriptFilename );
-      Unserialize( loadedBitStream );
+      LoadConfig( scriptFilename );
     }
 }
 
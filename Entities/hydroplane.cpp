@@ -1,5 +1,6 @@
 #include "hydroplane.h"
 #include "../World/calc.h"
+#include "../Effects/effectpool.h"
 
 
 ////////////////////////////////////////////
@@ -18,8 +19,7 @@ CHydroplane::CHydroplane( const c8* scriptFilename ) : CMachine( scriptFilename
 
     if ( scriptFilename != "" ) // this is server
     {
-      Load( scriptFilename );
-      Unserialize( loadedBitStream );
+      LoadConfig( scriptFilename );
       //attach weapon
       LoadAttachment( "scriptweapon", WeaponScriptName.c_str() );
     }
@@ -247,7 +247,26 @@ void CHydroplane::Think()
         //vector3df vAng(0.000001f, 0.000001f, 0.000001f );
         //NewtonBodySetAngularDamping( body, &vAng.X );
       }
+    }
+
+    // the engine sound and propeller follow the thrust here, PhysicsControl()
+    // runs in the physics step
+    if ( fThrustValue > 0.0f )
+    {
+      if ( !engineSound->isPlaying() )
+      {
+        engineSound->play();
+      }
+
+      propellerSprite->setSpeed( 3 );
+      propellerSprite->setStartEndFrame( 0, 10 );
+    }
+    else
+    {
       engineSound->pause();
+
+      propellerSprite->setSpeed( 7 );
+      propellerSprite->setStartEndFrame( 12, 13 );
     }
 
     windSound->setVolume( fVelocity / WINDSOUND_FACTOR );
@@ -422,17 +441,9 @@ void CHydroplane::PhysicsControl()
 
       if ( KERNEL.GetTicks() % 15 == 0 )
       {
-        FACTORY->Effects.Create( "beam", vLastTrailPos, getPosition(), 0.0f, 1.0f, 60 );
+        CNewton::FromBody( body )->QueueEffect( "beam", vLastTrailPos, getPosition(), 0.0f, 1.0f, 60 );
         vLastTrailPos = getPosition();
       }
-
-      if ( !engineSound->isPlaying() )
-      {
-        engineSound->play();
-      }
-
-      propellerSprite->setSpeed( 3 );
-      propellerSprite->setStartEndFrame( 0, 10 );
     }
     else                                                // ---------- engine OFF
     {
@@ -443,11 +454,6 @@ void CHydroplane::PhysicsControl()
         //vector3df vAng(0.0000001f, 0.0000001f, 0.0000001f );
         //NewtonBodySetAngularDamping( body, &vAng.X );
       }
-
-      engineSound->pause();
-
-      propellerSprite->setSpeed( 7 );
-      propellerSprite->setStartEndFrame( 12, 13 );
     }
 
     if ( control )
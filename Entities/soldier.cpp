@@ -3,6 +3,7 @@
 #include "../IrrConsole/console_vars.h"
 
 #include "../World/world.h"
+#include "../Effects/effectpool.h"
 
 ////////////////////////////////////////////
 // CSoldier 
@@ -12,6 +13,11 @@
 #define CMENU_DROPWEAPON 1
 #define CMENU_DROPITEM 2
 
+// contacts with the map looked at in one predicted step
+#define PREDICT_CONTACTS 16
+// what CCharacter::PhysicsCollision() sets the ground friction to when standing
+#define PREDICT_GROUND_FRICTION 2.0f
+
 bool bRegistered_CSoldier = FACTORY->Actors.Register<CSoldier>( "soldier" );
 
 CSoldier::CSoldier( const c8* configFilename ) : CCharacter( configFilename )
@@ -22,8 +28,7 @@ CSoldier::CSoldier( const c8* configFilename ) : CCharacter( configFilename )
     if ( configFilename != "" )
     {
       //CONSOLE.addx( "soldier");
-      Load( configFilename );
-      Unserialize( loadedBitStream );
+      LoadConfig( configFilename );
     }
 }
 
@@ -198,7 +203,7 @@ void CSoldier::PhysicsControl()
 		  {
 			  vector3df jetPos = getPosition();
 			  jetPos.Y += 1.0f;
-			  FACTORY->Effects.Create( "machinehit", jetPos, jetPos, 0.0f, 2.5f, 30 );
+			  CNewton::FromBody( body )->QueueEffect( "machinehit", jetPos, jetPos, 0.0f, 2.5f, 30 );
 		  }
         }
 
@@ -299,6 +304,111 @@ void CSoldier::PhysicsControl()
     bOnGround = false;
 }
 
+// the forces of PhysicsApplyForceAndTorque() and PhysicsControl() without the
+// solver: the map's contacts stop what goes into them and push the hull out,
+// the other bodies are not looked at
+bool CSoldier::PredictStep( u16 actionKeys, f32 dt, vector3df& vPos, vector3df& vVel )
+{
+    if ( parentAttachment || !body || !control )
+    {
+      return false;
+    }
+
+    dFloat mass, Ixx, Iyy, Izz;
+    NewtonBodyGetMassMatrix( body, &mass, &Ixx, &Iyy, &Izz );
+    if ( mass <= 0.0f )
+    {
+      return false;
+    }
+
+    matrix4 matrix;
+    NewtonBodyGetMatrix( body, &matrix.M[0] );
+    matrix.setTranslation( vPos );
+
+    vector3df contacts[PREDICT_CONTACTS], normals[PREDICT_CONTACTS];
+    f32 penetrations[PREDICT_CONTACTS];
+    s32 num = CNewton::FromBody( body )->StaticContacts( NewtonBodyGetCollision( body ), matrix, contacts, normals, penetrations, PREDICT_CONTACTS );
+
+    // a contact past the center is the ground, as in CCharacter::PhysicsCollision()
+    bool bGround = false;
+    vector3df vGround( 0.0f, -1.0f, 0.0f );
+    s32 i, deepest = -1;
+    for ( i = 0; i < num; i++ )
+    {
+      if ( contacts[i].Y > vPos.Y )
+      {
+        bGround = true;
+        vGround = normals[i];
+      }
+      if ( ( deepest < 0 ) || ( penetrations[i] > penetrations[deepest] ) )
+      {
+        deepest = i;
+      }
+    }
+
+    vector3df vForce( 0.0f, mass * CNewton::dGravity * IrrToNewton, 0.0f );
+    if ( actionKeys & ( 1 << AK_FIRE2 ) )
+    {
+      vForce.Y += fJumpForce;
+    }
+
+    bool bMoving = false;
+    f32 fSpeed = vVel.getLength();
+    vector3df vRun;
+    if ( actionKeys & ( 1 << AK_MOVE_LEFT ) )
+    {
+      bMoving = true;
+      vRun = vGround * fRunForce;
+      vRun.rotateXYBy( -90, vector3df( 0, 0, 0 ) );
+      vRun.X = -fabs( vRun.X );
+      if ( ( fSpeed < fMaxSpeed ) || ( !bGround ) )
+      {
+        vForce += vRun;
+      }
+    }
+    if ( actionKeys & ( 1 << AK_MOVE_RIGHT ) )
+    {
+      bMoving = true;
+      vRun = vGround * fRunForce;
+      vRun.rotateXYBy( 90, vector3df( 0, 0, 0 ) );
+      vRun.X = fabs( vRun.X );
+      if ( ( fSpeed < fMaxSpeed ) || ( !bGround ) )
+      {
+        vForce += vRun;
+      }
+    }
+
+    vVel += vForce * ( dt / mass );
+    vVel *= 1.0f - min( NewtonBodyGetLinearDamping( body ) * dt, 1.0f );
+
+    for ( i = 0; i < num; i++ )
+    {
+      f32 into = vVel.dotProduct( normals[i] );
+      if ( into < 0.0f )
+      {
+        vVel -= normals[i] * into;
+      }
+    }
+
+    // standing still the ground holds it, running it has no friction
+    if ( bGround && !bMoving )
+    {
+      vector3df vSlide = vVel - vGround * vVel.dotProduct( vGround );
+      f32 fSlide = vSlide.getLength();
+      f32 fStop = PREDICT_GROUND_FRICTION * fabs( CNewton::dGravity * IrrToNewton ) * dt;
+      vVel -= ( fSlide > fStop ) ? vSlide * ( fStop / fSlide ) : vSlide;
+    }
+
+    // bFix2DPos
+    vVel.Z = 0.0f;
+    vPos += vVel * dt;
+    if ( deepest >= 0 )
+    {
+      vPos += normals[deepest] * penetrations[deepest];
+    }
+    return true;
+}
+
 
 void CSoldier::Load( const c8* filename )
 {
@@ -20,6 +20,8 @@ class CSoldier : public CCharacter
 
     virtual void Unserialize( RakNet::BitStream& bt );
 
+    virtual bool PredictStep( u16 actionKeys, f32 dt, vector3df& vPos, vector3df& vVel );
+
   protected:
     virtual void Load( const c8* filename );
 
@@ -8,36 +8,10 @@
 #include "../IrrConsole/console_vars.h"
 #include "../World/world.h"
 #include "../Newton/newton_node.h"
+#include "../Engine/misc.h"
 
 #define MAX_SND_DIST 600.0f*IrrToSL
 
-inline String fileVariation( const char* strFile )
-{
-    String file;
-    int rnum = 10;
-
-    file = strFile;
-    for ( int i = 0; i < file.size(); i++ )
-    {
-      if ( file[i] == '?' )
-      {
-        while ( 1 )
-        {
-          file = strFile;
-          file[i] = 48 + random( rnum );
-          //CONSOLE.add( file.c_str() );
-          if ( fileExists2( file.c_str() ) )
-          {
-            return APP.useFile( file.c_str() );
-          }
-          rnum = file[i] - 48;
-        }
-      }
-    }
-
-    return APP.useFile( strFile );
-}
-
 // ##############################
 // ## CSoundListenerEnvironment ##
 // ##############################
@@ -72,13 +46,15 @@ void CSoundListenerEnvironment::loadEnvironmentFromData( const char* strData, un
 
 CSoundObject::CSoundObject( const char* strFile )
 {
-    obj = fslLoadSound( fileVariation( strFile ).c_str() );
+    obj = SOUND.createSound( strFile );
+    ownsBuffer = false;
     recheckDie = 0;
 }
 
 CSoundObject::CSoundObject( FSLsound p )
 {
     obj = p;
+    ownsBuffer = true;
     recheckDie = 0;
 }
 
@@ -88,7 +64,7 @@ CSoundObject::~CSoundObject()
     {
       if ( SOUND.initialised )
       {
-        fslFreeSound( obj, true );
+        fslFreeSound( obj, ownsBuffer );
       }
     }
     obj = 0;
@@ -430,11 +406,13 @@ CSoundEngine::CSoundEngine()
     CONSOLE_VAR( "s_soundon", int, on, 1, L"s_soundon [0/1]. Ex. s_soundon 1", L"Determines if the sound engine starts or not. Requires restart to turn sound on/off." );
     CONSOLE_VAR( "s_volume", float, fGain, 1.0f, L"s_volume [0.0-1.0]. Ex. s_volume 1.0", L"Sets the overall sound volume." );
     CONSOLE_VAR( "s_system", int, fSoundSystem, 2, L"s_system [0-7]. Ex. s_system 1", L"Sets the sound system (check config script for more info)." );
+    CONSOLE_VAR( "s_voices", int, voicesNum, 32, L"s_voices [1-256]. Ex. s_voices 32", L"Sets how many sounds can play at once. Requires restart." );
 
 #ifndef _CLIENT
     on = 0;
 #endif
     initialised = false;
+    currentMusic = prevMusic = NULL;
 }
 
 CSoundEngine::~CSoundEngine()
@@ -456,6 +434,17 @@ bool CSoundEngine::Start()
     currentMusic = prevMusic = NULL;
     music_interpolator = NULL;
 
+    // the sources are created the first time a voice plays
+    voicesNum = max( 1, min( voicesNum, 256 ) );
+    voices.set_used( voicesNum );
+    for ( int i = 0; i < voicesNum; i++ )
+    {
+      voices[i].sound = new CSoundObject( ( FSLsound )0 );
+      voices[i].sound->ownsBuffer = false;
+      voices[i].active = -1;
+      idleVoices.push_back( i );
+    }
+
     //currentMusic = loadSound( "Music/crimson_march.ogg" );
     //currentMusic->play();
     //currentMusic->setLooping( true );
@@ -482,6 +471,7 @@ bool CSoundEngine::Start()
 
 void CSoundEngine::NewMusic( const char* fileName, bool loop, int looppoint_begin, int looppoint_end, int fadetime, float mv )
 {
+    killSound( prevMusic );
     prevMusic = currentMusic;
     pm_looppoint_begin = cm_looppoint_begin;
     pm_looppoint_end = cm_looppoint_end;
@@ -508,11 +498,13 @@ void CSoundEngine::NewMusic( const char* fileName, bool loop, int looppoint_begi
 
 void CSoundEngine::Stop()
 {
-    for ( int i = 0; i < soundObjects.size(); i++ )
-    {
-      killSound( soundObjects[i] );
-    }
-    soundObjects.clear();
+    freeVoices();
+
+    killSound( currentMusic );
+    killSound( prevMusic );
+    currentMusic = prevMusic = NULL;
+
+    freeSamples();
 
     unloadCSoundEngine();
 
@@ -536,6 +528,7 @@ void CSoundEngine::Update()
         setListenerPosition( &vCamPos.X );
         setListenerVelocity( &vCamVel.X );
         setListenerOrientation( &vCamTarget.X, &vCamUp.X );
+        vListener = vCamPos;
       }
     }
     else
@@ -547,6 +540,7 @@ void CSoundEngine::Update()
       setListenerPosition( &vCamPos.X );
       setListenerVelocity( &vCamVel.X );
       setListenerOrientation( &vCamTarget.X, &vCamUp.X );
+      vListener = vCamPos;
     }
 
     //setListenerRolloff( 1011.0f );
@@ -554,36 +548,17 @@ void CSoundEngine::Update()
 
     //CONSOLE.addx( "Sound error: %i", fslGetError() );
 
-    while ( garbageSoundObjects.size() )
-    {
-      killSound( garbageSoundObjects[0] );
-      garbageSoundObjects.erase( 0 );
-      //if (APP.DebugMode > 1)
-      //    CONSOLE.addx("Sound object dropped, garb#%i sound#%i", garbageSoundObjects.size(), soundObjects.size() );
-    }
-
     //if (KERNEL.GetTicks() % 160)
     //  CONSOLE.addx("fslCountSoundsTotal#%i    fslGetSoundMemoryUsage#%i", fslCountSoundsTotal(), fslGetSoundMemoryUsage() );
 
-
-    int i;
-    // remove the sound if has stopped playing
+    // give back the voices that stopped playing, going backwards so the
+    // voice swapped into a freed slot has already been checked
     // TODO: Am I removing also paused sounds?
-    // TODO: delete temporarily unused obj?
-    // TODO: the sounds may be broken, only 1 sound of file plays at once now
-    for ( i = 0; i < soundObjects.size(); i++ )
+    for ( int i = activeVoices.size() - 1; i >= 0; i-- )
     {
-      //CONSOLE.addx("Sound object#%i isPaused#%i isPlaying#%i", i, 
-      //(int)soundObjects[i]->isPaused(),(int)soundObjects[i]->isPlaying());
-
-      //CONSOLE.addx("Sound object buffer #%i", soundObjects[i]->getBufferPos() );
-      //    if ( soundObjects[i]->recheckDie > 0 )
-      if ( ( soundObjects[i]->isPlaying() == 0 ) )
+      if ( !voices[activeVoices[i]].sound->isPlaying() )
       {
-        // soundObjects[i]->stop();
-        garbageSoundObjects.push_back( soundObjects[i] );
-        soundObjects.erase( i );
-        i = 0;
+        releaseVoice( activeVoices[i] );
       }
     }
 
@@ -636,32 +611,137 @@ bool CSoundEngine::unloadCSoundEngine()
     return true;
 }
 
-CSoundObject* CSoundEngine::playSound( const char* strFile )
+CSoundObject* CSoundEngine::playSound( const char* strFile, int priority )
 {
-    if ( !on )
+    CSoundObject* p = startVoice( strFile, priority, false, vector3df( 0.0f, 0.0f, 0.0f ) );
+    if ( p )
     {
-      return 0;
+      p->play();
     }
-    CSoundObject* p = loadSound( fileVariation( strFile ).c_str() );
-    p->play();
     return p;
 }
 
-CSoundObject* CSoundEngine::playSound( const char* strFile, vector3df vPosition, vector3df vVelocity, float fGain, float fPitch )
+CSoundObject* CSoundEngine::playSound( const char* strFile, vector3df vPosition, vector3df vVelocity, float fGain, float fPitch, int priority )
 {
-    CSoundObject* p = playSound( fileVariation( strFile ).c_str() );
+    vPosition = vPosition * IrrToSL;
+    CSoundObject* p = startVoice( strFile, priority, true, vPosition );
     if ( p )
     {
-      vPosition = vPosition * IrrToSL;
       vVelocity = vVelocity * IrrToSL;
       p->setPosition( &vPosition.X );
       p->setVelocity( &vVelocity.X );
       p->setGain( fGain );
       p->setPitch( fPitch );
+      p->play();
+    }
+    return p;
+}
+
+CSoundObject* CSoundEngine::startVoice( const char* strFile, int priority, bool positional, vector3df vPosition )
+{
+    if ( !on || !initialised )
+    {
+      return 0;
+    }
+
+    FSLbuffer buffer = getBuffer( strFile );
+    if ( buffer == 0 )
+    {
+      return 0;
+    }
+
+    s32 v = takeVoice( priority, positional ? vPosition.getDistanceFrom( vListener ) : 0.0f );
+    if ( v < 0 )
+    {
+      return 0;
+    }
+
+    voices[v].priority = priority;
+    voices[v].positional = positional;
+    voices[v].vPosition = vPosition;
+
+    CSoundObject* p = voices[v].sound;
+    if ( p->obj )
+    {
+      fslSetSoundBuffer( p->obj, buffer );
+    }
+    else
+    {
+      p->obj = fslCreateSoundFromBuffer( buffer );
     }
+
+    // the source still has the settings of the sound it played before
+    p->setLooping( false );
+    p->setPosition( 0.0f, 0.0f, 0.0f );
+    p->setVelocity( 0.0f, 0.0f, 0.0f );
+    p->setGain( 1.0f );
+    p->setPitch( 1.0f );
+    p->setMaxDistance( MAX_SND_DIST );
     return p;
 }
 
+s32 CSoundEngine::takeVoice( int priority, f32 distance )
+{
+    if ( idleVoices.size() == 0 )
+    {
+      // steal the least important voice, the furthest one of those
+      s32 victim = -1;
+      f32 victimDistance = 0.0f;
+      for ( u32 i = 0; i < activeVoices.size(); i++ )
+      {
+        s32 v = activeVoices[i];
+        f32 d = voiceDistance( v );
+        if ( ( victim < 0 ) || ( voices[v].priority < voices[victim].priority ) || ( ( voices[v].priority == voices[victim].priority ) && ( d > victimDistance ) ) )
+        {
+          victim = v;
+          victimDistance = d;
+        }
+      }
+
+      if ( ( victim < 0 ) || ( voices[victim].priority > priority ) || ( ( voices[victim].priority == priority ) && ( victimDistance <= distance ) ) )
+      {
+        return -1;
+      }
+
+      voices[victim].sound->stop();
+      releaseVoice( victim );
+    }
+
+    s32 v = idleVoices.getLast();
+    idleVoices.erase( idleVoices.size() - 1 );
+    voices[v].active = activeVoices.size();
+    activeVoices.push_back( v );
+    return v;
+}
+
+void CSoundEngine::releaseVoice( s32 v )
+{
+    // the last active voice fills the hole
+    s32 last = activeVoices.getLast();
+    activeVoices[voices[v].active] = last;
+    voices[last].active = voices[v].active;
+    activeVoices.erase( activeVoices.size() - 1 );
+
+    voices[v].active = -1;
+    idleVoices.push_back( v );
+}
+
+f32 CSoundEngine::voiceDistance( s32 v )
+{
+    return voices[v].positional ? voices[v].vPosition.getDistanceFrom( vListener ) : 0.0f;
+}
+
+void CSoundEngine::freeVoices()
+{
+    for ( u32 i = 0; i < voices.size(); i++ )
+    {
+      killSound( voices[i].sound );
+    }
+    voices.clear();
+    activeVoices.clear();
+    idleVoices.clear();
+}
+
 CSoundObject* CSoundEngine::getDummySound()
 {
     CSoundObject* p = new CSoundObject( fslCreateDummySound() );
@@ -670,15 +750,7 @@ CSoundObject* CSoundEngine::getDummySound()
 
 CSoundObject* CSoundEngine::loadSound( const char* strFile )
 {
-    //FSLsound* ob = fslFindSound( fileVariation( strFile ).c_str() );
-
-    //if ( !ob)
-    //{
-    //  ob = fslLoadSound( fileVariation( strFile ).c_str() );
-    //  //CONSOLE.addx( COLOR_ERROR, "Loaded sound: %s", strFile );
-    //}
-
-    FSLsound ob = fslLoadSound( fileVariation( strFile ).c_str() );
+    FSLsound ob = fslLoadSound( APP.useFile( strFile ).c_str() );
     //  CONSOLE.addx( COLOR_ERROR, "soundObjects: %s,   %i", strFile, ob );
 
     if ( ob == 0 )
@@ -690,33 +762,104 @@ CSoundObject* CSoundEngine::loadSound( const char* strFile )
       return getDummySound(); // or return null
     }
 
-    //for (int i=0; i < soundObjects.size(); i++)
-    //{
-    //  if ( soundObjects[i]->obj == ob )
-    //  {
-    //      return soundObjects[i];
-    //  }
-    //}
-
     CSoundObject* p = new CSoundObject( ob );
     p->setMaxDistance( MAX_SND_DIST );
 
-    soundObjects.push_back( p );
-
     return p;
 }
 
 void CSoundEngine::precacheSound( const char* strFile )
 {
-    if ( on )
+    if ( on && initialised )
+    {
+      getSample( strFile );
+    }
+}
+
+FSLsound CSoundEngine::createSound( const char* strFile )
+{
+    if ( !initialised )
     {
-      FSLsound ob = fslLoadSound( strFile );
+      return 0;
+    }
+
+    FSLbuffer buffer = getBuffer( strFile );
+    return buffer ? fslCreateSoundFromBuffer( buffer ) : 0;
+}
 
-      if ( ob == 0 )
+SSoundSample* CSoundEngine::getSample( const char* strFile )
+{
+    u32 hash = HashBytes( HASH_OFFSET, strFile, ( u32 )strlen( strFile ) );
+    for ( u32 i = 0; i < samples.size(); i++ )
+    {
+      if ( ( samples[i]->hash == hash ) && ( samples[i]->name == strFile ) )
       {
-        CONSOLE.addx( COLOR_ERROR, "Could not load sound: %s", strFile );
+        return samples[i];
+      }
+    }
+
+    SSoundSample* sample = new SSoundSample;
+    sample->name = strFile;
+    sample->hash = hash;
+
+    // a '?' stands for the digit of each variation that exists
+    const char* mark = strchr( strFile, '?' );
+    if ( mark )
+    {
+      String file = strFile;
+      for ( int i = 0; i < 10; i++ )
+      {
+        file[mark - strFile] = '0' + i;
+        if ( fileExists2( file.c_str() ) )
+        {
+          FSLsound ob = fslLoadSound( APP.useFile( file.c_str() ).c_str() );
+          if ( ob )
+          {
+            sample->variations.push_back( ob );
+          }
+        }
+      }
+    }
+    else
+    {
+      FSLsound ob = fslLoadSound( APP.useFile( strFile ).c_str() );
+      if ( ob )
+      {
+        sample->variations.push_back( ob );
+      }
+    }
+
+    // a sound that failed stays cached too, so it is not looked for again
+    if ( sample->variations.size() == 0 )
+    {
+      CONSOLE.addx( COLOR_ERROR, "Could not load sound: %s", strFile );
+    }
+
+    samples.push_back( sample );
+    return sample;
+}
+
+FSLbuffer CSoundEngine::getBuffer( const char* strFile )
+{
+    SSoundSample* sample = getSample( strFile );
+    if ( sample->variations.size() == 0 )
+    {
+      return 0;
+    }
+    return fslGetBufferFromSound( sample->variations[cosmeticRandom( sample->variations.size() )] );
+}
+
+void CSoundEngine::freeSamples()
+{
+    for ( u32 i = 0; i < samples.size(); i++ )
+    {
+      for ( u32 j = 0; j < samples[i]->variations.size(); j++ )
+      {
+        fslFreeSound( samples[i]->variations[j], true );
       }
+      delete samples[i];
     }
+    samples.clear();
 }
 
 void CSoundEngine::killSound( CSoundObject* p )
@@ -16,6 +16,15 @@
 
 const float IrrToSL = 0.05f;
 
+// when all voices are busy a sound takes the voice of a less important one,
+// or of an equally important one further from the listener
+enum SoundPriority
+{
+    SOUND_PRIORITY_LOW = 0,
+    SOUND_PRIORITY_NORMAL,
+    SOUND_PRIORITY_HIGH
+};
+
 class CSoundEntity;
 
 class CSoundListenerEnvironment
@@ -81,6 +90,26 @@ class CSoundObject
   protected:
     friend class CSoundEngine;
     FSLsound obj;
+    // false if the buffer belongs to the engine's sound cache
+    bool ownsBuffer;
+};
+
+// decoded sound file, a name with a '?' holds all of its numbered variations
+struct SSoundSample
+{
+    String name;
+    u32 hash;
+    array<FSLsound> variations;
+};
+
+struct SSoundVoice
+{
+    CSoundObject* sound;
+    s32 priority;
+    bool positional;
+    vector3df vPosition;
+    // index in activeVoices, -1 when free
+    s32 active;
 };
 
 #define SOUND CSoundEngine::GetSingleton()
@@ -96,11 +125,17 @@ class CSoundEngine : public ITask, public Singleton<CSoundEngine>
     virtual void Update();
     virtual void Stop();
 
-    CSoundObject* playSound( const char* strFile );
-    CSoundObject* playSound( const char* strFile, vector3df vPosition, vector3df vVelocity = vector3df(  0.0f,0.0f,0.0f), float fGain = 1.0f, float fPitch = 1.0f );
+    // the sound belongs to the engine and may be taken by another sound once it
+    // stops or when the voices run out, NULL if no voice was free
+    CSoundObject* playSound( const char* strFile, int priority = SOUND_PRIORITY_NORMAL );
+    CSoundObject* playSound( const char* strFile, vector3df vPosition, vector3df vVelocity = vector3df(  0.0f,0.0f,0.0f), float fGain = 1.0f, float fPitch = 1.0f, int priority = SOUND_PRIORITY_NORMAL );
 
+    // loads the sound into the sound cache
     void precacheSound( const char* strFile );
 
+    // a new sound source playing a cached buffer, the caller owns it
+    FSLsound createSound( const char* strFile );
+
     // listener functions
     void setListenerPosition( float* position );
     void setListenerVelocity( float* velocity );
@@ -136,11 +171,25 @@ class CSoundEngine : public ITask, public Singleton<CSoundEngine>
     CSoundObject* loadSound( const char* strFile );
     void killSound( CSoundObject* p );
 
-    array<CSoundObject*> soundObjects;
-    array<CSoundObject*> garbageSoundObjects;
+    // sound cache
+    SSoundSample* getSample( const char* strFile );
+    FSLbuffer getBuffer( const char* strFile );
+    void freeSamples();
+    array<SSoundSample*> samples;
+
+    // voice pool
+    CSoundObject* startVoice( const char* strFile, int priority, bool positional, vector3df vPosition );
+    s32 takeVoice( int priority, f32 distance );
+    void releaseVoice( s32 v );
+    f32 voiceDistance( s32 v );
+    void freeVoices();
+    array<SSoundVoice> voices;
+    array<s32> activeVoices, idleVoices;
+    vector3df vListener;
 
     float fGain;
     int fSoundSystem;
+    int voicesNum;
 
     //music
     CSoundObject* currentMusic, * prevMusic;
@@ -60,6 +60,8 @@ bool GameDLLInit( ModuleImportExport ie, int argc, char* argv[] )
     ex.serverGameProcess = serverProcess;
 #ifdef _CLIENT
     ex.clientGameProcess = clientProcess;
+#else
+    ex.clientGameProcess = NULL;
 #endif
     APP.ImportDLLPointers( ex );
 
@@ -90,9 +92,11 @@ static void SetupCVars()
     // APP
     CONSOLE_VAR( "g_debug", int, APP.DebugMode, 0, L"g_debug [0/1]. Ex. g_debug 1", L"Sets the level of debug information (0 - none)." );
     CONSOLE_VAR( "g_precache", bool, GAME.bPrecache, 0, L"g_precache [0/1]. Ex. g_precache 1", L"Are resources preloaded at game start?" );
+    CONSOLE_VAR( "g_scriptcache", bool, SCRIPT.bCache, 1, L"g_scriptcache [0/1]. Ex. g_scriptcache 0", L"Run script files from the compiled libs in the Cache directory." );
 
     // GAME
     CONSOLE_VAR( "k_goalticks", int, GAME.goalTicks, 60, L"k_goalticks [ticks]. Ex. k_goalticks 60", L"Determines how many ticks per second the game engine is running." );
+    CONSOLE_VAR( "k_workers", int, GAME.workers, 0, L"k_workers [threads]. Ex. k_workers 3", L"Number of job threads besides the main one, 0 uses one per core. Requires restart." );
 
     // NET
     CONSOLE_VAR( "n_disconnectwait", int, NET.disconnectTime, 1000, L"n_disconnectwait [ms]. Ex. n_disconnectwait 1000", L"The time to wait before truly close the communication." );
@@ -144,6 +148,7 @@ void CGame::Run( int argc, char* argv[] )
 
     kernel = new CKernel();
     kernel->SetGoalTicks( goalTicks );
+    kernel->SetWorkers( workers );
 
     tasksAdded = false;
     worldLoaded = false;
@@ -47,6 +47,7 @@ class CGame : public Singleton<CGame>, public ICApplication
     bool worldLoaded;
 
     int goalTicks;
+    int workers;
     bool bPrecache;
     bool bShaderWater;
     int shaderWaterDetail;
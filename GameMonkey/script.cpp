@@ -6,11 +6,26 @@
 #include "gmarraylib.h"
 #include "gmsystemlib.h"
 #include "gmvector3lib.h"
+#include "gmLibHooks.h"
 
 #include "../IrrConsole/console.h"
 #include "../Engine/misc.h"
 #include "scriptFunctions.h"
 
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#endif
+
+static String CacheFilename( const char* filename )
+{
+    c8 name[64];
+    sprintf( name, SCRIPTCACHE_DIR "/%08x.gmc", HashBytes( HASH_OFFSET, filename, ( u32 )strlen( filename ) ) );
+    return name;
+}
+
 CScript::CScript()
 {
     machine = new gmMachine();
@@ -23,6 +38,10 @@ CScript::CScript()
 
     deltaTime = 0;
     lastTime = getPreciseTime();
+
+    // the cvar is set up with the game's, the config scripts are cached before that
+    bCache = true;
+    cacheHits = cacheMisses = 0;
 }
 
 CScript::~CScript()
@@ -92,7 +111,14 @@ bool CScript::RunFile( WideString a_fileName )
     fclose( scriptFile );
 
     int threadId = GM_INVALID_THREAD;
-    errors = machine->ExecuteString( fileString, &threadId, true, ResultChar );
+    if ( bCache )
+    {
+      errors = ExecuteCached( ResultChar, fileString, fileSize, &threadId );
+    }
+    else
+    {
+      errors = machine->ExecuteString( fileString, &threadId, true, ResultChar );
+    }
     if ( errors )
     {
       WideString a;
@@ -110,6 +136,227 @@ bool CScript::RunFile( WideString a_fileName )
     return result;
 }
 
+void CScript::FillCacheHeader( ScriptCacheHeader& header, const char* source, u32 sourceSize )
+{
+    memset( &header, 0, sizeof( ScriptCacheHeader ) );
+    header.magic = SCRIPTCACHE_MAGIC;
+    header.version = SCRIPTCACHE_VERSION;
+    // debug libs carry line numbers
+    header.debug = machine->GetDebugMode() ? 1 : 0;
+    header.sourceHash = HashBytes( HASH_OFFSET, source, sourceSize );
+    header.sourceSize = sourceSize;
+}
+
+u8* CScript::LoadCachedLib( const char* filename, const char* source, u32 sourceSize, u32& libSize )
+{
+    FILE* pFile = fopen( CacheFilename( filename ).c_str(), "rb" );
+    if ( pFile == NULL )
+    {
+      return NULL;
+    }
+
+    ScriptCacheHeader expected, header;
+    FillCacheHeader( expected, source, sourceSize );
+    if ( fread( &header, sizeof( ScriptCacheHeader ), 1, pFile ) != 1 )
+    {
+      fclose( pFile );
+      return NULL;
+    }
+    expected.libSize = header.libSize;
+    if ( memcmp( &header, &expected, sizeof( ScriptCacheHeader ) ) || !header.libSize )
+    {
+      fclose( pFile );
+      return NULL;
+    }
+
+    u8* lib = new u8[header.libSize];
+    if ( fread( lib, header.libSize, 1, pFile ) != 1 )
+    {
+      delete[] lib;
+      fclose( pFile );
+      return NULL;
+    }
+    fclose( pFile );
+
+    libSize = header.libSize;
+    return lib;
+}
+
+void CScript::SaveCachedLib( const char* filename, const char* source, u32 sourceSize, const gmStreamBufferDynamic& lib )
+{
+#ifdef WIN32
+    CreateDirectory( SCRIPTCACHE_DIR, NULL );
+#else
+    mkdir( SCRIPTCACHE_DIR, 0755 );
+#endif
+
+    String cacheFilename = CacheFilename( filename );
+    FILE* pFile = fopen( cacheFilename.c_str(), "wb" );
+    if ( pFile == NULL )
+    {
+      APPLOG.Write( "CScript: could not write '%s'", cacheFilename.c_str() );
+      return;
+    }
+
+    ScriptCacheHeader header;
+    FillCacheHeader( header, source, sourceSize );
+    header.libSize = lib.GetSize();
+    fwrite( &header, sizeof( ScriptCacheHeader ), 1, pFile );
+    fwrite( lib.GetData(), lib.GetSize(), 1, pFile );
+    fclose( pFile );
+}
+
+int CScript::ExecuteCached( const char* filename, const char* source, u32 sourceSize, int* threadId )
+{
+    u32 libSize = 0;
+    u8* cached = LoadCachedLib( filename, source, sourceSize, libSize );
+    if ( cached )
+    {
+      gmStreamBufferStatic stream( cached, libSize );
+      bool bound = machine->ExecuteLib( stream, threadId, true, filename );
+      delete[] cached;
+      if ( bound )
+      {
+        cacheHits++;
+        return 0;
+      }
+    }
+    cacheMisses++;
+
+    gmStreamBufferDynamic lib;
+    int compileErrors = machine->CompileStringToLib( source, lib );
+    if ( compileErrors )
+    {
+      return compileErrors;
+    }
+    SaveCachedLib( filename, source, sourceSize, lib );
+
+    if ( !machine->ExecuteLib( lib, threadId, true, filename ) )
+    {
+      // should not happen, the lib was just made
+      return machine->ExecuteString( source, threadId, true, filename );
+    }
+    return 0;
+}
+
+static void ListScripts( const char* dir, array<String>& files )
+{
+#ifdef WIN32
+    String pattern = dir;
+    pattern += "/*.gm";
+    _finddata_t data;
+    long handle = _findfirst( pattern.c_str(), &data );
+    if ( handle == -1 )
+    {
+      return;
+    }
+    do
+    {
+      String name = dir;
+      name += "/";
+      name += data.name;
+      files.push_back( name );
+    }
+    while ( _findnext( handle, &data ) == 0 );
+    _findclose( handle );
+#else
+    DIR* pDir = opendir( dir );
+    if ( pDir == NULL )
+    {
+      return;
+    }
+    struct dirent* entry;
+    while ( ( entry = readdir( pDir ) ) != NULL )
+    {
+      u32 len = ( u32 )strlen( entry->d_name );
+      if ( ( len > 3 ) && !strcmp( entry->d_name + len - 3, ".gm" ) )
+      {
+        String name = dir;
+        name += "/";
+        name += entry->d_name;
+        files.push_back( name );
+      }
+    }
+    closedir( pDir );
+#endif
+}
+
+void CScript::CacheBenchmark( const char* dir, int runs )
+{
+    array<String> files;
+    ListScripts( dir, files );
+    runs = max( runs, 1 );
+
+    u32 totalSource = 0, totalCached = 0, totalSourceBytes = 0, totalLibBytes = 0;
+    int scripts = 0;
+    for ( u32 i = 0; i < files.size(); i++ )
+    {
+      FILE* pFile = fopen( files[i].c_str(), "rb" );
+      if ( pFile == NULL )
+      {
+        continue;
+      }
+      fseek( pFile, 0, SEEK_END );
+      u32 sourceSize = ( u32 )ftell( pFile );
+      fseek( pFile, 0, SEEK_SET );
+      char* source = new char[sourceSize + 1];
+      fread( source, sourceSize, 1, pFile );
+      source[sourceSize] = 0;
+      fclose( pFile );
+
+      // what ExecuteString does before it runs the script
+      u32 start = getMicroTime();
+      int compileErrors = 0;
+      for ( int run = 0; run < runs; run++ )
+      {
+        machine->CompileStringToFunction( source, &compileErrors, files[i].c_str() );
+      }
+      u32 sourceTime = getMicroTime() - start;
+      machine->GetLog().Reset();
+
+      gmStreamBufferDynamic lib;
+      if ( compileErrors || machine->CompileStringToLib( source, lib ) )
+      {
+        APPLOG.Write( "Script cache test: %s does not compile", files[i].c_str() );
+        machine->GetLog().Reset();
+        delete[] source;
+        continue;
+      }
+      SaveCachedLib( files[i].c_str(), source, sourceSize, lib );
+
+      // what ExecuteCached does on a hit, the source is still hashed
+      start = getMicroTime();
+      for ( int run = 0; run < runs; run++ )
+      {
+        u32 libSize = 0;
+        u8* cached = LoadCachedLib( files[i].c_str(), source, sourceSize, libSize );
+        if ( cached )
+        {
+          gmStreamBufferStatic stream( cached, libSize );
+          gmLibHooks::BindLib( *machine, stream, files[i].c_str() );
+          delete[] cached;
+        }
+      }
+      u32 cachedTime = getMicroTime() - start;
+
+      APPLOG.Write( "Script cache test: %s, %u bytes, %u byte lib, %.1f us compiled, %.1f us cached", files[i].c_str(), sourceSize, lib.GetSize(), ( f32 )sourceTime / runs, ( f32 )cachedTime / runs );
+
+      totalSource += sourceTime;
+      totalCached += cachedTime;
+      totalSourceBytes += sourceSize;
+      totalLibBytes += lib.GetSize();
+      scripts++;
+      delete[] source;
+    }
+
+    // the functions bound above are garbage now
+    machine->CollectGarbage( true );
+
+    APPLOG.Write( "Script cache test: %i scripts in %s, %u bytes of source, %u bytes of libs, %i runs", scripts, dir, totalSourceBytes, totalLibBytes, runs );
+    APPLOG.Write( "Script cache test: %.1f us compiled, %.1f us cached, %.2fx", ( f32 )totalSource / runs, ( f32 )totalCached / runs, totalCached ? ( f32 )totalSource / totalCached : 0.0f );
+    CONSOLE.addx( "Script cache: %i scripts %.1f us compiled, %.1f us cached (%i hits, %i misses so far)", scripts, ( f32 )totalSource / runs, ( f32 )totalCached / runs, cacheHits, cacheMisses );
+}
+
 bool CScript::Run()
 {
     if ( machine->Execute( deltaTime ) )
@@ -118,6 +365,11 @@ bool CScript::Run()
       curTime = getPreciseTime();
       deltaTime = curTime - lastTime;
       lastTime = curTime;
+      // a script runs once a tick, in lockstep a tick is always as long
+      if ( KERNEL.isLockstep() )
+      {
+        deltaTime = 1000 / max( KERNEL.GetGoalTicks(), 1 );
+      }
 
       // Dump run time errors to output
       LogErrors( "Script error: runtime" );
@@ -6,11 +6,35 @@
 #include "gmThread.h"
 #include "gmDebugger.h"
 #include "gmCallScript.h"
+#include "gmStreamBuffer.h"
 
 #include "../Engine/singleton.h"
 
 #define SCRIPT CScript::GetSingleton()
 
+#define SCRIPTCACHE_DIR "Cache"
+#define SCRIPTCACHE_MAGIC 0x434d4743 // 'CGMC'
+#define SCRIPTCACHE_VERSION 1
+
+struct ScriptCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u32 debug;
+    u32 sourceHash;
+    u32 sourceSize;
+    u32 libSize;
+};
+
+////////////////////////////////////////////
+// CScript
+// - script files are compiled once to a gm lib and kept in the Cache
+//   directory, keyed by a hash of the file name, with the hash of the
+//   source in the header
+// - as long as the source stays the same RunFile() binds the lib and skips
+//   the scanner, parser and code generator
+////////////////////////////////////////////
+
 class CScript : public Singleton<CScript>
 {
   public:
@@ -29,13 +53,27 @@ class CScript : public Singleton<CScript>
     void gmTableToStringArray( gmTableObject* a_table, array<String>& arr );
     void gmTableToStringArray( const char* a_globalTableName, array<String>& arr );
 
+    // compiles every .gm file in dir runs times from source and from the cache,
+    // nothing is executed
+    void CacheBenchmark( const char* dir, int runs );
+
     gmMachine* machine;
 
+    bool bCache;
+    int cacheHits, cacheMisses;
+
   protected:
 
   private:
     void LogErrors( WideString header );
 
+    // returns the number of errors like gmMachine::ExecuteString
+    int ExecuteCached( const char* filename, const char* source, u32 sourceSize, int* threadId );
+    // NULL if the cached lib is missing or stale, delete[] it after
+    u8* LoadCachedLib( const char* filename, const char* source, u32 sourceSize, u32& libSize );
+    void SaveCachedLib( const char* filename, const char* source, u32 sourceSize, const gmStreamBufferDynamic& lib );
+    void FillCacheHeader( ScriptCacheHeader& header, const char* source, u32 sourceSize );
+
     // for script executing
     int deltaTime, curTime, lastTime;
     int errors;
@@ -103,6 +103,27 @@ int GM_CDECL gmAddMesh( gmThread* a_thread )
     return GM_OK;
 }
 
+// SCRIPTBIND( gmBenchmarkMeshCollision, "mapBenchmarkCollision");
+int GM_CDECL gmBenchmarkMeshCollision( gmThread* a_thread )
+{
+    GM_CHECK_NUM_PARAMS( 8 ); 
+    GM_CHECK_STRING_PARAM( filename, 0 );
+    GM_CHECK_FLOAT_PARAM( px, 1 );
+    GM_CHECK_FLOAT_PARAM( py, 2 );
+    GM_CHECK_FLOAT_PARAM( pz, 3 );
+    GM_CHECK_FLOAT_PARAM( sx, 4 );
+    GM_CHECK_FLOAT_PARAM( sy, 5 );
+    GM_CHECK_FLOAT_PARAM( sz, 6 );
+    GM_CHECK_INT_PARAM( runs, 7 );
+
+    if ( WORLD.GetMap() )
+    {
+      WORLD.GetMap()->BenchmarkMeshCollision( filename, vector3df( px, py, pz ), vector3df( sx, sy, sz ), max( runs, 1 ) );
+    }
+
+    return GM_OK;
+}
+
 // SCRIPTBIND( gmAddSprite, "mapAddSprite");
 int GM_CDECL gmAddSprite( gmThread* a_thread )
 {
@@ -274,6 +295,35 @@ int GM_CDECL gmDeleteRespawn( gmThread* a_thread )
     return GM_OK;
 }
 
+// SCRIPTBIND( gmMapLoad, "mapLoad");
+int GM_CDECL gmMapLoad( gmThread* a_thread )
+{
+    GM_CHECK_NUM_PARAMS( 1 ); 
+    GM_CHECK_STRING_PARAM( filename, 0 );
+
+    if ( WORLD.GetMap() )
+    {
+      WORLD.GetMap()->Load( APP.useFile( filename ).c_str() );
+    }
+
+    return GM_OK;
+}
+
+// converts the current map, whatever the .map and world script built, to the binary format
+// SCRIPTBIND( gmMapSave, "mapSave");
+int GM_CDECL gmMapSave( gmThread* a_thread )
+{
+    GM_CHECK_NUM_PARAMS( 1 ); 
+    GM_CHECK_STRING_PARAM( filename, 0 );
+
+    if ( WORLD.GetMap() )
+    {
+      WORLD.GetMap()->Save( APP.useFile( filename ).c_str() );
+    }
+
+    return GM_OK;
+}
+
 // SCRIPTBIND( gmaddSkyDome, "addSkyDome");
 int GM_CDECL gmaddSkyDome( gmThread* a_thread )
 {
@@ -301,6 +351,7 @@ void BindScriptEditorFunctions()
     SCRIPTBIND( gmSetSky, "mapSetSky" );
     SCRIPTBIND( gmAddZone, "mapAddZone" );
     SCRIPTBIND( gmAddMesh, "mapAddMesh" );
+    SCRIPTBIND( gmBenchmarkMeshCollision, "mapBenchmarkCollision" );
     SCRIPTBIND( gmAddSprite, "mapAddSprite" );
     SCRIPTBIND( gmAddAnimSprite, "mapAddAnimSprite" );
     SCRIPTBIND( gmAddCloud, "mapAddCloud" );
@@ -310,5 +361,7 @@ void BindScriptEditorFunctions()
     SCRIPTBIND( gmDeleteActor, "mapDeleteActor" );
     SCRIPTBIND( gmDeleteRespawn, "mapDeleteRespawn" );
 	SCRIPTBIND( gmaddSkyDome, "addSkyDome");
+    SCRIPTBIND( gmMapLoad, "mapLoad" );
+    SCRIPTBIND( gmMapSave, "mapSave" );
 }
 
@@ -6,10 +6,16 @@
 #include "../World/player.h"
 #include "../World/map.h"
 #include "../World/bot.h"
+#include "../World/demo.h"
 
 #include "../RakNet/GameServer.h"
+#include "../RakNet/snapshot.h"
+#include "../RakNet/prediction.h"
+#include "../RakNet/lagcomp.h"
+#include "../RakNet/bitstreambench.h"
 
 #include "../Entities/EntityIncludes.h"
+#include "../Effects/effectpool.h"
 
 //\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\
 
@@ -214,6 +220,157 @@ int GM_CDECL gmSetCamera( gmThread* a_thread )
     return GM_OK;
 }
 
+// SCRIPTBIND( gmMemBenchmark, "memBenchmark");
+int GM_CDECL gmMemBenchmark( gmThread* a_thread )
+{
+    GM_INT_PARAM( maxlive, 0, 65536 );
+    GM_INT_PARAM( cycles, 1, 100000 );
+
+    IMMObject::Benchmark( maxlive, cycles );
+    CONSOLE.add( "Memory manager benchmark written to the application log." );
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmEffectStats, "effectStats");
+int GM_CDECL gmEffectStats( gmThread* a_thread )
+{
+    EFFECTS->PrintStats();
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmSnapshotStats, "snapshotStats");
+int GM_CDECL gmSnapshotStats( gmThread* a_thread )
+{
+    SNAPSHOTS->PrintStats();
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmSnapshotTest, "snapshotTest");
+int GM_CDECL gmSnapshotTest( gmThread* a_thread )
+{
+    GM_INT_PARAM( clients, 0, 8 );
+    GM_INT_PARAM( actors, 1, 64 );
+    GM_INT_PARAM( ticks, 2, 3000 );
+    GM_INT_PARAM( loss, 3, 5 );
+
+    SNAPSHOTS->Loopback( clients, actors, ticks, loss );
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmPredictionStats, "predictionStats");
+int GM_CDECL gmPredictionStats( gmThread* a_thread )
+{
+    PREDICTION->PrintStats();
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmLagCompStats, "lagCompStats");
+int GM_CDECL gmLagCompStats( gmThread* a_thread )
+{
+    LAGCOMP->PrintStats();
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmLagCompTest, "lagCompTest");
+int GM_CDECL gmLagCompTest( gmThread* a_thread )
+{
+    GM_INT_PARAM( latency, 0, 150 );
+    GM_INT_PARAM( shots, 1, 1000 );
+
+    a_thread->PushInt( LAGCOMP->Test( latency, shots ) ? 1 : 0 );
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmBitStreamTest, "bitStreamTest");
+int GM_CDECL gmBitStreamTest( gmThread* a_thread )
+{
+    GM_INT_PARAM( fields, 0, 10000 );
+    GM_INT_PARAM( runs, 1, 100 );
+
+    BitStreamBenchmark( fields, runs );
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmScriptCacheTest, "scriptCacheTest");
+int GM_CDECL gmScriptCacheTest( gmThread* a_thread )
+{
+    GM_INT_PARAM( runs, 0, 20 );
+
+    SCRIPT.CacheBenchmark( "Scripts", runs );
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmProfileCapture, "profileCapture");
+int GM_CDECL gmProfileCapture( gmThread* a_thread )
+{
+    GM_INT_PARAM( frames, 0, 60 );
+    GM_STRING_PARAM( filename, 1, "profile.json" );
+
+    if ( !CProfileSample::Capture( frames, filename ) )
+    {
+      CONSOLE.add( "Profiler: capture not started", COLOR_ERROR );
+    }
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmDemoRecord, "demoRecord");
+int GM_CDECL gmDemoRecord( gmThread* a_thread )
+{
+    GM_STRING_PARAM( filename, 0, "demo.dem" );
+    GM_STRING_PARAM( worldScript, 1, "Scripts/autostart.gm" );
+    GM_INT_PARAM( ticks, 2, 0 );
+
+    if ( !DEMO->Record( filename, worldScript, ( u32 )max( ticks, 0 ) ) )
+    {
+      CONSOLE.add( "Demo: recording not started", COLOR_ERROR );
+    }
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmDemoStop, "demoStop");
+int GM_CDECL gmDemoStop( gmThread* a_thread )
+{
+    DEMO->Stop();
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmDemoPlay, "demoPlay");
+int GM_CDECL gmDemoPlay( gmThread* a_thread )
+{
+    GM_STRING_PARAM( filename, 0, "demo.dem" );
+    GM_INT_PARAM( benchmark, 1, 1 );
+
+    if ( !DEMO->Play( filename, benchmark != 0 ) )
+    {
+      CONSOLE.add( "Demo: playback not started", COLOR_ERROR );
+    }
+
+    return GM_OK;
+}
+
+// SCRIPTBIND( gmRelevancyTest, "relevancyTest");
+int GM_CDECL gmRelevancyTest( gmThread* a_thread )
+{
+    GM_INT_PARAM( actors, 0, 256 );
+    GM_INT_PARAM( ticks, 1, 1200 );
+
+    SNAPSHOTS->RelevancyBenchmark( actors, ticks );
+
+    return GM_OK;
+}
+
 //\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\//\\
 
 void BindScriptFunctions()
@@ -235,5 +392,19 @@ void BindScriptFunctions()
     SCRIPTBIND( gAddBot, "addBot" );
     SCRIPTBIND( gmNewMusic, "newMusic" );
     SCRIPTBIND( gmSetCamera, "setCamera" );
+    SCRIPTBIND( gmMemBenchmark, "memBenchmark" );
+    SCRIPTBIND( gmEffectStats, "effectStats" );
+    SCRIPTBIND( gmSnapshotStats, "snapshotStats" );
+    SCRIPTBIND( gmSnapshotTest, "snapshotTest" );
+    SCRIPTBIND( gmRelevancyTest, "relevancyTest" );
+    SCRIPTBIND( gmPredictionStats, "predictionStats" );
+    SCRIPTBIND( gmLagCompStats, "lagCompStats" );
+    SCRIPTBIND( gmLagCompTest, "lagCompTest" );
+    SCRIPTBIND( gmBitStreamTest, "bitStreamTest" );
+    SCRIPTBIND( gmScriptCacheTest, "scriptCacheTest" );
+    SCRIPTBIND( gmProfileCapture, "profileCapture" );
+    SCRIPTBIND( gmDemoRecord, "demoRecord" );
+    SCRIPTBIND( gmDemoStop, "demoStop" );
+    SCRIPTBIND( gmDemoPlay, "demoPlay" );
 }
 
@@ -0,0 +1,150 @@
+#include "CParticleBatchSceneNode.h"
+
+// u16 indices, 4 vertices per quad
+#define BATCH_MAX_QUADS 16384
+
+CParticleBatchSceneNode::CParticleBatchSceneNode( ISceneNode* parent, ISceneManager* mgr, s32 id, video::ITexture* texture, video::E_MATERIAL_TYPE materialType, bool lighting ) : ISceneNode( parent, mgr, id )
+{
+    Material.Wireframe = false;
+    Material.Lighting = lighting;
+    Material.BackfaceCulling = false;
+    Material.MaterialType = materialType;
+    Material.Texture1 = texture;
+
+    // particles are spread over the whole map
+    AutomaticCullingEnabled = false;
+}
+
+SSlotHandle CParticleBatchSceneNode::addParticle()
+{
+    return particles.Add( SBatchParticle() );
+}
+
+void CParticleBatchSceneNode::removeParticle( const SSlotHandle& h )
+{
+    particles.Remove( h );
+}
+
+core::rect<f32> CParticleBatchSceneNode::getFrameRect( s32 frame, s32 frameWidth, s32 frameHeight )
+{
+    if ( !Material.Texture1 )
+    {
+      return core::rect<f32>( 0.0f, 0.0f, 1.0f, 1.0f );
+    }
+
+    dimension2d<s32> size = Material.Texture1->getOriginalSize();
+    f32 w = ( f32 )frameWidth / ( f32 )size.Width;
+    f32 h = ( f32 )frameHeight / ( f32 )size.Height;
+    s32 columns = size.Width / frameWidth;
+    if ( columns < 1 )
+    {
+      columns = 1;
+    }
+
+    f32 x = ( frame % columns ) * w;
+    f32 y = ( frame / columns ) * h;
+    return core::rect<f32>( x, y, x + w, y + h );
+}
+
+void CParticleBatchSceneNode::OnPreRender()
+{
+    if ( IsVisible && ( particles.size() > 0 ) )
+    {
+      SceneManager->registerNodeForRendering( this );
+    }
+}
+
+void CParticleBatchSceneNode::render()
+{
+    IVideoDriver* driver = SceneManager->getVideoDriver();
+    ICameraSceneNode* camera = SceneManager->getActiveCamera();
+
+    if ( !driver || !camera )
+    {
+      return;
+    }
+
+    // camera axes for the billboards, same as CBillboardSceneNode
+    core::vector3df view = camera->getTarget() - camera->getAbsolutePosition();
+    view.normalize();
+    core::vector3df up = camera->getUpVector();
+    core::vector3df horizontal = up.crossProduct( view );
+    if ( horizontal.getLength() == 0 )
+    {
+      horizontal.set( up.Y, up.X, up.Z );
+    }
+    horizontal.normalize();
+    core::vector3df vertical = horizontal.crossProduct( view );
+    vertical.normalize();
+
+    u32 n = particles.size();
+    Vertices.set_used( n * 4 );
+
+    for ( u32 i = 0; i < n; i++ )
+    {
+      const SBatchParticle& p = particles[i];
+      core::vector3df a, b;
+
+      if ( p.billboard )
+      {
+        if ( p.rotated )
+        {
+          a = vertical * ( -0.5f * p.size.Height );
+          b = horizontal * ( 0.5f * p.size.Width );
+        }
+        else
+        {
+          a = horizontal * ( 0.5f * p.size.Width );
+          b = vertical * ( 0.5f * p.size.Height );
+        }
+      }
+      else
+      {
+        a = p.axisU;
+        b = p.axisV;
+      }
+
+      // vertex k sits at pos +- a +- b and takes the matching corner of uv
+      video::S3DVertex* v = &Vertices[i * 4];
+      v[0] = video::S3DVertex( p.pos + a + b, view, p.color, core::vector2df( p.uv.LowerRightCorner.X, p.uv.LowerRightCorner.Y ) );
+      v[1] = video::S3DVertex( p.pos + a - b, view, p.color, core::vector2df( p.uv.LowerRightCorner.X, p.uv.UpperLeftCorner.Y ) );
+      v[2] = video::S3DVertex( p.pos - a - b, view, p.color, core::vector2df( p.uv.UpperLeftCorner.X, p.uv.UpperLeftCorner.Y ) );
+      v[3] = video::S3DVertex( p.pos - a + b, view, p.color, core::vector2df( p.uv.UpperLeftCorner.X, p.uv.LowerRightCorner.Y ) );
+
+      if ( i == 0 )
+      {
+        Box.reset( v[0].Pos );
+      }
+      for ( s32 k = 0; k < 4; k++ )
+      {
+        Box.addInternalPoint( v[k].Pos );
+      }
+    }
+
+    // the index pattern is the same for every batch size
+    u32 quads = n < BATCH_MAX_QUADS ? n : BATCH_MAX_QUADS;
+    for ( u32 q = Indices.size() / 6; q < quads; q++ )
+    {
+      u16 base = ( u16 )( q * 4 );
+      Indices.push_back( base + 0 );
+      Indices.push_back( base + 2 );
+      Indices.push_back( base + 1 );
+      Indices.push_back( base + 0 );
+      Indices.push_back( base + 3 );
+      Indices.push_back( base + 2 );
+    }
+
+    core::matrix4 mat;
+    driver->setTransform( video::ETS_WORLD, mat );
+    driver->setMaterial( Material );
+
+    for ( u32 first = 0; first < n; first += BATCH_MAX_QUADS )
+    {
+      drawQuads( first, n - first < BATCH_MAX_QUADS ? n - first : BATCH_MAX_QUADS );
+    }
+}
+
+void CParticleBatchSceneNode::drawQuads( u32 first, u32 count )
+{
+    SceneManager->getVideoDriver()->drawIndexedTriangleList( &Vertices[first * 4], count * 4, Indices.pointer(), count * 2 );
+}
@@ -0,0 +1,103 @@
+#ifndef __CPARTICLEBATCHSCENENODE_H_INCLUDED__
+#define __CPARTICLEBATCHSCENENODE_H_INCLUDED__
+
+#include "../Engine/engine.h"
+
+namespace irr
+{
+    namespace scene
+    {
+        // one quad in a CParticleBatchSceneNode
+        struct SBatchParticle
+        {
+            SBatchParticle()
+            {
+                billboard = true;
+                rotated = false;
+                uv = core::rect<f32>( 0.0f, 0.0f, 1.0f, 1.0f );
+                color.set( 255, 255, 255, 255 );
+            }
+
+            core::vector3df pos;
+
+            // billboards face the camera and are size big, like IBillboardSceneNode
+            // (a negative size flips the quad), the rest span pos +- axisU +- axisV
+            bool billboard;
+            core::dimension2d<f32> size;
+            core::vector3df axisU, axisV;
+
+            // texture rect, u runs along the billboard width or along axisU
+            core::rect<f32> uv;
+            // billboard u runs down the screen instead, the CAnimSpriteSceneNode layout
+            bool rotated;
+
+            video::SColor color;
+        };
+
+        ////////////////////////////////////////////
+        // CParticleBatchSceneNode
+        // - draws all particles that share a texture and material with one
+        //   drawIndexedTriangleList call per 16k quads
+        // - quads are built in world space at render time, so it works with
+        //   every driver including software and null
+        ////////////////////////////////////////////
+
+        class CParticleBatchSceneNode : public ISceneNode
+        {
+          public:
+            CParticleBatchSceneNode( ISceneNode* parent, ISceneManager* mgr, s32 id, video::ITexture* texture, video::E_MATERIAL_TYPE materialType, bool lighting );
+
+            // the particle stays in the batch until removeParticle()
+            SSlotHandle addParticle();
+            void removeParticle( const SSlotHandle& h );
+            // NULL if the handle is stale
+            SBatchParticle* getParticle( const SSlotHandle& h )
+            {
+                return particles.Get( h );
+            }
+            u32 getParticleCount()
+            {
+                return particles.size();
+            }
+
+            video::ITexture* getTexture()
+            {
+                return Material.Texture1;
+            }
+            // texture rect of a frame on a sprite sheet, frames run left to right then down
+            core::rect<f32> getFrameRect( s32 frame, s32 frameWidth, s32 frameHeight );
+
+            virtual void OnPreRender();
+            virtual void render();
+
+            virtual const core::aabbox3d<f32>& getBoundingBox() const
+            {
+                return Box;
+            }
+
+            virtual s32 getMaterialCount()
+            {
+                return 1;
+            }
+
+            virtual video::SMaterial& getMaterial( s32 i )
+            {
+                return Material;
+            }
+
+          private:
+            void drawQuads( u32 first, u32 count );
+
+            CSlotMap<SBatchParticle> particles;
+
+            // rebuilt every render, the index list only grows
+            core::array<video::S3DVertex> Vertices;
+            core::array<u16> Indices;
+
+            video::SMaterial Material;
+            core::aabbox3d<f32> Box;
+        };
+    } // end namespace scene
+} // end namespace irr
+
+#endif
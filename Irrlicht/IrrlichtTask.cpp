@@ -91,7 +91,8 @@ bool CIrrlichtTask::Start()
     // renders
     GUIRender = new CGUIRender();
     DebugRender = new CDebugRender();
-
+#else
+    chatConsole = NULL;
 #endif
 
     // vars
@@ -171,7 +172,7 @@ bool CIrrlichtTask::OnEvent( irr::SEvent event )
           return true;
         }
 
-        if ( !CONSOLE.isVisible() )
+        if ( !CONSOLE.isVisible() && chatConsole )
         {
           if ( event.KeyInput.Key == IRR.getChatConsole()->getConfig().key_tilde )
           {
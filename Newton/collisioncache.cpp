@@ -0,0 +1,190 @@
+#include "collisioncache.h"
+#include "../Engine/misc.h"
+
+#ifndef WIN32
+#include <sys/stat.h>
+#endif
+
+static void CacheRead( void* serializeHandle, void* buffer, size_t size )
+{
+    fread( buffer, 1, size, ( FILE * )serializeHandle );
+}
+
+static void CacheWrite( void* serializeHandle, const void* buffer, size_t size )
+{
+    fwrite( buffer, 1, size, ( FILE * )serializeHandle );
+}
+
+////////////////////////////////////////////
+// CCollisionCache
+////////////////////////////////////////////
+
+CCollisionCache::CCollisionCache()
+{
+    treeHits = treeMisses = shapeHits = 0;
+
+    CONSOLE_VAR( "p_collision_cache", bool, enabled, 1, L"p_collision_cache [0/1]. Ex. p_collision_cache 0", L"Load map collision trees from the Cache directory and share model shapes between bodies." );
+}
+
+u32 CCollisionCache::HashFile( const c8* filename )
+{
+    String name = filename;
+    for ( u32 i = 0; i < hashedFiles.size(); i++ )
+    {
+      if ( hashedFiles[i] == name )
+      {
+        return fileHashes[i];
+      }
+    }
+
+    u32 hash = ::HashFile( APP.useFile( filename ).c_str() );
+    if ( !hash )
+    {
+      return 0;
+    }
+
+    hashedFiles.push_back( name );
+    fileHashes.push_back( hash );
+    return hash;
+}
+
+void CCollisionCache::FillHeader( NewtonWorld* nWorld, CollisionCacheHeader& header, u32 fileHash, const c8* variant, vector3df vPos, vector3df vScale )
+{
+    memset( &header, 0, sizeof( CollisionCacheHeader ) );
+    header.magic = COLLISIONCACHE_MAGIC;
+    header.version = COLLISIONCACHE_VERSION;
+    header.newtonVersion = NewtonWorldGetVersion( nWorld );
+    header.fileHash = fileHash;
+    header.vPos = vPos;
+    header.vScale = vScale;
+    strncpy( header.variant, variant, sizeof( header.variant ) - 1 );
+}
+
+String CCollisionCache::TreeFilename( u32 fileHash, const c8* variant, vector3df vPos, vector3df vScale )
+{
+    u32 key = HashBytes( fileHash, variant, strlen( variant ) );
+    key = HashBytes( key, &vPos, sizeof( vector3df ) );
+    key = HashBytes( key, &vScale, sizeof( vector3df ) );
+
+    c8 name[64];
+    sprintf( name, COLLISIONCACHE_DIR "/%08x.ctc", key );
+    return name;
+}
+
+NewtonCollision* CCollisionCache::LoadTree( NewtonWorld* nWorld, const c8* meshFilename, const c8* variant, vector3df vPos, vector3df vScale )
+{
+    if ( !enabled )
+    {
+      return NULL;
+    }
+
+    u32 fileHash = HashFile( meshFilename );
+    if ( fileHash == 0 )
+    {
+      return NULL;
+    }
+
+    FILE* pFile = fopen( TreeFilename( fileHash, variant, vPos, vScale ).c_str(), "rb" );
+    if ( pFile == NULL )
+    {
+      treeMisses++;
+      return NULL;
+    }
+
+    // the name is only a hash, the header says what was really cached
+    CollisionCacheHeader expected, header;
+    FillHeader( nWorld, expected, fileHash, variant, vPos, vScale );
+    if ( ( fread( &header, sizeof( CollisionCacheHeader ), 1, pFile ) != 1 ) || memcmp( &header, &expected, sizeof( CollisionCacheHeader ) ) )
+    {
+      fclose( pFile );
+      treeMisses++;
+      return NULL;
+    }
+
+    NewtonCollision* tree = NewtonCreateTreeCollisionFromSerialization( nWorld, NULL, CacheRead, pFile );
+    fclose( pFile );
+
+    if ( tree )
+    {
+      treeHits++;
+    }
+    else
+    {
+      treeMisses++;
+    }
+    return tree;
+}
+
+void CCollisionCache::SaveTree( NewtonWorld* nWorld, const c8* meshFilename, const c8* variant, vector3df vPos, vector3df vScale, const NewtonCollision* tree )
+{
+    if ( !enabled || !tree )
+    {
+      return;
+    }
+
+    u32 fileHash = HashFile( meshFilename );
+    if ( fileHash == 0 )
+    {
+      return;
+    }
+
+#ifdef WIN32
+    CreateDirectory( COLLISIONCACHE_DIR, NULL );
+#else
+    mkdir( COLLISIONCACHE_DIR, 0755 );
+#endif
+
+    String filename = TreeFilename( fileHash, variant, vPos, vScale );
+    FILE* pFile = fopen( filename.c_str(), "wb" );
+    if ( pFile == NULL )
+    {
+      APPLOG.Write( "CCollisionCache: could not write '%s'", filename.c_str() );
+      return;
+    }
+
+    CollisionCacheHeader header;
+    FillHeader( nWorld, header, fileHash, variant, vPos, vScale );
+    fwrite( &header, sizeof( CollisionCacheHeader ), 1, pFile );
+    NewtonTreeCollisionSerialize( tree, CacheWrite, pFile );
+    fclose( pFile );
+}
+
+NewtonCollision* CCollisionCache::GetShape( const String& key )
+{
+    if ( !enabled )
+    {
+      return NULL;
+    }
+
+    for ( u32 i = 0; i < shapeKeys.size(); i++ )
+    {
+      if ( shapeKeys[i] == key )
+      {
+        shapeHits++;
+        return shapes[i];
+      }
+    }
+    return NULL;
+}
+
+bool CCollisionCache::AddShape( const String& key, NewtonCollision* shape )
+{
+    if ( !enabled || !shape )
+    {
+      return false;
+    }
+
+    shapeKeys.push_back( key );
+    shapes.push_back( shape );
+    return true;
+}
+
+void CCollisionCache::ReleaseShapes( NewtonWorld* nWorld )
+{
+    for ( u32 i = 0; i < shapes.size(); i++ )
+    {
+      NewtonReleaseCollision( nWorld, shapes[i] );
+    }
+    shapes.clear();
+    shapeKeys.clear();
+}
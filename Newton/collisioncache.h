@@ -0,0 +1,68 @@
+#ifndef COLLISIONCACHE_H_INCLUDED
+#define COLLISIONCACHE_H_INCLUDED
+
+#include "newton_physics.h"
+
+#define COLLISIONCACHE CCollisionCache::Instance()
+
+////////////////////////////////////////////
+// CCollisionCache
+// - collision trees built from mesh maps are kept on disk, keyed by a hash
+//   of the mesh file and the transform they were built with
+// - convex shapes built from models are shared in memory between bodies,
+//   Newton 1.x can only serialize trees
+////////////////////////////////////////////
+
+#define COLLISIONCACHE_DIR "Cache"
+#define COLLISIONCACHE_MAGIC 0x43544343 // 'CCTC'
+#define COLLISIONCACHE_VERSION 1
+
+struct CollisionCacheHeader
+{
+    u32 magic;
+    u32 version;
+    s32 newtonVersion;
+    u32 fileHash;
+    vector3df vPos, vScale;
+    c8 variant[16];
+};
+
+class CCollisionCache
+{
+  public:
+    static CCollisionCache* Instance()
+    {
+        static CCollisionCache inst;
+        return &inst;
+    }
+
+    // variant names the way the tree was built, change it when the build changes
+    // NULL if the tree is not cached
+    NewtonCollision* LoadTree( NewtonWorld* nWorld, const c8* meshFilename, const c8* variant, vector3df vPos, vector3df vScale );
+    void SaveTree( NewtonWorld* nWorld, const c8* meshFilename, const c8* variant, vector3df vPos, vector3df vScale, const NewtonCollision* tree );
+
+    // the cache holds one reference to each shape, callers must not release a shape
+    // they got from GetShape() or that AddShape() took
+    NewtonCollision* GetShape( const String& key );
+    bool AddShape( const String& key, NewtonCollision* shape );
+    void ReleaseShapes( NewtonWorld* nWorld );
+
+    bool enabled;
+    int treeHits, treeMisses, shapeHits;
+
+  private:
+    CCollisionCache();
+
+    u32 HashFile( const c8* filename );
+    String TreeFilename( u32 fileHash, const c8* variant, vector3df vPos, vector3df vScale );
+    void FillHeader( NewtonWorld* nWorld, CollisionCacheHeader& header, u32 fileHash, const c8* variant, vector3df vPos, vector3df vScale );
+
+    // file hashes are worked out once per run
+    array<String> hashedFiles;
+    array<u32> fileHashes;
+
+    array<String> shapeKeys;
+    array<NewtonCollision*> shapes;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include "../World/calc.h"
 
 #include "../FreeSL/SoundTask.h"
+#include "../Effects/effectpool.h"
+#include "collisioncache.h"
 
 #define HULL_SIZE_MODIFER 0.95f;
 
@@ -32,6 +34,8 @@ CNewtonNode::~CNewtonNode()
 {
     int i;
 
+    WORLD.GetPhysics()->ForgetPose( this );
+
     // get rid of attachment children and parents
     while ( childAttachments.size() > 0 )
     {
@@ -74,6 +78,8 @@ void CNewtonNode::Reset()
     iNodeMesh = NULL;
     watercheckcount = false;
     bModCol = false;
+    poseStep = 0;
+    vDrawOffset = vector3df( 0.0f, 0.0f, 0.0f );
 }
 
 void CNewtonNode::assemblePhysics( const c8* modelFilename, BodyType bodyType, vector3df vScale, vector3df vColOffset, float fMass, bool modifiableCollision )
@@ -94,7 +100,7 @@ void CNewtonNode::assemblePhysics( const c8* modelFilename, BodyType bodyType, v
     }
 
     bModCol = modifiableCollision;
-    makeBody( node, bodyType, vSize, vScale, vColOffset, fMass, loadedMesh, modifiableCollision );
+    makeBody( node, bodyType, vSize, vScale, vColOffset, fMass, loadedMesh, modifiableCollision, modelFilename );
 }
 
 void CNewtonNode::assemblePhysics( IMesh* mesh, BodyType bodyType, vector3df vScale, float fMass, bool modifiableCollision )
@@ -153,7 +159,7 @@ void CNewtonNode::PhysicsApplyForceAndTorque( const NewtonBody* body )
     NewtonBodyGetMatrix( body, &mat.M[0] ); 
 
     // add da gravity
-    dVector gravforce( 0, mass* WORLD.GetPhysics()->dGravity* IrrToNewton, 0 );
+    dVector gravforce( 0, mass* CNewton::dGravity* IrrToNewton, 0 );
     NewtonBodyAddForce( body, &gravforce.m_x );
 
     CNewtonNode* newtonNode = 0;
@@ -187,9 +193,17 @@ void CNewtonNode::PhysicsApplyForceAndTorque( const NewtonBody* body )
     // add da buoyancy
     if ( newtonNode->watercheckcount )
     {
+      CNewton* physics = CNewton::FromBody( body );
+      SPhysicsCommand command;
+      command.node = newtonNode;
+
       bool nowater = true;
-      for ( i = 0; i < WORLD.GetMap()->GetZonesNum(); i++ )
+      array<s32>& zones = physics->GetZoneScratch();
+      zones.set_used( 0 );
+      WORLD.GetMap()->GetZonesTouching( newtonNode->getBoundingBox(), zones );
+      for ( u32 z = 0; z < zones.size(); z++ )
       {
+        i = zones[z];
         if ( WORLD.GetMap()->GetZone( i )->getBox()->intersectsWithBox( newtonNode->getBoundingBox() ) )
         {
           NewtonBodyAddBuoyancyForce( body, mass / newtonNode->weightFactor / WORLD.GetMap()->GetZone( i )->getLiquidWeightFactor(),
@@ -198,7 +212,9 @@ void CNewtonNode::PhysicsApplyForceAndTorque( const NewtonBody* body )
 
           if ( !newtonNode->bInWater )
           {
-            newtonNode->OnEnterWater( WORLD.GetMap()->GetZone( i )->getBox() );
+            command.type = PHYSICSCMD_ENTERWATER;
+            command.zone = i;
+            physics->QueueCommand( command );
           }
 
           newtonNode->bInWater = i + 1;
@@ -210,7 +226,9 @@ void CNewtonNode::PhysicsApplyForceAndTorque( const NewtonBody* body )
       {
         if ( newtonNode->bInWater )
         {
-          newtonNode->OnExitWater( WORLD.GetMap()->GetZone( newtonNode->bInWater - 1 )->getBox() );
+          command.type = PHYSICSCMD_EXITWATER;
+          command.zone = newtonNode->bInWater - 1;
+          physics->QueueCommand( command );
         }
         newtonNode->bInWater = 0;
       }
@@ -233,7 +251,7 @@ void CNewtonNode::PhysicsApplyForceAndTorque( const NewtonBody* body )
 				radius *= newtonNode->vVelocity.Y / 5.0f;
 				vector3df vWaterPos = newtonNode->vWaterEntryPos;
 				vWaterPos.X = newtonNode->getPosition().X;
-				FACTORY->Effects.Create( "watercircle", vWaterPos, vWaterPos, 0.0f, radius * 0.0003f, 180 );
+				physics->QueueEffect( "watercircle", vWaterPos, vWaterPos, 0.0f, radius * 0.0003f, 180 );
 			}
 			}
 
@@ -294,17 +312,16 @@ void CNewtonNode::PhysicsSetTransform( const NewtonBody* body, const dFloat* mat
       return;
     }   
 
-    static matrix4 mat;
-    memcpy( mat.M, matrix, sizeof( s32 ) * 16 );
-
     if ( !newtonNode->isAttached() )
     {
-      newtonNode->transformMatrix = mat;
+      memcpy( newtonNode->transformMatrix.M, matrix, sizeof( s32 ) * 16 );
     }
 
-    newtonNode->PhysicsTransform( newtonNode->transformMatrix );
-
-    newtonNode->UpdateChildAttachments();
+    // the scene node and the attachments are placed after the step
+    SPhysicsCommand command;
+    command.type = PHYSICSCMD_TRANSFORM;
+    command.node = newtonNode;
+    CNewton::FromBody( body )->QueueCommand( command );
 }
 
 
@@ -441,12 +458,24 @@ NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3d
 }
 
 
-NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3df vSize, vector3df vScale, vector3df vColOffset, float fMass, IAnimatedMesh* iMesh, bool modifiableCollision )
+NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3df vSize, vector3df vScale, vector3df vColOffset, float fMass, IAnimatedMesh* iMesh, bool modifiableCollision, const c8* shapeName )
 {
-    NewtonCollision* collision;
+    NewtonCollision* collision = NULL;
     vSize *= IrrToNewton;
     vSize *= vScale;
 
+    String shapeKey;
+    bool bShared = false;
+    if ( shapeName )
+    {
+      c8 key[256];
+      sprintf( key, "|%i|%.4f %.4f %.4f|%.4f %.4f %.4f|%.4f %.4f %.4f", bodyType, vSize.X, vSize.Y, vSize.Z, vScale.X, vScale.Y, vScale.Z, vColOffset.X, vColOffset.Y, vColOffset.Z );
+      shapeKey = shapeName;
+      shapeKey += key;
+      collision = COLLISIONCACHE->GetShape( shapeKey );
+      bShared = ( collision != NULL );
+    }
+
     matrix4 offset;
     vector3df vOff;
     int numVerts = 0;
@@ -456,7 +485,7 @@ NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3d
     int buffCount = iMesh->getFrameCount();
 
     // calculate the offset of the mesh
-    if ( bodyType < 2 )
+    if ( !collision && ( bodyType < 2 ) )
     {
       for ( int i = 0; i < buffCount; i ++ )
       {
@@ -479,65 +508,77 @@ NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3d
     }
     offset.setTranslation( vColOffset + vOff );
 
-    switch ( bodyType )
+    if ( !collision )
     {
-      case BODY_BOX:
-        collision = NewtonCreateBox( WORLD.GetPhysics()->nWorld, vSize.X, vSize.Y, vSize.Z, &offset.M[0] );
-        break;
-      case BODY_SPHERE:
-        collision = NewtonCreateSphere( WORLD.GetPhysics()->nWorld, vSize.X / 2, vSize.Y / 2, vSize.Z / 2, &offset.M[0] );
-        break;
-      case BODY_HULL:
-        IAnimatedMesh* treemesh = iMesh;
-        vector3df vP; //
-
-        // calc all vertices count
-        numVerts = 0;
-        i = 0;
-        //for (i = 0; i < buffCount; i ++) 
-        for ( cMeshBuffer = 0; cMeshBuffer < treemesh->getMesh( i )->getMeshBufferCount(); cMeshBuffer++ )
-        {
-          numVerts += treemesh->getMesh( i )->getMeshBuffer( cMeshBuffer )->getVertexCount();
-        }
-        vertArray = new float[numVerts * 3];
-        int vcount = 0;
+      switch ( bodyType )
+      {
+        case BODY_BOX:
+          collision = NewtonCreateBox( WORLD.GetPhysics()->nWorld, vSize.X, vSize.Y, vSize.Z, &offset.M[0] );
+          break;
+        case BODY_SPHERE:
+          collision = NewtonCreateSphere( WORLD.GetPhysics()->nWorld, vSize.X / 2, vSize.Y / 2, vSize.Z / 2, &offset.M[0] );
+          break;
+        case BODY_HULL:
+          IAnimatedMesh* treemesh = iMesh;
+          vector3df vP; //
+
+          // calc all vertices count
+          numVerts = 0;
+          i = 0;
+          //for (i = 0; i < buffCount; i ++) 
+          for ( cMeshBuffer = 0; cMeshBuffer < treemesh->getMesh( i )->getMeshBufferCount(); cMeshBuffer++ )
+          {
+            numVerts += treemesh->getMesh( i )->getMeshBuffer( cMeshBuffer )->getVertexCount();
+          }
+          vertArray = new float[numVerts * 3];
+          int vcount = 0;
 
-        //for (i = 0; i < buffCount; i ++) 
-        i = 0;
-        {
-            //CONSOLE.addx("BODY_HULL cMeshBuffer b %i mb %i", buffCount, treemesh->getMesh(i)->getMeshBufferCount() );
+          //for (i = 0; i < buffCount; i ++) 
+          i = 0;
+          {
+              //CONSOLE.addx("BODY_HULL cMeshBuffer b %i mb %i", buffCount, treemesh->getMesh(i)->getMeshBufferCount() );
 
-            for ( cMeshBuffer = 0; cMeshBuffer < treemesh->getMesh( i )->getMeshBufferCount(); cMeshBuffer++ )
-            {
-              mb = treemesh->getMesh( i )->getMeshBuffer( cMeshBuffer );
+              for ( cMeshBuffer = 0; cMeshBuffer < treemesh->getMesh( i )->getMeshBufferCount(); cMeshBuffer++ )
+              {
+                mb = treemesh->getMesh( i )->getMeshBuffer( cMeshBuffer );
 
-              video::S3DVertex* mb_vertices = ( irr::video::S3DVertex* )mb->getVertices();
+                video::S3DVertex* mb_vertices = ( irr::video::S3DVertex* )mb->getVertices();
 
-              u16* mb_indices = mb->getIndices();
+                u16* mb_indices = mb->getIndices();
 
-              // add each triangle from the mesh
-              for ( j = 0; j < mb->getVertexCount(); j += 1 )
-              {
-                // to make things easier, here we can use engine data type
-                vP = mb_vertices[j].Pos * vScale * HULL_SIZE_MODIFER;                       
+                // add each triangle from the mesh
+                for ( j = 0; j < mb->getVertexCount(); j += 1 )
+                {
+                  // to make things easier, here we can use engine data type
+                  vP = mb_vertices[j].Pos * vScale * HULL_SIZE_MODIFER;                       
 
-                vertArray[vcount * 3] = vP.X;
-                vertArray[vcount * 3 + 1] = vP.Y;
-                vertArray[vcount * 3 + 2] = vP.Z;   
-                vcount++;
+                  vertArray[vcount * 3] = vP.X;
+                  vertArray[vcount * 3 + 1] = vP.Y;
+                  vertArray[vcount * 3 + 2] = vP.Z;   
+                  vcount++;
+                }
               }
-            }
-        }
+          }
 
-        collision = NewtonCreateConvexHull( WORLD.GetPhysics()->nWorld, numVerts, vertArray, 3 * sizeof( float ), &offset.M[0] );
-        delete[] vertArray;
-        break;
+          collision = NewtonCreateConvexHull( WORLD.GetPhysics()->nWorld, numVerts, vertArray, 3 * sizeof( float ), &offset.M[0] );
+          delete[] vertArray;
+          break;
+      }
+
+      if ( shapeName )
+      {
+        bShared = COLLISIONCACHE->AddShape( shapeKey, collision );
+      }
     }
 
+    // the cache keeps its own reference to a shared shape
     if ( modifiableCollision )
     {
       newtonCollision = NewtonCreateConvexHullModifier( WORLD.GetPhysics()->nWorld, collision );
-      NewtonReleaseCollision( WORLD.GetPhysics()->nWorld, collision );
+      if ( !bShared )
+      {
+        NewtonReleaseCollision( WORLD.GetPhysics()->nWorld, collision );
+      }
     }
     else
     {
@@ -565,7 +606,10 @@ NewtonBody* CNewtonNode::makeBody( ISceneNode* node, BodyType bodyType, vector3d
     // 2d joint
     //  joint2d = new CustomJoint2D( body, dVector(0.0, 0.0, 1.0) );
 
-    NewtonReleaseCollision( WORLD.GetPhysics()->nWorld, newtonCollision );
+    if ( modifiableCollision || !bShared )
+    {
+      NewtonReleaseCollision( WORLD.GetPhysics()->nWorld, newtonCollision );
+    }
 
 	node->updateAbsolutePosition();
 
@@ -660,9 +704,21 @@ void CNewtonNode::setUserData()
 }
 
 void CNewtonNode::PhysicsTransform( matrix4 matrix )
+{
+    if ( WORLD.GetPhysics()->bInterpolate )
+    {
+      WORLD.GetPhysics()->SetPose( this, matrix );
+    }
+    else
+    {
+      SetNodeTransform( matrix );
+    }
+}
+
+void CNewtonNode::SetNodeTransform( const matrix4& matrix )
 {
     node->setRotation( matrix.getRotationDegrees() );
-    node->setPosition( matrix.getTranslation() );
+    node->setPosition( matrix.getTranslation() + vDrawOffset );
     node->updateAbsolutePosition();
 
     core::list<ISceneNode*>::Iterator it;
@@ -755,9 +811,6 @@ int CNewtonNode::GetBuoyancy( const int collisionID, void* context, const dFloat
     globalSpacePlane[2] = 0.0f;
 
     // the distance along this normal, to the origin.
-    static matrix4 mat;
-    memcpy( mat.M, globalSpaceMatrix, sizeof( s32 ) * 16 );
-
     CMap_Zone* zone = ( CMap_Zone* )context;
     //globalSpacePlane[3] = ( (zone->getBox()->getCenter().Y - zone->getSize()->Y/2) - (mat.getTranslation().Y)  ) * IrrToNewton;
     globalSpacePlane[3] = ( zone->getBox()->getCenter().Y - zone->getSize()->Y / 2 ) - 0.9f;
@@ -801,9 +854,11 @@ void CNewtonNode::OnEnterWater( aabbox3df* zonebox )
 
     f32 radius = getBoundingBox().getExtent().getLength() / 2;
     radius *= vVelocity.getLength() / 15.0f;
-    FACTORY->Effects.Create( "splash", vPos, vPos, 0.0003f, radius, 80 );
-    FACTORY->Effects.Create( "surfacesplash", vPos, vPos, 0.0f, radius * 0.05f, 130 );
-    SOUND.playSound( "Sounds/water_fall.wav", vPos, vPos, radius, 1.0f - radius / 140.0f );
+    static s32 splashEffect = EFFECTS->GetType( "splash" );
+    static s32 surfaceSplashEffect = EFFECTS->GetType( "surfacesplash" );
+    EFFECTS->Spawn( splashEffect, vPos, vPos, 0.0003f, radius, 80 );
+    EFFECTS->Spawn( surfaceSplashEffect, vPos, vPos, 0.0f, radius * 0.05f, 130 );
+    SOUND.playSound( "Sounds/water_fall.wav", vPos, vPos, radius, 1.0f - radius / 140.0f, SOUND_PRIORITY_LOW );
 }
 
 void CNewtonNode::OnExitWater( aabbox3df* zonebox )
@@ -939,7 +994,7 @@ void CNewtonNode::PhysicsCollision( const NewtonMaterial* material, const Newton
 
       NewtonMaterialGetContactPositionAndNormal( material, &vPos.X, &vNorm.X );
 
-      FACTORY->Effects.Create( "dust", vPos, vPos, 0.5f, radius * 200.0f, 120 );
+      CNewton::FromBody( body )->QueueEffect( "dust", vPos, vPos, 0.5f, radius * 200.0f, 120 );
     }
 }
 
@@ -1033,7 +1088,7 @@ IAnimatedMeshSceneNode* loadNode_returnSize( const c8* modelFilename, vector3df
     node->setMaterialFlag( EMF_BACK_FACE_CULLING, true );
     node->setMaterialFlag( EMF_NORMALIZE_NORMALS, true );
 
-	// add shadow
+	// add shadow
 	node->addShadowVolumeSceneNode();	
 
     if ( APP.DebugMode > 1 )
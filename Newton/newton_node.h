@@ -111,6 +111,14 @@ class CNewtonNode : public NetworkIDGenerator
 
     bool isUnderWater();
 
+    // moves vPos and vVel one physics step of dt on the player's action keys
+    // (1 << AK_) like the solver would, for replaying commands on the client;
+    // false if this node can not be stepped on its own
+    virtual bool PredictStep( u16 actionKeys, f32 dt, vector3df& vPos, vector3df& vVel )
+    {
+        return false;
+    }
+
     bool IsNetworkIDAuthority( void ) const
     {
         return NET.rakServer->IsActive();
@@ -119,6 +127,9 @@ class CNewtonNode : public NetworkIDGenerator
     NewtonBody* body;
     ISceneNode* node;
 
+    // the node is drawn this far from the body, prediction corrections are slid out with it
+    vector3df vDrawOffset;
+
     CustomJoint2D* joint2d;
     bool bFix2DPos, bFix2DRot;
 
@@ -128,6 +139,8 @@ class CNewtonNode : public NetworkIDGenerator
     {
     };
     virtual void PhysicsTransform( matrix4 matrix );
+    // places the scene node, PhysicsTransform() goes through CNewton::SetPose() to get here
+    void SetNodeTransform( const matrix4& matrix );
     virtual void PhysicsCollision( const NewtonMaterial* material, const NewtonContact* contact, NewtonBody* cbody );
     virtual void OnEnterWater( aabbox3df* zonebox );
     virtual void OnExitWater( aabbox3df* zonebox );
@@ -142,7 +155,8 @@ class CNewtonNode : public NetworkIDGenerator
     void assemblePhysics( IMesh* mesh, BodyType bodyType, vector3df vScale, float fMass, bool modifiableCollision = false );
 
     NewtonBody* makeBody( ISceneNode* node, BodyType bodyType, vector3df vSize, vector3df vScale, float fMass, IMesh* iMesh, bool modifiableCollision = false );
-    NewtonBody* makeBody( ISceneNode* node, BodyType bodyType, vector3df vSize, vector3df vScale, vector3df vColOffset, float fMass, IAnimatedMesh* iMesh, bool modifiableCollision = false );
+    // bodies made with the same shapeName, type, size and scale share one collision shape
+    NewtonBody* makeBody( ISceneNode* node, BodyType bodyType, vector3df vSize, vector3df vScale, vector3df vColOffset, float fMass, IAnimatedMesh* iMesh, bool modifiableCollision = false, const c8* shapeName = NULL );
 
     // must call this on creation
     void setUserData();
@@ -164,6 +178,10 @@ class CNewtonNode : public NetworkIDGenerator
     NewtonCollision* newtonCollision;
     matrix4 transformMatrix;
 
+    // the poses of the last two physics steps, poseStep is the step of curPose
+    matrix4 prevPose, curPose;
+    u32 poseStep;
+
     int type;
 
     f32 fAngDamp, fLinDamp, fMass;
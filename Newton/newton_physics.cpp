@@ -1,12 +1,34 @@
 #include "newton_physics.h"
 #include "newton_node.h"
+#include "collisioncache.h"
+
+#include "../World/map.h"
+#include "../Effects/effectpool.h"
+
+// the poses of this many moving bodies are worked out on one job
+#define INTERPOLATE_GRAIN 64
+// contacts asked from Newton for one pair of shapes
+#define STATIC_CONTACTS_PAIR 8
+
+// NewtonWorldForEachBodyInAABBDo() passes no user data
+static array<NewtonBody*> foundStatics;
+
+static void CollectStaticBody( const NewtonBody* body )
+{
+    dFloat mass, Ixx, Iyy, Izz;
+    NewtonBodyGetMassMatrix( body, &mass, &Ixx, &Iyy, &Izz );
+    if ( mass == 0.0f )
+    {
+      foundStatics.push_back( ( NewtonBody * )body );
+    }
+}
 
 ////////////////////////////////////////////
 // CNewton 
 ////////////////////////////////////////////
 
 dFloat CNewton::dGravity = 0;
-SpecialEffectStruct* CNewton::g_currectEffect;
+SpecialEffectStruct CNewton::currentContacts[MAX_JOB_WORKERS + 1];
 SpecialEffectStruct CNewton::wood_wood;
 SpecialEffectStruct CNewton::wood_metal;
 SpecialEffectStruct CNewton::wood_level;
@@ -24,6 +46,16 @@ CNewton::CNewton()
     CONSOLE_VAR( "w_gravity", dFloat, dGravity, 9.81, L"w_gravity [real]. Ex. w_gravity 9.81", L"The world physics gravity force value." );
     CONSOLE_VAR( "w_physics_timestep", float, timeStep, 1.0f, L"w_physics_timestep [sec]. Ex. w_physics_timestep 0.5", L"The amount of time processed by the physics engine each frame." );
     CONSOLE_VAR( "w_physics_frames", int, minFrames, 240, L"w_physics_frames [20-1000]. Ex. w_physics_frames 240", L"The world physics minimum frames per second. The higher the more stable the physics are." );
+    CONSOLE_VAR( "w_physics_rate", int, stepRate, 60, L"w_physics_rate [steps]. Ex. w_physics_rate 30", L"Physics steps per second, independent of the frame rate. Servers can run fewer." );
+    CONSOLE_VAR( "w_physics_maxsteps", int, maxSteps, 5, L"w_physics_maxsteps [steps]. Ex. w_physics_maxsteps 5", L"Most physics steps taken in one frame, time beyond that is dropped." );
+    CONSOLE_VAR( "w_physics_interpolate", bool, bInterpolate, 1, L"w_physics_interpolate [0/1]. Ex. w_physics_interpolate 0", L"Draw bodies between their last two physics steps." );
+
+#ifndef _CLIENT
+    bInterpolate = 0;
+#endif
+    movingList = 0;
+    stepCounter = 1;
+    interpolateAlpha = 1.0f;
 }
 
 CNewton::~CNewton()
@@ -35,6 +67,12 @@ bool CNewton::Start()
 {
     // initialise Newton
     nWorld = NewtonCreate( NULL, NULL );
+    NewtonWorldSetUserData( nWorld, this );
+
+    // bodies are placed before the frame is drawn, Stop() takes it back
+    IRR.RemoveDependency( this );
+    IRR.DependsOn( this );
+    KERNEL.SortTasks();
     NewtonSetSolverModel( nWorld, 8 );
     NewtonSetFrictionModel( nWorld, 1 );
     NewtonSetMinimumFrameRate( nWorld, minFrames ); // 2*GAME.goalTicks
@@ -46,7 +84,9 @@ bool CNewton::Start()
     SetupMaterials();
 
     mAccumlativeLoopTime = 0;
-    lastTime = getPreciseTime();
+    lastTime = getMicroTime();
+    movingNodes[0].set_used( 0 );
+    movingNodes[1].set_used( 0 );
 
 
     // Timing variables
@@ -92,30 +132,52 @@ void CNewton::Update()
 {
     PROFILE( "Physics task" );
 
-    // calculate time since last update
-    curTime = getPreciseTime();
-    deltaTime = curTime - lastTime;
+    // calculate time since last update, in milliseconds
+    unsigned int curTime = getMicroTime();
+    if ( KERNEL.isLockstep() )
+    {
+      // the time of the ticks the world ran, not the clock's
+      mAccumlativeLoopTime += KERNEL.GetLoopTicks() * 1000.0 / GAME.goalTicks;
+    }
+    else
+    {
+      mAccumlativeLoopTime += ( curTime - lastTime ) / 1000.0;
+    }
     lastTime = curTime;
 
-    //  NewtonUpdate(nWorld, timeStep );
-
-    //CONSOLE_FLOAT(mAccumlativeLoopTime);
-    //mAccumlativeLoopTime = mAccumlativeLoopTime + (deltaTime/1000);            // Accumulate the LoopTime (time slice) 
-    //while (mAccumlativeLoopTime > timeStep) 
-    //{ 
-    //  NewtonUpdate(nWorld, timeStep); 
-    //  mAccumlativeLoopTime -= timeStep; 
+    stepRate = max( stepRate, 1 );
+    double stepLength = 1000.0 / stepRate;
 
-    //} // while loop
+    // timeStep is the physics time of one game tick, keep it that at any rate
+    float step = timeStep * GAME.goalTicks / stepRate;
 
-    //   float alpha = mAccumlativeLoopTime / timeStep;
-    //CONSOLE_FLOAT(alpha);
-    // update world camera, here for smoothness
-    WORLD.GetCamera()->Think();
+    int steps = 0;
+    while ( ( mAccumlativeLoopTime >= stepLength ) && ( steps < maxSteps ) )
+    {
+#ifdef _CLIENT
+      // update world camera, here for smoothness
+      WORLD.GetCamera()->Think();
+#endif
+
+      Step( step );
+      mAccumlativeLoopTime -= stepLength;
+      steps++;
+    }
 
-    NewtonUpdate( nWorld, timeStep );
+    // too slow to catch up, drop the time instead of spiralling
+    if ( mAccumlativeLoopTime >= stepLength )
+    {
+      mAccumlativeLoopTime = fmod( mAccumlativeLoopTime, stepLength );
+    }
 
-    //State state = currentState*alpha + previousState*(1.0f-alpha);
+#ifdef _CLIENT
+    f32 alpha = ( f32 )( mAccumlativeLoopTime / stepLength );
+    if ( bInterpolate )
+    {
+      Interpolate( alpha );
+    }
+    WORLD.GetCamera()->Interpolate( bInterpolate ? alpha : 1.0f );
+#endif
 
     //IRR.UpdateNow();
 
@@ -141,11 +203,203 @@ void CNewton::Update()
     //IRR.UpdateNow();
 }
 
+void CNewton::Step( float step )
+{
+    int prevList = movingList;
+    movingList ^= 1;
+    movingNodes[movingList].set_used( 0 );
+    stepCounter++;
+
+    u32 i;
+    for ( i = 0; i < movingNodes[prevList].size(); i++ )
+    {
+      movingNodes[prevList][i]->prevPose = movingNodes[prevList][i]->curPose;
+    }
+
+    if ( WORLD.GetMap() )
+    {
+      WORLD.GetMap()->UpdateGrids();
+    }
+
+    NewtonUpdate( nWorld, step );
+
+    RunCommands();
+
+    // bodies that came to rest in this step are left at their last pose
+    for ( i = 0; i < movingNodes[prevList].size(); i++ )
+    {
+      CNewtonNode* newtonNode = movingNodes[prevList][i];
+      if ( newtonNode->poseStep != stepCounter )
+      {
+        newtonNode->SetNodeTransform( newtonNode->curPose );
+      }
+    }
+}
+
+CNewton* CNewton::FromBody( const NewtonBody* body )
+{
+    return ( CNewton * )NewtonWorldGetUserData( NewtonBodyGetWorld( body ) );
+}
+
+void CNewton::QueueCommand( const SPhysicsCommand& command )
+{
+    threads[JOBS.Self()].commands.push_back( command );
+}
+
+void CNewton::QueueEffect( const c8* effect, vector3df vOldPos, vector3df vNewPos, f32 oneOverMass, f32 radius, s32 aliveTime )
+{
+    SPhysicsCommand command;
+    command.type = PHYSICSCMD_EFFECT;
+    command.node = NULL;
+    command.effect = effect;
+    command.vOldPos = vOldPos;
+    command.vNewPos = vNewPos;
+    command.oneOverMass = oneOverMass;
+    command.radius = radius;
+    command.aliveTime = aliveTime;
+    QueueCommand( command );
+}
+
+s32 CNewton::GetEffectType( const c8* effect )
+{
+    s32 i = effectNames.linear_search( effect );
+    if ( i < 0 )
+    {
+      effectNames.push_back( effect );
+      effectTypes.push_back( EFFECTS->GetType( effect ) );
+      i = effectNames.size() - 1;
+    }
+    return effectTypes[i];
+}
+
+void CNewton::RunCommands()
+{
+    for ( u32 t = 0; t <= MAX_JOB_WORKERS; t++ )
+    {
+      array<SPhysicsCommand>& commands = threads[t].commands;
+      // a command can end up queueing more, those wait for the next step
+      u32 num = commands.size();
+      for ( u32 i = 0; i < num; i++ )
+      {
+        SPhysicsCommand command = commands[i];
+        switch ( command.type )
+        {
+          case PHYSICSCMD_TRANSFORM:
+            command.node->PhysicsTransform( command.node->transformMatrix );
+            command.node->UpdateChildAttachments();
+            break;
+          case PHYSICSCMD_NODETRANSFORM:
+            command.sceneNode->setRotation( command.matrix.getRotationDegrees() );
+            command.sceneNode->setPosition( command.matrix.getTranslation() ); //*IrrToNewton
+            break;
+          case PHYSICSCMD_ENTERWATER:
+            command.node->OnEnterWater( WORLD.GetMap()->GetZone( command.zone )->getBox() );
+            break;
+          case PHYSICSCMD_EXITWATER:
+            command.node->OnExitWater( WORLD.GetMap()->GetZone( command.zone )->getBox() );
+            break;
+          case PHYSICSCMD_EFFECT:
+            EFFECTS->Spawn( GetEffectType( command.effect ), command.vOldPos, command.vNewPos, command.oneOverMass, command.radius, command.aliveTime );
+            break;
+        }
+      }
+      if ( num )
+      {
+        commands.erase( 0, num );
+      }
+    }
+}
+
+void CNewton::SetPose( CNewtonNode* newtonNode, const matrix4& matrix )
+{
+    if ( newtonNode->poseStep == 0 )
+    {
+      // first pose, nothing to come from
+      newtonNode->prevPose = matrix;
+    }
+    if ( newtonNode->poseStep != stepCounter )
+    {
+      newtonNode->poseStep = stepCounter;
+      movingNodes[movingList].push_back( newtonNode );
+    }
+    newtonNode->curPose = matrix;
+}
+
+void CNewton::ForgetPose( CNewtonNode* newtonNode )
+{
+    for ( int l = 0; l < 2; l++ )
+    {
+      for ( u32 i = 0; i < movingNodes[l].size(); i++ )
+      {
+        if ( movingNodes[l][i] == newtonNode )
+        {
+          movingNodes[l].erase( i );
+          break;
+        }
+      }
+    }
+
+    for ( u32 t = 0; t <= MAX_JOB_WORKERS; t++ )
+    {
+      // left in place, the commands may be running
+      array<SPhysicsCommand>& commands = threads[t].commands;
+      for ( u32 i = 0; i < commands.size(); i++ )
+      {
+        if ( commands[i].node == newtonNode )
+        {
+          commands[i].type = PHYSICSCMD_NONE;
+        }
+      }
+    }
+}
+
+void CNewton::Interpolate( f32 alpha )
+{
+    array<CNewtonNode*>& nodes = movingNodes[movingList];
+    interpolatedPoses.set_used( nodes.size() );
+    interpolateAlpha = alpha;
+
+    // the slerps only read the poses, the scene nodes are placed here after
+    JOBS.ParallelFor( "Physics interpolate", InterpolateJob, this, nodes.size(), INTERPOLATE_GRAIN );
+
+    for ( u32 i = 0; i < nodes.size(); i++ )
+    {
+      nodes[i]->SetNodeTransform( interpolatedPoses[i] );
+    }
+}
+
+void CNewton::InterpolateJob( void* data, u32 begin, u32 end )
+{
+    CNewton* physics = ( CNewton* )data;
+    CNewtonNode** nodes = physics->movingNodes[physics->movingList].pointer();
+    f32 alpha = physics->interpolateAlpha;
+
+    quaternion qPrev, qCur, q;
+    for ( u32 i = begin; i < end; i++ )
+    {
+      CNewtonNode* newtonNode = nodes[i];
+      qPrev = quaternion( newtonNode->prevPose );
+      qCur = quaternion( newtonNode->curPose );
+      q.slerp( qPrev, qCur, alpha );
+      matrix4& pose = physics->interpolatedPoses[i];
+      pose = q.getMatrix();
+      pose.setTranslation( newtonNode->prevPose.getTranslation() + ( newtonNode->curPose.getTranslation() - newtonNode->prevPose.getTranslation() ) * alpha );
+    }
+}
+
 void CNewton::Stop()
 {
+    IRR.RemoveDependency( this );
+
+    for ( u32 t = 0; t <= MAX_JOB_WORKERS; t++ )
+    {
+      threads[t].commands.clear();
+    }
+
     CleanUpMaterials();
     if ( !canKill ) //it was already done in WorldTask->Stop()
     {
+      COLLISIONCACHE->ReleaseShapes( nWorld );
       NewtonDestroy( nWorld );
     }
 }
@@ -178,10 +432,13 @@ void CNewton::PhysicsSetTransform( const NewtonBody* body, const dFloat* matrix
       return;
     }   
 
-    static matrix4 mat;
-    memcpy( mat.M, matrix, sizeof( s32 ) * 16 );
-    node->setRotation( mat.getRotationDegrees() );
-    node->setPosition( mat.getTranslation() ); //*IrrToNewton
+    // placed after the step, like the CNewtonNode transforms
+    SPhysicsCommand command;
+    command.type = PHYSICSCMD_NODETRANSFORM;
+    command.node = NULL;
+    command.sceneNode = node;
+    memcpy( command.matrix.M, matrix, sizeof( dFloat ) * 16 );
+    FromBody( body )->QueueCommand( command );
 }
 
 // rigid body destructor
@@ -535,6 +792,36 @@ void CNewton::addLocalForce( const NewtonBody* body, core::vector3df force, core
 }
 
 
+s32 CNewton::StaticContacts( const NewtonCollision* collision, const matrix4& matrix, vector3df* contacts, vector3df* normals, f32* penetrations, s32 maxContacts )
+{
+    vector3df vMin, vMax;
+    NewtonCollisionCalculateAABB( collision, &matrix.M[0], &vMin.X, &vMax.X );
+    foundStatics.set_used( 0 );
+    NewtonWorldForEachBodyInAABBDo( nWorld, &vMin.X, &vMax.X, CollectStaticBody );
+
+    vector3df vCenter = matrix.getTranslation();
+    dFloat points[STATIC_CONTACTS_PAIR * 3], pairNormals[STATIC_CONTACTS_PAIR * 3], pairPenetrations[STATIC_CONTACTS_PAIR];
+    s32 num = 0;
+    for ( u32 i = 0; ( i < foundStatics.size() ) && ( num < maxContacts ); i++ )
+    {
+      matrix4 bodyMatrix;
+      NewtonBodyGetMatrix( foundStatics[i], &bodyMatrix.M[0] );
+      s32 pairNum = NewtonCollisionCollide( nWorld, min( maxContacts - num, STATIC_CONTACTS_PAIR ), collision, &matrix.M[0], NewtonBodyGetCollision( foundStatics[i] ), &bodyMatrix.M[0], points, pairNormals, pairPenetrations );
+      for ( s32 j = 0; j < pairNum; j++ )
+      {
+        contacts[num].set( points[j * 3], points[j * 3 + 1], points[j * 3 + 2] );
+        normals[num].set( pairNormals[j * 3], pairNormals[j * 3 + 1], pairNormals[j * 3 + 2] );
+        if ( ( vCenter - contacts[num] ).dotProduct( normals[num] ) < 0.0f )
+        {
+          normals[num] = -normals[num];
+        }
+        penetrations[num] = pairPenetrations[j];
+        num++;
+      }
+    }
+    return num;
+}
+
 vector3df CNewton::getPointVelocity( const NewtonBody* body, vector3df vPos )
 {
     matrix4 m;
@@ -654,18 +941,20 @@ void CNewton::CleanUpMaterials()
 // this callback is called when the two aabb boxes of the collisiong object overlap
 int CNewton::GenericContactBegin( const NewtonMaterial* material, const NewtonBody* body0, const NewtonBody* body1 )
 {
-    // get the pointer to the special effect struture
-    g_currectEffect = ( SpecialEffectStruct * )NewtonMaterialGetMaterialPairUserData( material );
+    // get the pointer to the special effect struture, the pair's own copy is
+    // worked on since other threads may be processing the same materials
+    SpecialEffectStruct* currentEffect = CurrentContact();
+    *currentEffect = *( SpecialEffectStruct * )NewtonMaterialGetMaterialPairUserData( material );
 
     // save the collisiong bodies
-    g_currectEffect->m_body0 = ( NewtonBody * )body0;
-    g_currectEffect->m_body1 = ( NewtonBody * )body1;
+    currentEffect->m_body0 = ( NewtonBody * )body0;
+    currentEffect->m_body1 = ( NewtonBody * )body1;
 
     // clear the contact normal speed 
-    g_currectEffect->m_contactMaxNormalSpeed = 0.0f;
+    currentEffect->m_contactMaxNormalSpeed = 0.0f;
 
     // clear the contact sliding speed 
-    g_currectEffect->m_contactMaxTangentSpeed = 0.0f;
+    currentEffect->m_contactMaxTangentSpeed = 0.0f;
 
     // return one the tell Newton the application wants to proccess this contact
     return 1;
@@ -678,14 +967,15 @@ int CNewton::GenericContactProcess( const NewtonMaterial* material, const Newton
     dFloat speed0;
     dFloat speed1;
     dVector normal;
+    SpecialEffectStruct* currentEffect = CurrentContact();
 
     // Get the maximun normal speed of this impact. this can be used for particels of playing collision sound
     speed0 = NewtonMaterialGetContactNormalSpeed( material, contact );
-    if ( speed0 > g_currectEffect->m_contactMaxNormalSpeed )
+    if ( speed0 > currentEffect->m_contactMaxNormalSpeed )
     {
       // save the position of the contact (for 3d sound of particles effects)
-      g_currectEffect->m_contactMaxNormalSpeed = speed0;
-      NewtonMaterialGetContactPositionAndNormal( material, &g_currectEffect->m_position.m_x, &normal.m_x );
+      currentEffect->m_contactMaxNormalSpeed = speed0;
+      NewtonMaterialGetContactPositionAndNormal( material, &currentEffect->m_position.m_x, &normal.m_x );
     }
 
     // get the maximun of the two sliding contact speed
@@ -697,11 +987,11 @@ int CNewton::GenericContactProcess( const NewtonMaterial* material, const Newton
     }
 
     // Get the maximun tangent speed of this contact. this can be used for particles(sparks) of playing scratch sounds 
-    if ( speed0 > g_currectEffect->m_contactMaxTangentSpeed )
+    if ( speed0 > currentEffect->m_contactMaxTangentSpeed )
     {
       // save the position of the contact (for 3d sound of particles effects)
-      g_currectEffect->m_contactMaxTangentSpeed = speed0;
-      NewtonMaterialGetContactPositionAndNormal( material, &g_currectEffect->m_position.m_x, &normal.m_x );
+      currentEffect->m_contactMaxTangentSpeed = speed0;
+      NewtonMaterialGetContactPositionAndNormal( material, &currentEffect->m_position.m_x, &normal.m_x );
     }
 
     //if (debugLinesMode) {
@@ -726,16 +1016,18 @@ void CNewton::GenericContactEnd( const NewtonMaterial* material )
 #define MIN_CONTACT_SPEED 15
 #define MIN_SCRATCH_SPEED 5
 
+    SpecialEffectStruct* currentEffect = CurrentContact();
+
     // if the max contact speed is larger than some minumum value. play a sound
-    if ( g_currectEffect->m_contactMaxNormalSpeed > MIN_CONTACT_SPEED )
+    if ( currentEffect->m_contactMaxNormalSpeed > MIN_CONTACT_SPEED )
     {
-      g_currectEffect->PlayImpactSound( g_currectEffect->m_contactMaxNormalSpeed - MIN_CONTACT_SPEED );
+      currentEffect->PlayImpactSound( currentEffect->m_contactMaxNormalSpeed - MIN_CONTACT_SPEED );
     }
 
     // if the max contact speed is larger than some minumum value. play a sound
-    if ( g_currectEffect->m_contactMaxNormalSpeed > MIN_SCRATCH_SPEED )
+    if ( currentEffect->m_contactMaxNormalSpeed > MIN_SCRATCH_SPEED )
     {
-      g_currectEffect->PlayScratchSound( g_currectEffect->m_contactMaxNormalSpeed - MIN_SCRATCH_SPEED );
+      currentEffect->PlayScratchSound( currentEffect->m_contactMaxNormalSpeed - MIN_SCRATCH_SPEED );
     }
 
     // implement here any other effects
@@ -753,6 +1045,7 @@ int CNewton::NodeLevelContactProcess( const NewtonMaterial* material, const Newt
     NewtonBody* body;
     NewtonBody* body2;
     CNewtonNode* newtonNode;
+    SpecialEffectStruct* currentEffect = CurrentContact();
     //  unsigned collisionID;
 
     // apply the default behaviuor
@@ -762,14 +1055,14 @@ int CNewton::NodeLevelContactProcess( const NewtonMaterial* material, const Newt
     // This is a quit and dirty way to determine the player body, but it no safe, 
     // it only work in this case because one of the two bodies is the terrain which we now have //infinite mass.
     // a better way to do this is by getting the user data and finding some object identifier stored with the user data.
-    body = g_currectEffect->m_body0;
-    body2 = g_currectEffect->m_body1;
-    NewtonBodyGetMassMatrix( g_currectEffect->m_body0, &mass, &Ixx, &Iyy, &Izz );
+    body = currentEffect->m_body0;
+    body2 = currentEffect->m_body1;
+    NewtonBodyGetMassMatrix( currentEffect->m_body0, &mass, &Ixx, &Iyy, &Izz );
     if ( mass == 0.0f )
     {
-      body = g_currectEffect->m_body1;
-      body2 = g_currectEffect->m_body0;
-      NewtonBodyGetMassMatrix( g_currectEffect->m_body1, &mass, &Ixx, &Iyy, &Izz );
+      body = currentEffect->m_body1;
+      body2 = currentEffect->m_body0;
+      NewtonBodyGetMassMatrix( currentEffect->m_body1, &mass, &Ixx, &Iyy, &Izz );
     }
 
     // Get the pointer to the character
@@ -815,6 +1108,7 @@ int CNewton::NodeContactProcess( const NewtonMaterial* material, const NewtonCon
     dFloat Izz;
     NewtonBody* body;
     CNewtonNode* newtonNode;
+    SpecialEffectStruct* currentEffect = CurrentContact();
     //  unsigned collisionID;
 
     // apply the default behaviuor
@@ -822,11 +1116,11 @@ int CNewton::NodeContactProcess( const NewtonMaterial* material, const NewtonCon
 
     // Get the pointer to the character
 
-    newtonNode = ( CNewtonNode * )NewtonBodyGetUserData( g_currectEffect->m_body0 );
-    newtonNode->PhysicsCollision( material, contact, g_currectEffect->m_body1 );
+    newtonNode = ( CNewtonNode * )NewtonBodyGetUserData( currentEffect->m_body0 );
+    newtonNode->PhysicsCollision( material, contact, currentEffect->m_body1 );
 
-    newtonNode = ( CNewtonNode * )NewtonBodyGetUserData( g_currectEffect->m_body1 );
-    newtonNode->PhysicsCollision( material, contact, g_currectEffect->m_body0 );
+    newtonNode = ( CNewtonNode * )NewtonBodyGetUserData( currentEffect->m_body1 );
+    newtonNode->PhysicsCollision( material, contact, currentEffect->m_body0 );
 
 
     // return one to tell Newton we want to accept this contact
@@ -18,6 +18,27 @@
 #include "../IrrConsole/console_vars.h"
 
 
+class CNewtonNode;
+
+// what a physics callback leaves to the main thread, run after NewtonUpdate()
+enum E_PHYSICS_COMMAND { PHYSICSCMD_NONE, PHYSICSCMD_TRANSFORM, PHYSICSCMD_NODETRANSFORM, PHYSICSCMD_ENTERWATER, PHYSICSCMD_EXITWATER, PHYSICSCMD_EFFECT };
+
+struct SPhysicsCommand
+{
+    s32 type;
+    CNewtonNode* node;
+    // a body made by addRigidBodyBox() and addStaticBodyBox() only has a scene node
+    ISceneNode* sceneNode;
+    matrix4 matrix;
+    // water
+    s32 zone;
+    // effect, the name is compared by address so it has to be a literal
+    const c8* effect;
+    vector3df vOldPos, vNewPos;
+    f32 oneOverMass, radius;
+    s32 aliveTime;
+};
+
 // scale factor between Newton and IRR
 const float NewtonToIrr = 0.1f;
 const float IrrToNewton = ( 1.0f / NewtonToIrr );
@@ -58,6 +79,10 @@ struct SpecialEffectStruct
 
 ////////////////////////////////////////////
 // CNewton 
+// - the body and contact callbacks only change their own bodies and nodes,
+//   anything else goes into the calling thread's command buffer and runs on
+//   the main thread once the step is done
+// - map zones and planes are only read during a step
 ////////////////////////////////////////////
 class CNewton : public ITask
 {
@@ -78,6 +103,26 @@ class CNewton : public ITask
     static void DebugShowBodyCollision( const NewtonBody* body );
     virtual void Render();
 
+    // bodies moved by a step are drawn between their last two poses
+    void SetPose( CNewtonNode* newtonNode, const matrix4& matrix );
+    // the node is going, its poses and commands go with it
+    void ForgetPose( CNewtonNode* newtonNode );
+
+    // the world stepping body
+    static CNewton* FromBody( const NewtonBody* body );
+    // callbacks
+    void QueueCommand( const SPhysicsCommand& command );
+    void QueueEffect( const c8* effect, vector3df vOldPos, vector3df vNewPos, f32 oneOverMass, f32 radius, s32 aliveTime );
+    // the calling thread's list for zone queries
+    array<s32>& GetZoneScratch()
+    {
+        return threads[JOBS.Self()].zones;
+    }
+
+    // where a shape at matrix touches the static bodies, without stepping the
+    // world, the normals point at the shape; main thread only
+    s32 StaticContacts( const NewtonCollision* collision, const matrix4& matrix, vector3df* contacts, vector3df* normals, f32* penetrations, s32 maxContacts );
+
     NewtonBody* addStaticBodyTree( ISceneNode* node, char* filename, vector3df vPos, vector3df vScale );
     NewtonBody* addRigidBodyBox( ISceneNode* node, vector3df vSize, vector3df vPos );
     NewtonBody* addStaticBodyBox( ISceneNode* node, vector3df vSize, vector3df vPos, vector3df vRot );
@@ -101,6 +146,8 @@ class CNewton : public ITask
     NewtonWorld* nWorld;
     static dFloat dGravity;
     float timeStep;
+    int stepRate, maxSteps;
+    bool bInterpolate;
 
     //materials
     static int woodID; 
@@ -113,10 +160,36 @@ class CNewton : public ITask
     void SetupMaterials();
     void CleanUpMaterials();
 
+    void Step( float step );
+    void RunCommands();
+    s32 GetEffectType( const c8* effect );
+    void Interpolate( f32 alpha );
+    static void InterpolateJob( void* data, u32 begin, u32 end );
+
     int minFrames;
-    double deltaTime, curTime, lastTime;
+    // microseconds
+    unsigned int lastTime;
     double mAccumlativeLoopTime;
 
+    // nodes that got a pose in the current and in the previous step
+    array<CNewtonNode*> movingNodes[2];
+    int movingList;
+    u32 stepCounter;
+
+    // the interpolated poses, worked out on the job threads
+    array<matrix4> interpolatedPoses;
+    f32 interpolateAlpha;
+
+    struct SPhysicsThread
+    {
+        array<SPhysicsCommand> commands;
+        array<s32> zones;
+    };
+    SPhysicsThread threads[MAX_JOB_WORKERS + 1];
+
+    array<const c8*> effectNames;
+    array<s32> effectTypes;
+
     //materials
     static int GenericContactBegin( const NewtonMaterial* material, const NewtonBody* body0, const NewtonBody* body1 );
     static int NodeContactProcess( const NewtonMaterial* material, const NewtonContact* contact );
@@ -131,7 +204,12 @@ class CNewton : public ITask
     static SpecialEffectStruct metal_metal;
     static SpecialEffectStruct metal_level;
 
-    static SpecialEffectStruct* g_currectEffect;
+    // the pair each thread is processing
+    static SpecialEffectStruct currentContacts[MAX_JOB_WORKERS + 1];
+    static SpecialEffectStruct* CurrentContact()
+    {
+        return &currentContacts[JOBS.Self()];
+    }
 
     //{********** NUMBER27's TIMING ROUTINES ***********}
     void Number27Timing();
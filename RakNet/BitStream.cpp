@@ -315,6 +315,51 @@ void BitStream::AlignReadToByteBoundary( void )
     }
 }
 
+// The stream is most significant bit first, so a word holds the next bytes from its top down
+#ifdef _MSC_VER
+typedef unsigned __int64 BitStreamWord;
+#else
+typedef unsigned long long BitStreamWord;
+#endif
+
+static inline BitStreamWord LoadWord( const unsigned char* input, const int numberOfBytes )
+{
+    if ( numberOfBytes == 8 )
+    {
+      // Spelled out so the compiler can make it one load and a byte swap
+      return ( ( BitStreamWord )input[0] << 56 ) | ( ( BitStreamWord )input[1] << 48 ) | ( ( BitStreamWord )input[2] << 40 ) | ( ( BitStreamWord )input[3] << 32 ) |
+             ( ( BitStreamWord )input[4] << 24 ) | ( ( BitStreamWord )input[5] << 16 ) | ( ( BitStreamWord )input[6] << 8 ) | ( BitStreamWord )input[7];
+    }
+
+    BitStreamWord word = 0;
+    for ( int i = 0; i < numberOfBytes; i++ )
+    {
+      word |= ( BitStreamWord )input[i] << ( 56 - ( i << 3 ) );
+    }
+    return word;
+}
+
+static inline void StoreWord( unsigned char* output, const BitStreamWord word, const int numberOfBytes )
+{
+    if ( numberOfBytes == 8 )
+    {
+      output[0] = ( unsigned char )( word >> 56 );
+      output[1] = ( unsigned char )( word >> 48 );
+      output[2] = ( unsigned char )( word >> 40 );
+      output[3] = ( unsigned char )( word >> 32 );
+      output[4] = ( unsigned char )( word >> 24 );
+      output[5] = ( unsigned char )( word >> 16 );
+      output[6] = ( unsigned char )( word >> 8 );
+      output[7] = ( unsigned char )word;
+      return;
+    }
+
+    for ( int i = 0; i < numberOfBytes; i++ )
+    {
+      output[i] = ( unsigned char )( word >> ( 56 - ( i << 3 ) ) );
+    }
+}
+
 // Write numberToWrite bits from the input source
 void BitStream::WriteBits( const unsigned char* input, int numberOfBitsToWrite, const bool rightAlignedBits )
 {
@@ -324,19 +369,42 @@ void BitStream::WriteBits( const unsigned char* input, int numberOfBitsToWrite,
     }
 
     AddBitsAndReallocate( numberOfBitsToWrite );
-    int offset = 0;
-    unsigned char dataByte;
-    int numberOfBitsUsedMod8;
 
-    numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+    int numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+    int wholeBytes = numberOfBitsToWrite >> 3;
+
+    if ( numberOfBitsUsedMod8 == 0 )
+    {
+      // Aligned, the whole bytes are a straight copy
+      memcpy( data + ( numberOfBitsUsed >> 3 ), input, wholeBytes );
+    }
+    else
+    {
+      // Unaligned, up to 64 bits at a time are shifted across the byte boundary.  The first byte
+      // is completed and the last one gets the leftover high bits, the rest of it stays 0.
+      // With a word of room past the end, the store is always a whole word, the bytes past the
+      // end are not used yet and get zeros
+      unsigned char* output = data + ( numberOfBitsUsed >> 3 );
+      bool bRoom = numberOfBitsUsed + numberOfBitsToWrite + 64 <= numberOfBitsAllocated;
+      for ( int i = 0; i < wholeBytes; i += 8 )
+      {
+        int numberOfBytes = wholeBytes - i < 8 ? wholeBytes - i : 8;
+        BitStreamWord word = LoadWord( input + i, numberOfBytes );
+        *output |= ( unsigned char )( word >> ( 56 + numberOfBitsUsedMod8 ) );
+        StoreWord( output + 1, word << ( 8 - numberOfBitsUsedMod8 ), bRoom ? 8 : numberOfBytes );
+        output += numberOfBytes;
+      }
+    }
+
+    numberOfBitsUsed += wholeBytes << 3;
+    numberOfBitsToWrite -= wholeBytes << 3;
 
-    // Faster to put the while at the top surprisingly enough
-    while ( numberOfBitsToWrite > 0 )
-                //do
+    // The last partial byte
+    if ( numberOfBitsToWrite > 0 )
     {
-      dataByte = *( input + offset );
+      unsigned char dataByte = input[wholeBytes];
 
-      if ( numberOfBitsToWrite < 8 && rightAlignedBits )   // rightAlignedBits means in the case of a partial byte, the bits are aligned from the right (bit 0) rather than the left (as in the normal internal representation)
+      if ( rightAlignedBits )   // rightAlignedBits means in the case of a partial byte, the bits are aligned from the right (bit 0) rather than the left (as in the normal internal representation)
       {
         dataByte <<= 8 - numberOfBitsToWrite;
       }  // shift left to get the bits on the left, as in our internal representation
@@ -351,26 +419,14 @@ void BitStream::WriteBits( const unsigned char* input, int numberOfBitsToWrite,
         // Copy over the new data.
         *( data + ( numberOfBitsUsed >> 3 ) ) |= dataByte >> ( numberOfBitsUsedMod8 ); // First half
 
-        if ( 8 - ( numberOfBitsUsedMod8 ) < 8 && 8 - ( numberOfBitsUsedMod8 ) < numberOfBitsToWrite )   // If we didn't write it all out in the first half (8 - (numberOfBitsUsed%8) is the number we wrote in the first half)
+        if ( 8 - ( numberOfBitsUsedMod8 ) < numberOfBitsToWrite )   // If we didn't write it all out in the first half (8 - (numberOfBitsUsed%8) is the number we wrote in the first half)
         {
           *( data + ( numberOfBitsUsed >> 3 ) + 1 ) = ( unsigned char ) ( dataByte << ( 8 - ( numberOfBitsUsedMod8 ) ) ); // Second half (overlaps byte boundary)
         }
       }
 
-      if ( numberOfBitsToWrite >= 8 )
-      {
-        numberOfBitsUsed += 8;
-      }
-      else
-      {
-        numberOfBitsUsed += numberOfBitsToWrite;
-      }
-
-      numberOfBitsToWrite -= 8;
-
-      offset++;
+      numberOfBitsUsed += numberOfBitsToWrite;
     }
-    // } while(numberOfBitsToWrite>0);
 }
 
 // Set the stream to some initial data.  For internal use
@@ -466,46 +522,60 @@ bool BitStream::ReadBits( unsigned char* output, int numberOfBitsToRead, const b
       return false;
     }
 
-    int readOffsetMod8;
-
-    int offset = 0;
+    int readOffsetMod8 = readOffset & 7;
+    int wholeBytes = numberOfBitsToRead >> 3;
 
-    memset( output, 0, BITS_TO_BYTES( numberOfBitsToRead ) );
+    if ( readOffsetMod8 == 0 )
+    {
+      // Aligned, the whole bytes are a straight copy
+      memcpy( output, data + ( readOffset >> 3 ), wholeBytes );
+    }
+    else
+    {
+      // Unaligned, up to 64 bits at a time are put together from the bytes they straddle.
+      // The byte after the span holds its last bits, the bounds check above covers it
+      const unsigned char* input = data + ( readOffset >> 3 );
+      for ( int i = 0; i < wholeBytes; i += 8 )
+      {
+        int numberOfBytes = wholeBytes - i < 8 ? wholeBytes - i : 8;
+        BitStreamWord word;
+        if ( numberOfBytes < 8 )
+        {
+          // The straddled bytes fit in one word
+          word = LoadWord( input, numberOfBytes + 1 ) << readOffsetMod8;
+        }
+        else
+        {
+          word = LoadWord( input, 8 ) << readOffsetMod8;
+          word |= ( BitStreamWord )( input[8] >> ( 8 - readOffsetMod8 ) );
+        }
+        StoreWord( output + i, word, numberOfBytes );
+        input += numberOfBytes;
+      }
+    }
 
-    readOffsetMod8 = readOffset & 7;
+    readOffset += wholeBytes << 3;
+    numberOfBitsToRead -= wholeBytes << 3;
 
-    // do
-    // Faster to put the while at the top surprisingly enough
-    while ( numberOfBitsToRead > 0 )
+    // The last partial byte
+    if ( numberOfBitsToRead > 0 )
     {
-      *( output + offset ) |= *( data + ( readOffset >> 3 ) ) << ( readOffsetMod8 ); // First half
+      unsigned char dataByte = ( unsigned char )( *( data + ( readOffset >> 3 ) ) << ( readOffsetMod8 ) ); // First half
 
       if ( readOffsetMod8 > 0 && numberOfBitsToRead > 8 - ( readOffsetMod8 ) )   // If we have a second half, we didn't read enough bytes in the first half
       {
-        *( output + offset ) |= *( data + ( readOffset >> 3 ) + 1 ) >> ( 8 - ( readOffsetMod8 ) );
+        dataByte |= *( data + ( readOffset >> 3 ) + 1 ) >> ( 8 - ( readOffsetMod8 ) );
       } // Second half (overlaps byte boundary)
 
-      numberOfBitsToRead -= 8;
-
-      if ( numberOfBitsToRead < 0 )   // Reading a partial byte for the last byte, shift right so the data is aligned on the right
+      if ( alignBitsToRight )   // Reading a partial byte for the last byte, shift right so the data is aligned on the right
       {
-        if ( alignBitsToRight )
-        {
-          *( output + offset ) >>= -numberOfBitsToRead;
-        }
-
-        readOffset += 8 + numberOfBitsToRead;
-      }
-      else
-      {
-        readOffset += 8;
+        dataByte >>= 8 - numberOfBitsToRead;
       }
 
-      offset++;
+      output[wholeBytes] = dataByte;
+      readOffset += numberOfBitsToRead;
     }
 
-    //} while(numberOfBitsToRead>0);
-
     return true;
 }
 
@@ -594,6 +664,176 @@ bool BitStream::ReadCompressed( unsigned char* output, const int size, const boo
     return true;
 }
 
+// Fixed point of value in [min, max] over numberOfBits, clamped
+static unsigned int QuantizeFloat( float value, float min, float max, int numberOfBits )
+{
+    double maxValue = numberOfBits >= 32 ? 4294967295.0 : ( double )( ( 1u << numberOfBits ) - 1 );
+    double t = max > min ? ( ( double )value - min ) / ( ( double )max - min ) : 0.0;
+    if ( t < 0.0 )
+    {
+      t = 0.0;
+    }
+    if ( t > 1.0 )
+    {
+      t = 1.0;
+    }
+    return ( unsigned int )( t * maxValue + 0.5 );
+}
+
+static float DequantizeFloat( unsigned int quantized, float min, float max, int numberOfBits )
+{
+    double maxValue = numberOfBits >= 32 ? 4294967295.0 : ( double )( ( 1u << numberOfBits ) - 1 );
+    return ( float )( min + ( ( double )max - min ) * ( quantized / maxValue ) );
+}
+
+// The bits go out lowest byte first, the way WriteCompressed writes the low bytes of a type,
+// but put together by hand so both ends agree whatever their byte order.
+// Past 32 bits there is nothing more to send, and bytes[] would be overrun
+static void WriteQuantized( BitStream* bitStream, unsigned int quantized, int numberOfBits )
+{
+    assert( numberOfBits > 0 && numberOfBits <= 32 );
+    if ( numberOfBits > 32 )
+    {
+      numberOfBits = 32;
+    }
+    unsigned char bytes[4];
+    bytes[0] = ( unsigned char )quantized;
+    bytes[1] = ( unsigned char )( quantized >> 8 );
+    bytes[2] = ( unsigned char )( quantized >> 16 );
+    bytes[3] = ( unsigned char )( quantized >> 24 );
+    bitStream->WriteBits( bytes, numberOfBits, true );
+}
+
+static bool ReadQuantized( BitStream* bitStream, unsigned int& quantized, int numberOfBits )
+{
+    assert( numberOfBits > 0 && numberOfBits <= 32 );
+    if ( numberOfBits > 32 )
+    {
+      numberOfBits = 32;
+    }
+    unsigned char bytes[4] = { 0, 0, 0, 0 };
+    if ( !bitStream->ReadBits( bytes, numberOfBits, true ) )
+    {
+      return false;
+    }
+    quantized = bytes[0] | ( bytes[1] << 8 ) | ( bytes[2] << 16 ) | ( ( unsigned int )bytes[3] << 24 );
+    return true;
+}
+
+void BitStream::WriteQuantizedFloat( float value, float min, float max, int numberOfBits )
+{
+    WriteQuantized( this, QuantizeFloat( value, min, max, numberOfBits ), numberOfBits );
+}
+
+bool BitStream::ReadQuantizedFloat( float& value, float min, float max, int numberOfBits )
+{
+    unsigned int quantized;
+    if ( !ReadQuantized( this, quantized, numberOfBits ) )
+    {
+      return false;
+    }
+    value = DequantizeFloat( quantized, min, max, numberOfBits );
+    return true;
+}
+
+void BitStream::WriteQuantizedVector( float x, float y, float z, const float* boundsMin, const float* boundsMax, int numberOfBits )
+{
+    WriteQuantizedFloat( x, boundsMin[0], boundsMax[0], numberOfBits );
+    WriteQuantizedFloat( y, boundsMin[1], boundsMax[1], numberOfBits );
+    WriteQuantizedFloat( z, boundsMin[2], boundsMax[2], numberOfBits );
+}
+
+bool BitStream::ReadQuantizedVector( float& x, float& y, float& z, const float* boundsMin, const float* boundsMax, int numberOfBits )
+{
+    return ReadQuantizedFloat( x, boundsMin[0], boundsMax[0], numberOfBits ) && ReadQuantizedFloat( y, boundsMin[1], boundsMax[1], numberOfBits ) && ReadQuantizedFloat( z, boundsMin[2], boundsMax[2], numberOfBits );
+}
+
+// 360 itself wraps to 0, so the steps are a full turn over 2^numberOfBits
+void BitStream::WriteAngle( float degrees, int numberOfBits )
+{
+    double steps = numberOfBits >= 32 ? 4294967296.0 : ( double )( 1u << numberOfBits );
+    double turns = fmod( ( double )degrees, 360.0 ) / 360.0;
+    if ( turns < 0.0 )
+    {
+      turns += 1.0;
+    }
+    double step = floor( turns * steps + 0.5 );
+    if ( step >= steps )
+    {
+      step = 0.0;
+    }
+    WriteQuantized( this, ( unsigned int )step, numberOfBits );
+}
+
+bool BitStream::ReadAngle( float& degrees, int numberOfBits )
+{
+    double steps = numberOfBits >= 32 ? 4294967296.0 : ( double )( 1u << numberOfBits );
+    unsigned int step;
+    if ( !ReadQuantized( this, step, numberOfBits ) )
+    {
+      return false;
+    }
+    degrees = ( float )( step * 360.0 / steps );
+    return true;
+}
+
+// The three smaller components of a unit quaternion are within +-1/sqrt(2)
+#define SMALLEST_THREE_RANGE 0.70710678f
+
+void BitStream::WriteSmallestThreeQuat( float w, float x, float y, float z, int componentBits )
+{
+    float components[4] = { w, x, y, z };
+    unsigned char largest = 0;
+    for ( unsigned char i = 1; i < 4; i++ )
+    {
+      if ( fabs( components[i] ) > fabs( components[largest] ) )
+      {
+        largest = i;
+      }
+    }
+
+    // q and -q are the same rotation, the largest is sent as positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    WriteBits( &largest, 2, true );
+    for ( unsigned char i = 0; i < 4; i++ )
+    {
+      if ( i != largest )
+      {
+        WriteQuantizedFloat( components[i] * sign, -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, componentBits );
+      }
+    }
+}
+
+bool BitStream::ReadSmallestThreeQuat( float& w, float& x, float& y, float& z, int componentBits )
+{
+    unsigned char largest = 0;
+    if ( !ReadBits( &largest, 2, true ) )
+    {
+      return false;
+    }
+
+    float components[4];
+    float sum = 0.0f;
+    for ( unsigned char i = 0; i < 4; i++ )
+    {
+      if ( i != largest )
+      {
+        if ( !ReadQuantizedFloat( components[i], -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, componentBits ) )
+        {
+          return false;
+        }
+        sum += components[i] * components[i];
+      }
+    }
+    components[largest] = sum < 1.0f ? sqrtf( 1.0f - sum ) : 0.0f;
+
+    w = components[0];
+    x = components[1];
+    y = components[2];
+    z = components[3];
+    return true;
+}
+
 // Reallocates (if necessary) in preparation of writing numberOfBitsToWrite
 void BitStream::AddBitsAndReallocate( const int numberOfBitsToWrite )
 {
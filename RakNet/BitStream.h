@@ -183,6 +183,52 @@ namespace RakNet
 
         void WriteOrthMatrix( templateType m00, templateType m01, templateType m02, templateType m10, templateType m11, templateType m12, templateType m20, templateType m21, templateType m22 );
 
+        /// Write a float between min and max as numberOfBits of fixed point. Values outside are clamped.
+        /// \param[in] value value
+        /// \param[in] min The lowest value that can be written
+        /// \param[in] max The highest value that can be written
+        /// \param[in] numberOfBits 1 to 32
+        void WriteQuantizedFloat( float value, float min, float max, int numberOfBits );
+
+        /// Write a position within bounds, such as the map's, in numberOfBits per axis instead of 32.
+        /// \param[in] x x
+        /// \param[in] y y
+        /// \param[in] z z
+        /// \param[in] boundsMin The lowest corner, 3 floats
+        /// \param[in] boundsMax The highest corner, 3 floats
+        /// \param[in] numberOfBits 1 to 32
+        void WriteQuantizedVector( float x, float y, float z, const float* boundsMin, const float* boundsMax, int numberOfBits );
+
+        /// Write an angle in degrees, wrapped to [0, 360), in numberOfBits.
+        /// \param[in] degrees degrees
+        /// \param[in] numberOfBits 1 to 32
+        void WriteAngle( float degrees, int numberOfBits );
+
+        /// Write a normalized quaternion as the index of its largest component in 2 bits and the
+        /// other three in componentBits each. The largest is rebuilt from them on read.
+        /// \param[in] w w
+        /// \param[in] x x
+        /// \param[in] y y
+        /// \param[in] z z
+        /// \param[in] componentBits 1 to 32, 10 is good for most rotations
+        void WriteSmallestThreeQuat( float w, float x, float y, float z, int componentBits );
+
+        /// Read a float written with WriteQuantizedFloat and the same range and bits.
+        /// \return true on success false if there is some missing bits.
+        bool ReadQuantizedFloat( float& value, float min, float max, int numberOfBits );
+
+        /// Read a position written with WriteQuantizedVector and the same bounds and bits.
+        /// \return true on success false if there is some missing bits.
+        bool ReadQuantizedVector( float& x, float& y, float& z, const float* boundsMin, const float* boundsMax, int numberOfBits );
+
+        /// Read an angle written with WriteAngle, in [0, 360).
+        /// \return true on success false if there is some missing bits.
+        bool ReadAngle( float& degrees, int numberOfBits );
+
+        /// Read a quaternion written with WriteSmallestThreeQuat and the same bits.
+        /// \return true on success false if there is some missing bits.
+        bool ReadSmallestThreeQuat( float& w, float& x, float& y, float& z, int componentBits );
+
         /// Read an array or casted stream of byte. The array
         /// is raw data. There is no automatic endian conversion with this function
         /// \param[in] output The result byte array. It should be larger than @em numberOfBytes. 
@@ -3,7 +3,7 @@
 
 #include "network.h"
 
-enum { ID_CRIMSON_DEFAULT = ID_RESERVED9 + 1, ID_CRIMSON_NEWACTOR, ID_CRIMSON_CHAT, ID_CRIMSON_VERIFYFILES, ID_CRIMSON_CLIENTOK };
+enum { ID_CRIMSON_DEFAULT = ID_RESERVED9 + 1, ID_CRIMSON_NEWACTOR, ID_CRIMSON_CHAT, ID_CRIMSON_VERIFYFILES, ID_CRIMSON_CLIENTOK, ID_CRIMSON_SNAPSHOT, ID_CRIMSON_SNAPSHOTACK, ID_CRIMSON_JOINSTATE, ID_CRIMSON_INPUT };
 
 //#pragma pack(1)
 //struct structName
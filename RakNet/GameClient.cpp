@@ -11,6 +11,7 @@
 
 #include "../Newton/newton_node.h"
 #include "CustomPackets.h"
+#include "snapshot.h"
 
 #include "BitStream.h"
 
@@ -149,6 +150,10 @@ void CGameClient::ProcessPacket( unsigned char packetIdentifier )
         ReceiveNewActor( p );
         break;
 
+      case ID_CRIMSON_JOINSTATE:
+        ReceiveJoinState( p );
+        break;
+
       case ID_CRIMSON_VERIFYFILES:
         ReceiveVerifyFiles( p );
         break;
@@ -157,6 +162,10 @@ void CGameClient::ProcessPacket( unsigned char packetIdentifier )
         ReceiveChat( p );
         break;
 
+      case ID_CRIMSON_SNAPSHOT:
+        SNAPSHOTS->ReceiveSnapshot( p );
+        break;
+
       default:
         // If not a native packet send it to ProcessUnhandledPacket which should have been written by the user
         //
@@ -257,71 +266,157 @@ void CGameClient::ReceiveNewActor( Packet* packet )
     //CONSOLE.addx( "C f %s", inString );
     //CONSOLE.addx( "Client: PlayerID:%u:%u on %p.", newPlayerID.binaryAddress, newPlayerID.port );
 
-    CNewtonNode* object = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( newNetworkID );
-    CNewtonNode* parentObject = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( parentNetworkID );
-    CActor* actor = 0;
+    CONSOLE.addx( "Recieved actor: %s ", inString );
+    CActor* actor = SpawnActor( inString, newPos, newNetworkID, newPlayerID, inBitStream );
+    if ( actor )
+    {
+      AttachActor( actor, parentNetworkID );
+    }
 
-    //for (i = 0; i < FACTORY->Actors.indexArray.size(); i++ )
-    //  CONSOLE.addx( "C factory %s", FACTORY->Actors.indexArray[i].c_str() );
-    //CONSOLE.addx( "C factoryIndex %s", FACTORY->Actors.indexArray[factoryIndex].c_str() );
+    delete[] inString;
 
+    //CONSOLE.addx("Y: %f", p->pos_y );
+
+    //assert(p->length == sizeof(MyStruct));
+    //if (p->length != sizeof(MyStruct)) return;
+}
+
+CActor* CGameClient::SpawnActor( const c8* factoryName, vector3df vPos, NetworkID networkID, PlayerID ownerID, RakNet::BitStream& configStream )
+{
+    CNewtonNode* object = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( networkID );
+    CActor* actor = 0;
 
-    CONSOLE.addx( "Recieved actor: %s ", inString );
     if ( object == 0 ) // needs creating - this is client not localhost
     {
-      //  
-      actor = FACTORY->Actors.Create( inString, "" );
+      actor = FACTORY->Actors.Create( factoryName, "" );
       if ( actor )
       {
-        actor->Unserialize( inBitStream );
-        actor->setPosition( newPos );
+        actor->Unserialize( configStream );
+        actor->setPosition( vPos );
         String text = "(client) ";
-        text += inString;
+        text += factoryName;
         actor->setDebugText( text );
-        actor->SetNetworkID( newNetworkID ); // set network ID
-        actor->setOwnersPlayerID( newPlayerID );
+        actor->SetNetworkID( networkID ); // set network ID
+        actor->setOwnersPlayerID( ownerID );
       }
     }
     else
     {
-      CONSOLE.add( "Actor already created" );
-      if ( actor == 0 )
-      {
-        actor = static_cast<CActor*>( object );
-      }
+      actor = static_cast<CActor*>( object );
+    }
+
+    if ( !actor )
+    {
+      return NULL;
     }
 
     // this is my player's actor
-	if ( WORLD.myPlayer )
-		if ( WORLD.myPlayer->playerID == newPlayerID )
-		{
-		//CONSOLE.add( "MyPlayer!" );     
-		WORLD.GetCamera()->setTarget( actor );
-		// object doesn't work with setTarget, object not good for usage?
-		}
-
-    CPlayer* p = WORLD.GetPlayers()->GetPlayer( newPlayerID );
+    if ( WORLD.myPlayer && ( WORLD.myPlayer->playerID == ownerID ) )
+    {
+      WORLD.GetCamera()->setTarget( actor );
+    }
+
+    CPlayer* p = WORLD.GetPlayers()->GetPlayer( ownerID );
     if ( p )
     {
       actor->setControls( p->getControls() );
     }
 
-    // attachment
-    if ( !actor->isAttached() )
+    return actor;
+}
+
+void CGameClient::AttachActor( CActor* actor, NetworkID parentID )
+{
+    if ( actor->isAttached() )
+    {
+      return;
+    }
+
+    CNewtonNode* parentObject = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( parentID );
+    if ( parentObject )
     {
-      if ( parentObject )
+      actor->attachToParentNode( parentObject, actor->getControls() );
+    }
+}
+
+void CGameClient::ReceiveJoinState( Packet* packet )
+{
+    if ( APP.DebugMode )
+    {
+      CONSOLE.addx( "Client: ID_CRIMSON_JOINSTATE from PlayerID:%u:%u on %p.", packet->playerId.binaryAddress, packet->playerId.port );
+    }
+
+    RakNet::BitStream inBitStream( ( unsigned char* )packet->data, packet->length, false );
+    inBitStream.IgnoreBits( 8 ); // ID_CRIMSON_JOINSTATE
+
+    u16 i, num;
+    char name[32];
+
+    array<String> factoryNames;
+    inBitStream.ReadCompressed( num );
+    for ( i = 0; i < num; i++ )
+    {
+      stringCompressor->DecodeString( name, 32, &inBitStream );
+      factoryNames.push_back( name );
+    }
+
+    // the config blobs, each one read the way CActor::Serialize() wrote it
+    array< array<unsigned char> > configs;
+    inBitStream.ReadCompressed( num );
+    for ( i = 0; i < num; i++ )
+    {
+      u32 bits = 0;
+      inBitStream.ReadCompressed( bits );
+      array<unsigned char> data;
+      data.set_used( ( bits + 7 ) / 8 );
+      if ( bits && !inBitStream.ReadBits( data.pointer(), bits, false ) )
       {
-        actor->attachToParentNode( parentObject, actor->getControls() );
+        return;
       }
+      configs.push_back( data );
     }
 
+    // create everything first, parents can come after their children
+    array<CActor*> actors;
+    array<NetworkID> parents;
+    inBitStream.ReadCompressed( num );
+    for ( i = 0; i < num; i++ )
+    {
+      u16 factoryIndex = 0, configIndex = 0;
+      NetworkID networkID, parentID;
+      PlayerID ownerID;
+      vector3df vPos;
+      inBitStream.ReadCompressed( factoryIndex );
+      inBitStream.ReadCompressed( configIndex );
+      inBitStream.Read( networkID );
+      inBitStream.Read( ownerID );
+      inBitStream.Read( parentID );
+      if ( !inBitStream.ReadVector( vPos.X, vPos.Y, vPos.Z ) || ( factoryIndex >= factoryNames.size() ) || ( configIndex > configs.size() ) )
+      {
+        break;
+      }
 
-    delete[] inString;
+      RakNet::BitStream configStream;
+      if ( configIndex )
+      {
+        array<unsigned char>& data = configs[configIndex - 1];
+        configStream.Write( ( const char* )data.const_pointer(), data.size() );
+      }
 
-    //CONSOLE.addx("Y: %f", p->pos_y );
+      CActor* actor = SpawnActor( factoryNames[factoryIndex].c_str(), vPos, networkID, ownerID, configStream );
+      if ( actor )
+      {
+        actors.push_back( actor );
+        parents.push_back( parentID );
+      }
+    }
 
-    //assert(p->length == sizeof(MyStruct));
-    //if (p->length != sizeof(MyStruct)) return;
+    for ( i = 0; i < actors.size(); i++ )
+    {
+      AttachActor( actors[i], parents[i] );
+    }
+
+    CONSOLE.addx( "Recieved %i actors", actors.size() );
 }
 
 void CGameClient::SendChat( char* text, u16 addresser )
@@ -334,7 +429,9 @@ void CGameClient::SendChat( char* text, u16 addresser )
     bs.Write( ID_CRIMSON_CHAT );
     bs.Write( addresser );
     stringCompressor->EncodeString( text, MAX_CHAT_TEXT, &bs );
+#ifdef _CLIENT
     NET.rakClient->Send( &bs, LOW_PRIORITY, RELIABLE, 0 );
+#endif
 }
 
 void CGameClient::ReceiveVerifyFiles( Packet* packet )
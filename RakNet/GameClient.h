@@ -3,6 +3,8 @@
 
 #include "network.h"
 
+class CActor;
+
 class CGameClient : public IProcessPacket
 {
   public:
@@ -19,9 +21,14 @@ class CGameClient : public IProcessPacket
     virtual void ReceiveRemoteStaticData( Packet* packet );
 
     virtual void ReceiveNewActor( Packet* packet );
+    virtual void ReceiveJoinState( Packet* packet );
     virtual void ReceiveVerifyFiles( Packet* packet );
     virtual void ReceiveChat( Packet* packet );
 
+    // finds the actor if this is also the server
+    CActor* SpawnActor( const c8* factoryName, vector3df vPos, NetworkID networkID, PlayerID ownerID, RakNet::BitStream& configStream );
+    void AttachActor( CActor* actor, NetworkID parentID );
+
     WideString client_name;
 };
 
@@ -8,8 +8,12 @@
 #include "../World/actor.h"
 #include "../World/map.h"
 #include "../World/rules.h"
+#include "../World/configcache.h"
 
 #include "CustomPackets.h"
+#include "snapshot.h"
+#include "prediction.h"
+#include "lagcomp.h"
 
 
 CGameServer::CGameServer()
@@ -145,6 +149,14 @@ void CGameServer::ProcessPacket( unsigned char packetIdentifier )
         ReceiveClientOK( p );
         break;
 
+      case ID_CRIMSON_SNAPSHOTACK:
+        SNAPSHOTS->ReceiveAck( p );
+        break;
+
+      case ID_CRIMSON_INPUT:
+        PREDICTION->ReceiveInput( p );
+        break;
+
       default:
         // If not a native packet send it to ProcessUnhandledPacket which should have been written by the user
         //
@@ -173,15 +185,10 @@ void CGameServer::ReceiveClientOK( Packet* packet )
     }
 
     CPlayer* player = WORLD.GetPlayers()->AddPlayer( packet->playerId );
+    SNAPSHOTS->AddClient( packet->playerId );
 
-    // send all active actors / loop through actors with no parents
-    for ( int i = 0; i < CActor::actorsList.size(); i++ )
-    {
-      if ( !CActor::actorsList[i]->isAttached() )
-      {
-        CActor::actorsList[i]->Broadcast();
-      }
-    }
+    // only the new player needs the actors that are already there
+    SendJoinState( packet->playerId );
 
     // BUG:? duplicating when reconnecting because of queue
     //WORLD.GetMap()->GetRespawn()->AddToQueue( "soldier", "Scripts/soldier_dod.gm", 10, player );
@@ -213,6 +220,9 @@ void CGameServer::ReceiveDisconnectionNotification( Packet* packet )
     }
 
     WORLD.GetPlayers()->RemovePlayer( packet->playerId );
+    SNAPSHOTS->RemoveClient( packet->playerId );
+    PREDICTION->RemoveClient( packet->playerId );
+    LAGCOMP->RemoveClient( packet->playerId );
 
     if ( APP.DebugMode )
     {
@@ -269,6 +279,101 @@ void CGameServer::BroadcastActor( CActor* actor )
     NET.rakServer->Send( &bs, MEDIUM_PRIORITY, RELIABLE_ORDERED, 0, UNASSIGNED_PLAYER_ID, true );
 }
 
+void CGameServer::SendJoinState( PlayerID playerId )
+{
+    u32 i, j;
+    array<CActor*> actors;
+    array<String> factoryNames;
+    array<const SActorConfig*> configs;
+    array<u16> actorFactories, actorConfigs;
+
+    // factory names and configs are shared by most actors, each goes once
+    for ( i = 0; i < CActor::actorsList.size(); i++ )
+    {
+      CActor* actor = CActor::actorsList[i];
+      if ( actor->isZombie() )
+      {
+        continue;
+      }
+
+      for ( j = 0; j < factoryNames.size(); j++ )
+      {
+        if ( factoryNames[j] == actor->getFactoryName() )
+        {
+          break;
+        }
+      }
+      if ( j == factoryNames.size() )
+      {
+        factoryNames.push_back( actor->getFactoryName() );
+      }
+      actorFactories.push_back( ( u16 )j );
+
+      // 0 for no config
+      u16 configIndex = 0;
+      if ( actor->getConfig() )
+      {
+        for ( j = 0; j < configs.size(); j++ )
+        {
+          if ( configs[j]->filename == actor->getConfig()->filename )
+          {
+            break;
+          }
+        }
+        if ( j == configs.size() )
+        {
+          configs.push_back( actor->getConfig() );
+        }
+        configIndex = ( u16 )( j + 1 );
+      }
+      actorConfigs.push_back( configIndex );
+
+      actors.push_back( actor );
+    }
+
+    RakNet::BitStream bs;
+    bs.Write( ( unsigned char )ID_CRIMSON_JOINSTATE );
+
+    bs.WriteCompressed( ( u16 )factoryNames.size() );
+    for ( i = 0; i < factoryNames.size(); i++ )
+    {
+      stringCompressor->EncodeString( ( char* )factoryNames[i].c_str(), 32, &bs );
+    }
+
+    bs.WriteCompressed( ( u16 )configs.size() );
+    for ( i = 0; i < configs.size(); i++ )
+    {
+      bs.WriteCompressed( ( u32 )configs[i]->bits );
+      bs.WriteBits( configs[i]->data.const_pointer(), configs[i]->bits, false );
+    }
+
+    bs.WriteCompressed( ( u16 )actors.size() );
+    for ( i = 0; i < actors.size(); i++ )
+    {
+      CActor* actor = actors[i];
+      bs.WriteCompressed( actorFactories[i] );
+      bs.WriteCompressed( actorConfigs[i] );
+      bs.Write( actor->GetNetworkID() );
+      bs.Write( actor->getOwnersPlayerID() );
+      if ( actor->isAttached() )
+      {
+        bs.Write( actor->getParentAttachment()->GetNetworkID() );
+      }
+      else
+      {
+        bs.Write( UNASSIGNED_NETWORK_ID );
+      }
+      bs.WriteVector( actor->getPosition().X, actor->getPosition().Y, actor->getPosition().Z );
+    }
+
+    NET.rakServer->Send( &bs, MEDIUM_PRIORITY, RELIABLE_ORDERED, 0, playerId, false );
+
+    if ( APP.DebugMode )
+    {
+      CONSOLE.addx( "Server: join state to %u:%u - %i actors, %i configs, %i bytes", playerId.binaryAddress, playerId.port, actors.size(), configs.size(), bs.GetNumberOfBytesUsed() );
+    }
+}
+
 void CGameServer::ReceiveChat( Packet* packet )
 {
     if ( APP.DebugMode )
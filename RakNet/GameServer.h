@@ -15,6 +15,8 @@ class CGameServer : public IProcessPacket
     virtual void ProcessError( const char* text, int error );
 
     static void BroadcastActor( CActor* actor );
+    // every actor in one message to a player that just joined
+    static void SendJoinState( PlayerID playerId );
 
   protected:
     virtual void ReceiveNewIncomingConnection( Packet* packet );
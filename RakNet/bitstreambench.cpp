@@ -0,0 +1,292 @@
+#include "bitstreambench.h"
+#include "BitStream.h"
+
+#include "../App/app.h"
+#include "../App/misc.h"
+#include "../Game/SingletonIncludes.h"
+
+// BitStream::WriteBits and ReadBits as they were, a byte at a time
+static void ByteWriteBits( RakNet::BitStream& bs, const unsigned char* input, int numberOfBitsToWrite )
+{
+    bs.AddBitsAndReallocate( numberOfBitsToWrite );
+    unsigned char* data = bs.GetData();
+    int numberOfBitsUsed = bs.GetNumberOfBitsUsed();
+    int offset = 0;
+    int numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+
+    while ( numberOfBitsToWrite > 0 )
+    {
+      unsigned char dataByte = input[offset];
+      if ( numberOfBitsToWrite < 8 )
+      {
+        dataByte <<= 8 - numberOfBitsToWrite;
+      }
+
+      if ( numberOfBitsUsedMod8 == 0 )
+      {
+        data[numberOfBitsUsed >> 3] = dataByte;
+      }
+      else
+      {
+        data[numberOfBitsUsed >> 3] |= dataByte >> numberOfBitsUsedMod8;
+        if ( 8 - numberOfBitsUsedMod8 < numberOfBitsToWrite )
+        {
+          data[( numberOfBitsUsed >> 3 ) + 1] = ( unsigned char )( dataByte << ( 8 - numberOfBitsUsedMod8 ) );
+        }
+      }
+
+      numberOfBitsUsed += ( numberOfBitsToWrite >= 8 ) ? 8 : numberOfBitsToWrite;
+      numberOfBitsToWrite -= 8;
+      offset++;
+    }
+    bs.SetWriteOffset( numberOfBitsUsed );
+}
+
+static bool ByteReadBits( RakNet::BitStream& bs, unsigned char* output, int numberOfBitsToRead )
+{
+    int readOffset = bs.GetReadOffset();
+    if ( readOffset + numberOfBitsToRead > bs.GetNumberOfBitsUsed() )
+    {
+      return false;
+    }
+
+    const unsigned char* data = bs.GetData();
+    int offset = 0;
+    int readOffsetMod8 = readOffset & 7;
+
+    memset( output, 0, BITS_TO_BYTES( numberOfBitsToRead ) );
+    while ( numberOfBitsToRead > 0 )
+    {
+      output[offset] |= data[readOffset >> 3] << readOffsetMod8;
+      if ( readOffsetMod8 > 0 && numberOfBitsToRead > 8 - readOffsetMod8 )
+      {
+        output[offset] |= data[( readOffset >> 3 ) + 1] >> ( 8 - readOffsetMod8 );
+      }
+
+      numberOfBitsToRead -= 8;
+      if ( numberOfBitsToRead < 0 )
+      {
+        output[offset] >>= -numberOfBitsToRead;
+        readOffset += 8 + numberOfBitsToRead;
+      }
+      else
+      {
+        readOffset += 8;
+      }
+      offset++;
+    }
+    bs.SetReadOffset( readOffset );
+    return true;
+}
+
+// the same numbers every run
+static u32 benchSeed;
+
+static u32 BenchRandom()
+{
+    benchSeed = benchSeed * 1664525 + 1013904223;
+    return benchSeed;
+}
+
+static f32 BenchFloat( f32 min, f32 max )
+{
+    return min + ( max - min ) * ( f32 )( BenchRandom() >> 8 ) / 16777215.0f;
+}
+
+// bBytes writes whole bytes only, otherwise 1 to 64 bits, almost always off the byte boundary
+static void BenchFields( const c8* name, bool bBytes, int fieldsNum, int runs )
+{
+    int i, r;
+
+    benchSeed = 12345;
+    array<int> widths;
+    array<unsigned char> values;
+    widths.set_used( fieldsNum );
+    values.set_used( fieldsNum * 8 );
+    int totalBits = 0;
+    for ( i = 0; i < fieldsNum; i++ )
+    {
+      widths[i] = bBytes ? ( 1 << ( BenchRandom() % 4 ) ) * 8 : 1 + ( int )( BenchRandom() % 64 );
+      totalBits += widths[i];
+    }
+    for ( i = 0; i < fieldsNum * 8; i++ )
+    {
+      values[i] = ( unsigned char )( BenchRandom() >> 24 );
+    }
+
+    RakNet::BitStream reference( BITS_TO_BYTES( totalBits ) + 8 );
+    RakNet::BitStream bs( BITS_TO_BYTES( totalBits ) + 8 );
+    unsigned char output[8];
+
+    u32 start = getMicroTime();
+    for ( r = 0; r < runs; r++ )
+    {
+      reference.ResetWritePointer();
+      for ( i = 0; i < fieldsNum; i++ )
+      {
+        ByteWriteBits( reference, &values[i * 8], widths[i] );
+      }
+    }
+    u32 byteWriteTime = getMicroTime() - start;
+
+    start = getMicroTime();
+    for ( r = 0; r < runs; r++ )
+    {
+      bs.ResetWritePointer();
+      for ( i = 0; i < fieldsNum; i++ )
+      {
+        bs.WriteBits( &values[i * 8], widths[i], true );
+      }
+    }
+    u32 wordWriteTime = getMicroTime() - start;
+
+    bool bSame = ( bs.GetNumberOfBitsUsed() == reference.GetNumberOfBitsUsed() ) && !memcmp( reference.GetData(), bs.GetData(), BITS_TO_BYTES( totalBits ) );
+
+    start = getMicroTime();
+    for ( r = 0; r < runs; r++ )
+    {
+      reference.ResetReadPointer();
+      for ( i = 0; i < fieldsNum; i++ )
+      {
+        ByteReadBits( reference, output, widths[i] );
+      }
+    }
+    u32 byteReadTime = getMicroTime() - start;
+
+    start = getMicroTime();
+    for ( r = 0; r < runs; r++ )
+    {
+      bs.ResetReadPointer();
+      for ( i = 0; i < fieldsNum; i++ )
+      {
+        bs.ReadBits( output, widths[i], true );
+      }
+    }
+    u32 wordReadTime = getMicroTime() - start;
+
+    // every field reads back as it was written, the partial byte right aligned
+    int mismatches = 0;
+    bs.ResetReadPointer();
+    for ( i = 0; i < fieldsNum; i++ )
+    {
+      bs.ReadBits( output, widths[i], true );
+      int wholeBytes = widths[i] >> 3;
+      int rest = widths[i] & 7;
+      if ( memcmp( output, &values[i * 8], wholeBytes ) || ( rest && ( output[wholeBytes] != ( values[i * 8 + wholeBytes] & ( ( 1 << rest ) - 1 ) ) ) ) )
+      {
+        mismatches++;
+      }
+    }
+
+    f32 megabits = ( f32 )totalBits * runs / 1000000.0f;
+    APPLOG.Write( "BitStream %s: %i fields, %i bits, %i runs, %s streams, %i bad fields", name, fieldsNum, totalBits, runs, bSame ? "same" : "DIFFERENT", mismatches );
+    APPLOG.Write( "BitStream %s: write %.1f Mbit/s byte loop, %.1f Mbit/s words", name, megabits / max( byteWriteTime, 1u ) * 1000000.0f, megabits / max( wordWriteTime, 1u ) * 1000000.0f );
+    APPLOG.Write( "BitStream %s: read %.1f Mbit/s byte loop, %.1f Mbit/s words", name, megabits / max( byteReadTime, 1u ) * 1000000.0f, megabits / max( wordReadTime, 1u ) * 1000000.0f );
+    CONSOLE.addx( "BitStream %s: write %.2fx, read %.2fx, %s", name, ( f32 )byteWriteTime / max( wordWriteTime, 1u ), ( f32 )byteReadTime / max( wordReadTime, 1u ), ( bSame && !mismatches ) ? "same output" : "MISMATCH" );
+}
+
+static f32 QuatError( const f32* a, const f32* b )
+{
+    // q and -q are the same rotation
+    f32 sign = ( a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] ) < 0.0f ? -1.0f : 1.0f;
+    f32 error = 0.0f;
+    for ( int i = 0; i < 4; i++ )
+    {
+      error = max( error, fabsf( a[i] - b[i] * sign ) );
+    }
+    return error;
+}
+
+#define BENCH_POSES 1000
+#define BENCH_POS_BITS 20
+#define BENCH_QUAT_BITS 10
+#define BENCH_ANGLE_BITS 12
+
+static void BenchPoses()
+{
+    int i;
+
+    // a big map, the quantized steps are 1/128 of a unit across it
+    f32 boundsMin[3] = { -4096.0f, -4096.0f, -256.0f };
+    f32 boundsMax[3] = { 4096.0f, 4096.0f, 256.0f };
+
+    benchSeed = 54321;
+    f32 pos[BENCH_POSES][3], quat[BENCH_POSES][4], angle[BENCH_POSES];
+    for ( i = 0; i < BENCH_POSES; i++ )
+    {
+      f32 length = 0.0f;
+      for ( int j = 0; j < 4; j++ )
+      {
+        quat[i][j] = BenchFloat( -1.0f, 1.0f );
+        length += quat[i][j] * quat[i][j];
+      }
+      length = sqrtf( max( length, 0.0001f ) );
+      for ( int j = 0; j < 4; j++ )
+      {
+        quat[i][j] /= length;
+      }
+      for ( int j = 0; j < 3; j++ )
+      {
+        pos[i][j] = BenchFloat( boundsMin[j], boundsMax[j] );
+      }
+      angle[i] = BenchFloat( 0.0f, 360.0f );
+    }
+
+    RakNet::BitStream floats, raknet, quantized;
+    for ( i = 0; i < BENCH_POSES; i++ )
+    {
+      floats.Write( pos[i][0] ); floats.Write( pos[i][1] ); floats.Write( pos[i][2] );
+      floats.Write( quat[i][0] ); floats.Write( quat[i][1] ); floats.Write( quat[i][2] ); floats.Write( quat[i][3] );
+      floats.Write( angle[i] );
+
+      raknet.WriteVector( pos[i][0], pos[i][1], pos[i][2] );
+      raknet.WriteNormQuat( quat[i][0], quat[i][1], quat[i][2], quat[i][3] );
+      raknet.Write( angle[i] );
+
+      quantized.WriteQuantizedVector( pos[i][0], pos[i][1], pos[i][2], boundsMin, boundsMax, BENCH_POS_BITS );
+      quantized.WriteSmallestThreeQuat( quat[i][0], quat[i][1], quat[i][2], quat[i][3], BENCH_QUAT_BITS );
+      quantized.WriteAngle( angle[i], BENCH_ANGLE_BITS );
+    }
+
+    f32 raknetPosError = 0.0f, raknetQuatError = 0.0f;
+    f32 quantPosError = 0.0f, quantQuatError = 0.0f, quantAngleError = 0.0f;
+    f32 readPos[3], readQuat[4], readAngle;
+    for ( i = 0; i < BENCH_POSES; i++ )
+    {
+      raknet.ReadVector( readPos[0], readPos[1], readPos[2] );
+      raknet.ReadNormQuat( readQuat[0], readQuat[1], readQuat[2], readQuat[3] );
+      raknet.Read( readAngle );
+      for ( int j = 0; j < 3; j++ )
+      {
+        raknetPosError = max( raknetPosError, fabsf( readPos[j] - pos[i][j] ) );
+      }
+      raknetQuatError = max( raknetQuatError, QuatError( quat[i], readQuat ) );
+
+      quantized.ReadQuantizedVector( readPos[0], readPos[1], readPos[2], boundsMin, boundsMax, BENCH_POS_BITS );
+      quantized.ReadSmallestThreeQuat( readQuat[0], readQuat[1], readQuat[2], readQuat[3], BENCH_QUAT_BITS );
+      quantized.ReadAngle( readAngle, BENCH_ANGLE_BITS );
+      for ( int j = 0; j < 3; j++ )
+      {
+        quantPosError = max( quantPosError, fabsf( readPos[j] - pos[i][j] ) );
+      }
+      quantQuatError = max( quantQuatError, QuatError( quat[i], readQuat ) );
+      f32 angleError = fabsf( readAngle - angle[i] );
+      quantAngleError = max( quantAngleError, min( angleError, 360.0f - angleError ) );
+    }
+
+    APPLOG.Write( "BitStream poses: position, quaternion and an angle, %i of them", BENCH_POSES );
+    APPLOG.Write( "BitStream poses: floats %.1f bytes each", ( f32 )floats.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES );
+    APPLOG.Write( "BitStream poses: WriteVector/WriteNormQuat %.1f bytes each, position error %.4f, quaternion error %.5f", ( f32 )raknet.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES, raknetPosError, raknetQuatError );
+    APPLOG.Write( "BitStream poses: quantized %.1f bytes each, position error %.4f, quaternion error %.5f, angle error %.3f", ( f32 )quantized.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES, quantPosError, quantQuatError, quantAngleError );
+    CONSOLE.addx( "BitStream poses: %.1f bytes floats, %.1f RakNet, %.1f quantized", ( f32 )floats.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES, ( f32 )raknet.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES, ( f32 )quantized.GetNumberOfBitsUsed() / 8.0f / BENCH_POSES );
+}
+
+void BitStreamBenchmark( int fieldsNum, int runs )
+{
+    fieldsNum = max( fieldsNum, 1 );
+    runs = max( runs, 1 );
+
+    BenchFields( "bit fields", false, fieldsNum, runs );
+    BenchFields( "byte fields", true, fieldsNum, runs );
+    BenchPoses();
+}
@@ -0,0 +1,9 @@
+#ifndef BITSTREAMBENCH_H_INCLUDED
+#define BITSTREAMBENCH_H_INCLUDED
+
+// writes and reads fieldsNum fields of 1 to 64 bits runs times with BitStream and with the
+// byte at a time loops it used to have, checks they agree and logs the times, then logs
+// what actor poses cost with the float, RakNet and quantized writers
+void BitStreamBenchmark( int fieldsNum, int runs );
+
+#endif
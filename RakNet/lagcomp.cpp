@@ -0,0 +1,405 @@
+#include "lagcomp.h"
+#include "lagsim.h"
+
+#include "../App/app.h"
+#include "../App/misc.h"
+#include "../Game/SingletonIncludes.h"
+#include "../IrrConsole/console_vars.h"
+
+#include "../World/actor.h"
+#include "../Newton/newton_node.h"
+
+////////////////////////////////////////////
+// CLagCompensation
+////////////////////////////////////////////
+
+CLagCompensation::CLagCompensation()
+{
+    recordTick = 0;
+    rewinds = rewoundBodies = 0;
+    bTestClock = false;
+    testTime = 0;
+
+    CONSOLE_VAR( "sv_lagcomp", int, compensationEnabled, 1, L"sv_lagcomp [0/1]. Ex. sv_lagcomp 0", L"Checks the players' shots against where they saw the other actors." );
+    CONSOLE_VAR( "sv_maxunlag", int, maxUnlag, 200, L"sv_maxunlag [ms]. Ex. sv_maxunlag 200", L"The furthest back a shot is checked, players with more latency have to lead." );
+}
+
+void CLagCompensation::Clear()
+{
+    Restore();
+    histories.clear();
+    clients.clear();
+    recordTick = 0;
+    rewinds = rewoundBodies = 0;
+}
+
+void CLagCompensation::Record()
+{
+    if ( !NET.rakServer->IsActive() )
+    {
+      return;
+    }
+
+    recordTick++;
+    bool bAdded = false;
+
+    SHitRecord record;
+    record.time = Now();
+
+    SHitHistory key;
+    for ( u32 i = 0; i < CActor::actorsList.size(); i++ )
+    {
+      CActor* actor = CActor::actorsList[i];
+      if ( actor->isZombie() || !actor->body || ( actor->GetNetworkID() == UNASSIGNED_NETWORK_ID ) )
+      {
+        continue;
+      }
+
+      key.id = actor->GetNetworkID();
+      s32 found = bAdded ? histories.linear_search( key ) : histories.binary_search( key );
+      if ( found < 0 )
+      {
+        histories.push_back( key );
+        found = histories.size() - 1;
+        histories[found].records.flood( record );
+        bAdded = true;
+      }
+
+      SHitHistory& history = histories[found];
+      history.lastSeen = recordTick;
+
+      NewtonBodyGetMatrix( actor->body, &record.matrix.M[0] );
+      if ( !( history.records << record ) )
+      {
+        // full, the oldest goes
+        SHitRecord oldest;
+        history.records >> oldest;
+        history.records << record;
+      }
+    }
+
+    // actors that are gone
+    for ( s32 i = histories.size() - 1; i >= 0; i-- )
+    {
+      if ( histories[i].lastSeen != recordTick )
+      {
+        histories.erase( i );
+      }
+    }
+
+    if ( bAdded )
+    {
+      histories.sort();
+    }
+}
+
+bool CLagCompensation::Sample( SHitHistory& history, RakNetTime time, matrix4& matrix )
+{
+    SHitRecord* newer = NULL;
+    for ( unsigned long age = 0; ; age++ )
+    {
+      SHitRecord* record = history.records.peek( age );
+      if ( !record )
+      {
+        // older than we remember, the oldest will do
+        if ( !newer )
+        {
+          return false;
+        }
+        matrix = newer->matrix;
+        return true;
+      }
+
+      if ( ( s32 )( time - record->time ) >= 0 )
+      {
+        matrix = record->matrix;
+        if ( newer && ( newer->time != record->time ) )
+        {
+          // the rotation is the nearer record's, the position is blended
+          f32 t = ( f32 )( time - record->time ) / ( f32 )( newer->time - record->time );
+          if ( t > 0.5f )
+          {
+            matrix = newer->matrix;
+          }
+          matrix.setTranslation( record->matrix.getTranslation() + ( newer->matrix.getTranslation() - record->matrix.getTranslation() ) * t );
+        }
+        return true;
+      }
+      newer = record;
+    }
+}
+
+void CLagCompensation::ReceiveTimestamp( PlayerID playerId, RakNetTime stamp )
+{
+    // the stamp was moved to our clock by RakNet on arrival
+    s32 delay = ( s32 )( Now() - stamp );
+    if ( delay < 0 )
+    {
+      delay = 0;
+    }
+
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      if ( clients[i].playerId == playerId )
+      {
+        // smoothed, one late message should not throw the shots off
+        clients[i].inputDelay += ( ( f32 )delay - clients[i].inputDelay ) * 0.25f;
+        return;
+      }
+    }
+
+    SLagClient client;
+    client.playerId = playerId;
+    client.inputDelay = ( f32 )delay;
+    clients.push_back( client );
+}
+
+void CLagCompensation::RemoveClient( PlayerID playerId )
+{
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      if ( clients[i].playerId == playerId )
+      {
+        clients.erase( i );
+        return;
+      }
+    }
+}
+
+u32 CLagCompensation::getViewDelay( PlayerID playerId )
+{
+    if ( !compensationEnabled || ( playerId == UNASSIGNED_PLAYER_ID ) )
+    {
+      return 0;
+    }
+
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      if ( clients[i].playerId == playerId )
+      {
+        // the input came in this late and the snapshots go out half a ping late
+        s32 ping = max( NET.rakServer->GetAveragePing( playerId ), 0 );
+        s32 delay = ( s32 )clients[i].inputDelay + ping / 2 + LAGSIM->fakeLag;
+        return ( u32 )min( max( delay, 0 ), maxUnlag );
+      }
+    }
+    return 0;
+}
+
+void CLagCompensation::Rewind( PlayerID playerId, const aabbox3df& area )
+{
+    Restore();
+
+    u32 delay = getViewDelay( playerId );
+    if ( !delay )
+    {
+      return;
+    }
+    rewinds++;
+
+    RakNetTime time = Now() - delay;
+    vector3df vMargin( LAGCOMP_MARGIN, LAGCOMP_MARGIN, LAGCOMP_MARGIN );
+    aabbox3df nearArea( area.MinEdge - vMargin, area.MaxEdge + vMargin );
+
+    // the shooter and what it rides fire from where they are now
+    CNewtonNode* shooter = CActor::getActorWithPlayerID( playerId );
+    if ( shooter && shooter->GetGreatestParent() )
+    {
+      shooter = shooter->GetGreatestParent();
+    }
+
+    SRewound body;
+    matrix4 past;
+    for ( u32 i = 0; i < histories.size(); i++ )
+    {
+      SHitHistory& history = histories[i];
+
+      // the actor may have died since it was recorded
+      CNewtonNode* object = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( history.id );
+      if ( !object || object->isZombie() || !object->body || !Sample( history, time, past ) )
+      {
+        continue;
+      }
+      CNewtonNode* root = object->GetGreatestParent();
+      if ( ( root ? root : object ) == shooter )
+      {
+        continue;
+      }
+
+      body.body = object->body;
+      NewtonBodyGetMatrix( body.body, &body.matrix.M[0] );
+      if ( !nearArea.isPointInside( body.matrix.getTranslation() ) && !nearArea.isPointInside( past.getTranslation() ) )
+      {
+        continue;
+      }
+
+      NewtonBodySetMatrix( body.body, &past.M[0] );
+      rewound.push_back( body );
+    }
+    rewoundBodies += rewound.size();
+}
+
+void CLagCompensation::Restore()
+{
+    for ( u32 i = 0; i < rewound.size(); i++ )
+    {
+      NewtonBodySetMatrix( rewound[i].body, &rewound[i].matrix.M[0] );
+    }
+    rewound.set_used( 0 );
+}
+
+void CLagCompensation::PrintStats()
+{
+    CONSOLE.addx( "Lag compensation: %u actors recorded, %u rewinds, %u bodies rewound, %i ms at most", histories.size(), rewinds, rewoundBodies, maxUnlag );
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      CONSOLE.addx( "View delay %u:%u: %u ms, input %.1f ms", clients[i].playerId.binaryAddress, clients[i].playerId.port, getViewDelay( clients[i].playerId ), clients[i].inputDelay );
+    }
+}
+
+////////////////////////////////////////////
+// test
+
+RakNetTime CLagCompensation::Now()
+{
+    return bTestClock ? testTime : RakNet::GetTime();
+}
+
+struct STestRay
+{
+    f32 param;
+    NewtonBody* body;
+};
+
+// closest body along the ray, as CProjectileSystem::RayCastFilter keeps it
+static dFloat TestRayCastFilter( const NewtonBody* body, const dFloat* normal, int collisionID, void* userData, dFloat intersetParam )
+{
+    STestRay* ray = ( STestRay* )userData;
+    if ( intersetParam < ray->param )
+    {
+      ray->param = intersetParam;
+      ray->body = ( NewtonBody * )body;
+    }
+    return intersetParam;
+}
+
+static bool TestShot( NewtonBody* target, const vector3df& vFrom, const vector3df& vTo )
+{
+    STestRay ray;
+    ray.param = 2.0f;
+    ray.body = NULL;
+    NewtonWorldRayCast( WORLD.GetPhysics()->nWorld, &vFrom.X, &vTo.X, TestRayCastFilter, &ray );
+    return ray.body == target;
+}
+
+// the target swings up and down in front of the shooter
+static matrix4 TestTarget( RakNetTime time )
+{
+    matrix4 matrix;
+    f32 t = ( f32 )time / 1000.0f;
+    matrix.setTranslation( vector3df( 50.0f, 20.0f * sinf( t * 3.0f ), 0.0f ) );
+    return matrix;
+}
+
+bool CLagCompensation::Test( int latencyMs, int shotsNum )
+{
+    if ( !NET.rakServer->IsActive() || !WORLD.GetPhysics() )
+    {
+      CONSOLE.add( "Lag compensation test needs a running server" );
+      return false;
+    }
+
+    // past sv_maxunlag the shooter has to lead, there is nothing to compare
+    latencyMs = min( max( latencyMs, 1 ), maxUnlag );
+
+    // the server's own histories and clients come back after the test
+    Restore();
+    array<SHitHistory> savedHistories = histories;
+    u32 savedRecordTick = recordTick, savedRewinds = rewinds, savedRewoundBodies = rewoundBodies;
+    int savedEnabled = compensationEnabled, savedFakeLag = LAGSIM->fakeLag;
+    compensationEnabled = 1;
+    LAGSIM->fakeLag = 0;
+
+    // a static actor in the real world, recorded and rewound like any other
+    NewtonWorld* nWorld = WORLD.GetPhysics()->nWorld;
+    CActor* target = new CActor();
+    NewtonCollision* collision = NewtonCreateSphere( nWorld, 1.0f, 1.0f, 1.0f, NULL );
+    target->body = NewtonCreateBody( nWorld, collision );
+    NewtonReleaseCollision( nWorld, collision );
+    NewtonBodySetUserData( target->body, target );
+
+    // a client nobody owns, its input arrives latencyMs late
+    PlayerID shooter;
+    shooter.binaryAddress = 0xFFFFFFFE;
+    shooter.port = 0;
+
+    RakNetTime tickMs = ( RakNetTime )max( 1000 / max( GAME.goalTicks, 1 ), 1 );
+    bTestClock = true;
+    testTime = RakNet::GetTime();
+    matrix4 matrix;
+
+    int rewoundHits = 0, viewHits = 0, currentHits = 0;
+    u32 mismatches = 0;
+    vector3df vShooter( 0.0f, 0.0f, 0.0f );
+
+    u32 start = getMicroTime();
+    for ( int shot = 0; shot < shotsNum; shot++ )
+    {
+      // a few ticks between shots, before the first the history fills past the delay
+      int ticks = shot ? 7 : latencyMs / tickMs + 8;
+      for ( int tick = 0; tick < ticks; tick++ )
+      {
+        testTime += tickMs;
+        matrix = TestTarget( testTime );
+        NewtonBodySetMatrix( target->body, &matrix.M[0] );
+        Record();
+      }
+      ReceiveTimestamp( shooter, testTime - latencyMs );
+
+      // the client aims at what it sees, spread over and past the target's edges
+      RakNetTime viewTime = testTime - getViewDelay( shooter );
+      vector3df vSeen = TestTarget( viewTime ).getTranslation();
+      vSeen.Y += ( f32 )( ( shot % 5 ) - 2 ) * 0.8f;
+      vector3df vTo = vShooter + ( vSeen - vShooter ) * 2.0f;
+      aabbox3df area( vShooter );
+      area.addInternalPoint( vTo );
+
+      // the real shot path
+      Rewind( shooter, area );
+      bool bRewound = TestShot( target->body, vShooter, vTo );
+      Restore();
+
+      // what the shooter saw
+      matrix = TestTarget( viewTime );
+      NewtonBodySetMatrix( target->body, &matrix.M[0] );
+      bool bSeen = TestShot( target->body, vShooter, vTo );
+      matrix = TestTarget( testTime );
+      NewtonBodySetMatrix( target->body, &matrix.M[0] );
+
+      if ( bRewound != bSeen )
+      {
+        mismatches++;
+      }
+      rewoundHits += bRewound;
+      viewHits += bSeen;
+      currentHits += TestShot( target->body, vShooter, vTo );
+    }
+    u32 time = getMicroTime() - start;
+
+    bTestClock = false;
+    RemoveClient( shooter );
+    WORLD.RemoveEntity( target );
+    histories = savedHistories;
+    recordTick = savedRecordTick;
+    rewinds = savedRewinds;
+    rewoundBodies = savedRewoundBodies;
+    compensationEnabled = savedEnabled;
+    LAGSIM->fakeLag = savedFakeLag;
+
+    APPLOG.Write( "Lag compensation test: %i ms latency, %i shots, rewound at most %i ms", latencyMs, shotsNum, maxUnlag );
+    APPLOG.Write( "Lag compensation test: %i hit rewound, %i hit as seen, %i hit without, %u mismatches", rewoundHits, viewHits, currentHits, mismatches );
+    APPLOG.Write( "Lag compensation test: %.2f us per shot", shotsNum ? ( f32 )time / shotsNum : 0.0f );
+    CONSOLE.addx( "Lag compensation: %i/%i hit rewound, %i/%i without, %u mismatches, %s", rewoundHits, shotsNum, currentHits, shotsNum, mismatches, mismatches ? "FAILED" : "passed" );
+
+    return mismatches == 0;
+}
@@ -0,0 +1,106 @@
+#ifndef LAGCOMP_H_INCLUDED
+#define LAGCOMP_H_INCLUDED
+
+#include "network.h"
+#include "GetTime.h"
+#include "../Engine/ringbuf.h"
+#include "../Newton/newton_physics.h"
+
+#define LAGCOMP CLagCompensation::Instance()
+
+// hit volume transforms kept per actor, one a tick
+#define LAGCOMP_HISTORY 64
+// actors this far outside the shots still get rewound, they are bigger than a point
+#define LAGCOMP_MARGIN 20.0f
+
+// where an actor's body was at a server time
+struct SHitRecord
+{
+    RakNetTime time;
+    matrix4 matrix;
+};
+
+struct SHitHistory
+{
+    NetworkID id;
+    u32 lastSeen;
+    ringbuffer<SHitRecord, LAGCOMP_HISTORY> records;
+
+    bool operator <( const SHitHistory& other ) const
+    {
+        return id < other.id;
+    }
+};
+
+////////////////////////////////////////////
+// CLagCompensation
+// - the server records every actor's body transform each tick
+// - a client sees the world as it was its input latency plus half its ping
+//   ago, measured from the ID_TIMESTAMP on its input
+// - shots of that client are ray cast with the bodies around them moved back
+//   to that time, at most sv_maxunlag ms, and put back right after
+////////////////////////////////////////////
+
+class CLagCompensation
+{
+  public:
+    static CLagCompensation* Instance()
+    {
+        static CLagCompensation inst;
+        return &inst;
+    }
+
+    // server, once per tick after everything moved
+    void Record();
+    void Clear();
+
+    void ReceiveTimestamp( PlayerID playerId, RakNetTime stamp );
+    void RemoveClient( PlayerID playerId );
+    // how many ms behind the server playerId sees the world, 0 for no rewind
+    u32 getViewDelay( PlayerID playerId );
+
+    // moves the bodies near area to where playerId saw them, its own actor stays
+    void Rewind( PlayerID playerId, const aabbox3df& area );
+    void Restore();
+
+    void PrintStats();
+    // fires shotsNum shots of a client latencyMs late at a moving actor through
+    // Rewind and the world ray cast, false if any hit differs from what it saw
+    bool Test( int latencyMs, int shotsNum );
+
+    // the transform at time, between the two records around it
+    static bool Sample( SHitHistory& history, RakNetTime time, matrix4& matrix );
+
+    int compensationEnabled;
+    int maxUnlag;
+
+  private:
+    CLagCompensation();
+
+    struct SLagClient
+    {
+        PlayerID playerId;
+        f32 inputDelay;
+    };
+
+    struct SRewound
+    {
+        NewtonBody* body;
+        matrix4 matrix;
+    };
+
+    // sorted by id
+    array<SHitHistory> histories;
+    array<SLagClient> clients;
+    array<SRewound> rewound;
+    u32 recordTick;
+
+    u32 rewinds, rewoundBodies;
+
+    // the server clock, Test runs its own
+    RakNetTime Now();
+    bool bTestClock;
+    RakNetTime testTime;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "lagsim.h"
+
+#include "../App/misc.h"
+#include "../Game/SingletonIncludes.h"
+#include "../IrrConsole/console_vars.h"
+
+////////////////////////////////////////////
+// CLagSimulator
+////////////////////////////////////////////
+
+CLagSimulator::CLagSimulator()
+{
+    sent = dropped = 0;
+
+    CONSOLE_VAR( "net_fakelag", int, fakeLag, 0, L"net_fakelag [ms]. Ex. net_fakelag 100", L"Delays the game messages this side sends, for testing." );
+    CONSOLE_VAR( "net_fakeloss", int, fakeLoss, 0, L"net_fakeloss [percent]. Ex. net_fakeloss 5", L"Drops this many of the unreliable game messages this side sends, for testing." );
+}
+
+void CLagSimulator::SendNow( const c8* data, int length, PacketPriority priority, PacketReliability reliability, char channel, PlayerID playerId )
+{
+    sent++;
+    if ( playerId == UNASSIGNED_PLAYER_ID )
+    {
+#ifdef _CLIENT
+      NET.rakClient->Send( data, length, priority, reliability, channel );
+#endif
+    }
+    else
+    {
+      NET.rakServer->Send( data, length, priority, reliability, channel, playerId, false );
+    }
+}
+
+void CLagSimulator::Send( RakNet::BitStream& bs, PacketPriority priority, PacketReliability reliability, char channel, PlayerID playerId )
+{
+    bool bUnreliable = ( reliability == UNRELIABLE ) || ( reliability == UNRELIABLE_SEQUENCED );
+    if ( bUnreliable && ( fakeLoss > 0 ) && ( random( 100 ) < fakeLoss ) )
+    {
+      dropped++;
+      return;
+    }
+
+    if ( fakeLag <= 0 )
+    {
+      SendNow( ( const c8* )bs.GetData(), bs.GetNumberOfBytesUsed(), priority, reliability, channel, playerId );
+      return;
+    }
+
+    SDelayed message;
+    message.sendTime = getMicroTime() + fakeLag * 1000;
+    message.data.set_used( bs.GetNumberOfBytesUsed() );
+    memcpy( message.data.pointer(), bs.GetData(), bs.GetNumberOfBytesUsed() );
+    message.priority = priority;
+    message.reliability = reliability;
+    message.channel = channel;
+    message.playerId = playerId;
+    delayed.push_back( message );
+}
+
+void CLagSimulator::Update()
+{
+    // in the order they were sent, the lag is the same for all
+    u32 now = getMicroTime();
+    u32 due = 0;
+    while ( ( due < delayed.size() ) && ( ( s32 )( now - delayed[due].sendTime ) >= 0 ) )
+    {
+      SDelayed& message = delayed[due];
+      SendNow( ( const c8* )message.data.const_pointer(), message.data.size(), message.priority, message.reliability, message.channel, message.playerId );
+      due++;
+    }
+    if ( due )
+    {
+      delayed.erase( 0, due );
+    }
+}
+
+void CLagSimulator::Clear()
+{
+    delayed.clear();
+}
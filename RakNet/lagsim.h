@@ -0,0 +1,52 @@
+#ifndef LAGSIM_H_INCLUDED
+#define LAGSIM_H_INCLUDED
+
+#include "network.h"
+#include "BitStream.h"
+
+#define LAGSIM CLagSimulator::Instance()
+
+////////////////////////////////////////////
+// CLagSimulator
+// - holds back the unreliable game messages for net_fakelag ms and drops
+//   net_fakeloss percent of them, to try prediction on a local server
+// - reliable messages are only delayed, dropping them is RakNet's business
+////////////////////////////////////////////
+
+class CLagSimulator
+{
+  public:
+    static CLagSimulator* Instance()
+    {
+        static CLagSimulator inst;
+        return &inst;
+    }
+
+    // UNASSIGNED_PLAYER_ID sends to the server
+    void Send( RakNet::BitStream& bs, PacketPriority priority, PacketReliability reliability, char channel, PlayerID playerId );
+    // sends what is due
+    void Update();
+    void Clear();
+
+    int fakeLag, fakeLoss;
+    u32 sent, dropped;
+
+  private:
+    CLagSimulator();
+
+    struct SDelayed
+    {
+        u32 sendTime;
+        array<unsigned char> data;
+        PacketPriority priority;
+        PacketReliability reliability;
+        char channel;
+        PlayerID playerId;
+    };
+
+    void SendNow( const c8* data, int length, PacketPriority priority, PacketReliability reliability, char channel, PlayerID playerId );
+
+    array<SDelayed> delayed;
+};
+
+#endif
@@ -0,0 +1,398 @@
+#include "prediction.h"
+#include "snapshot.h"
+#include "lagsim.h"
+#include "lagcomp.h"
+
+#include "../App/app.h"
+#include "../Game/SingletonIncludes.h"
+#include "../IrrConsole/console_vars.h"
+
+#include "../World/actor.h"
+#include "../World/player.h"
+#include "../World/controls.h"
+#include "../Newton/newton_node.h"
+
+#include "CustomPackets.h"
+
+static f32 WrapAngle( f32 degrees )
+{
+    while ( degrees > 180.0f )
+    {
+      degrees -= 360.0f;
+    }
+    while ( degrees < -180.0f )
+    {
+      degrees += 360.0f;
+    }
+    return degrees;
+}
+
+static vector3df AngleDifference( const vector3df& a, const vector3df& b )
+{
+    return vector3df( WrapAngle( a.X - b.X ), WrapAngle( a.Y - b.Y ), WrapAngle( a.Z - b.Z ) );
+}
+
+////////////////////////////////////////////
+// CPrediction
+////////////////////////////////////////////
+
+CPrediction::CPrediction()
+{
+    Clear();
+
+    CONSOLE_VAR( "cl_predict", int, predictEnabled, 1, L"cl_predict [0/1]. Ex. cl_predict 0", L"Runs the player's actor on local input and corrects it when the server disagrees." );
+    CONSOLE_VAR( "cl_predict_tolerance", f32, predictTolerance, 0.05f, L"cl_predict_tolerance [units]. Ex. cl_predict_tolerance 0.05", L"How far the server may be from the prediction before it is corrected." );
+    CONSOLE_VAR( "cl_predict_smoothing", f32, predictSmoothing, 0.2f, L"cl_predict_smoothing [0.0-1.0]. Ex. cl_predict_smoothing 0.2", L"Part of a correction the drawn actor catches up with each tick, 1 snaps." );
+    CONSOLE_VAR( "cl_predict_snap", f32, predictSnapDistance, 10.0f, L"cl_predict_snap [units]. Ex. cl_predict_snap 10", L"Corrections longer than this are not smoothed." );
+}
+
+void CPrediction::Clear()
+{
+    sequence = 0;
+    for ( int i = 0; i < PREDICTION_HISTORY; i++ )
+    {
+      commands[i].sequence = 0;
+      moves[i].sequence = 0;
+    }
+    predictedId = UNASSIGNED_NETWORK_ID;
+    inputClients.clear();
+
+    corrections = replayedMoves = shiftedMoves = hardSnaps = 0;
+    lastError = 0.0f;
+}
+
+void CPrediction::Update()
+{
+    if ( NET.rakServer->IsActive() )
+    {
+      ApplyInputs();
+      return;
+    }
+
+#ifdef _CLIENT
+    if ( !NET.rakClient->IsConnected() || !WORLD.myPlayer )
+    {
+      return;
+    }
+
+    SampleInput();
+    SendInput();
+#endif
+}
+
+////////////////////////////////////////////
+// client
+
+void CPrediction::SampleInput()
+{
+    sequence++;
+
+    SInputCommand& command = commands[sequence % PREDICTION_HISTORY];
+    command.sequence = sequence;
+    command.actionKeys = myControls.GetActionKeys();
+    command.mousePressed1 = myControls.mousePressed1;
+    command.mousePressed2 = myControls.mousePressed2;
+    command.vMousePosWorld = myControls.mousePosWorld;
+
+    // the actor, or what it rides
+    predictedId = UNASSIGNED_NETWORK_ID;
+    CActor* actor = CActor::getActorWithPlayerID( WORLD.myPlayer->playerID );
+    if ( !actor || actor->isZombie() )
+    {
+      return;
+    }
+    CNewtonNode* node = actor->GetGreatestParent();
+    if ( !node )
+    {
+      node = actor;
+    }
+    if ( !node->body )
+    {
+      return;
+    }
+    predictedId = node->GetNetworkID();
+
+    SPredictedMove& move = moves[sequence % PREDICTION_HISTORY];
+    move.sequence = sequence;
+    move.id = predictedId;
+    move.vPos = node->getPosition();
+    move.vRot = node->getRotation();
+    move.vVel = node->getVelocity();
+
+    // the drawn actor catches up with the last correction
+    node->vDrawOffset *= 1.0f - max( 0.0f, min( predictSmoothing, 1.0f ) );
+    if ( node->vDrawOffset.getLengthSQ() < 0.0001f )
+    {
+      node->vDrawOffset = vector3df( 0.0f, 0.0f, 0.0f );
+    }
+}
+
+void CPrediction::SendInput()
+{
+#ifdef _CLIENT
+    u8 count = ( u8 )min( sequence, ( u32 )PREDICTION_REDUNDANCY );
+
+    // the server times our shots with it
+    RakNet::BitStream bs;
+    bs.Write( ( unsigned char )ID_TIMESTAMP );
+    bs.Write( RakNet::GetTime() );
+    bs.Write( ( unsigned char )ID_CRIMSON_INPUT );
+    bs.Write( sequence );
+    bs.Write( count );
+    for ( u32 i = 0; i < count; i++ )
+    {
+      const SInputCommand& command = commands[( sequence - i ) % PREDICTION_HISTORY];
+      bs.Write( command.actionKeys );
+      bs.Write( command.mousePressed1 );
+      bs.Write( command.mousePressed2 );
+      bs.Write( command.vMousePosWorld.X );
+      bs.Write( command.vMousePosWorld.Y );
+    }
+
+    LAGSIM->Send( bs, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, PREDICTION_CHANNEL, UNASSIGNED_PLAYER_ID );
+#endif
+}
+
+const SPredictedMove* CPrediction::FindMove( u32 moveSequence )
+{
+    const SPredictedMove& move = moves[moveSequence % PREDICTION_HISTORY];
+    if ( ( move.sequence != moveSequence ) || ( move.id != predictedId ) )
+    {
+      return NULL;
+    }
+    return &move;
+}
+
+void CPrediction::Reconcile( CNewtonNode* node, const SEntityState& state, u32 inputAck )
+{
+    vector3df vServerPos = vector3df( ( f32 )state.pos[0], ( f32 )state.pos[1], ( f32 )state.pos[2] ) / SNAPSHOT_POS_SCALE;
+    vector3df vServerRot = vector3df( state.rot[0], state.rot[1], state.rot[2] ) * ( 360.0f / 65536.0f );
+    vector3df vServerVel = vector3df( ( f32 )state.vel[0], ( f32 )state.vel[1], ( f32 )state.vel[2] ) / SNAPSHOT_VEL_SCALE;
+
+    // the server state is where we were when the command after the acked one was sampled
+    const SPredictedMove* base = FindMove( inputAck + 1 );
+    if ( !predictEnabled || !base || ( inputAck >= sequence ) )
+    {
+      node->setPosition( vServerPos );
+      node->setRotation( vServerRot );
+      NewtonBodySetVelocity( node->body, &vServerVel.X );
+      node->vDrawOffset = vector3df( 0.0f, 0.0f, 0.0f );
+      hardSnaps++;
+      return;
+    }
+
+    lastError = ( vServerPos - base->vPos ).getLength();
+    if ( lastError < predictTolerance )
+    {
+      return;
+    }
+
+    // the commands the server has not seen are stepped again, from its state
+    // and from where we had it; the same step on both sides leaves out what
+    // it gets wrong about the solver, what differs is what the error changed
+    // on the way, like a wall hit or a jump off the ground
+    CNewton* physics = WORLD.GetPhysics();
+    s32 substeps = max( physics->stepRate / max( GAME.goalTicks, 1 ), 1 );
+    f32 dt = physics->timeStep / substeps;
+
+    vector3df vPos = vServerPos, vVel = vServerVel;
+    vector3df vBasePos = base->vPos, vBaseVel = base->vVel;
+    vector3df vRotShift = AngleDifference( vServerRot, base->vRot );
+    bool bReplay = true;
+
+    // the moves still waiting for an ack get the corrected path, so the next
+    // snapshot compares against it and the error is not taken twice
+    for ( u32 s = inputAck + 1; s <= sequence; s++ )
+    {
+      SPredictedMove& move = moves[s % PREDICTION_HISTORY];
+      move.vPos += vPos - vBasePos;
+      move.vVel += vVel - vBaseVel;
+      move.vRot += vRotShift;
+
+      // a node that can not step, a vehicle, keeps the error it had at the ack
+      u16 actionKeys = commands[s % PREDICTION_HISTORY].actionKeys;
+      for ( s32 i = 0; bReplay && ( i < substeps ); i++ )
+      {
+        bReplay = node->PredictStep( actionKeys, dt, vPos, vVel ) && node->PredictStep( actionKeys, dt, vBasePos, vBaseVel );
+      }
+      if ( bReplay )
+      {
+        replayedMoves++;
+      }
+      else
+      {
+        shiftedMoves++;
+      }
+    }
+
+    vector3df vShift = vPos - vBasePos;
+    vector3df vVelShift = vVel - vBaseVel;
+
+    vector3df vNodeVel = node->getVelocity() + vVelShift;
+    node->setPosition( node->getPosition() + vShift );
+    node->setRotation( node->getRotation() + vRotShift );
+    NewtonBodySetVelocity( node->body, &vNodeVel.X );
+
+    // keep drawing it where it was, SampleInput() slides it over
+    if ( vShift.getLength() < predictSnapDistance )
+    {
+      node->vDrawOffset -= vShift;
+    }
+    else
+    {
+      node->vDrawOffset = vector3df( 0.0f, 0.0f, 0.0f );
+    }
+    corrections++;
+}
+
+////////////////////////////////////////////
+// server
+
+void CPrediction::ReceiveInput( Packet* packet )
+{
+    RakNet::BitStream inBitStream( ( unsigned char* )packet->data, packet->length, false );
+    u32 newest;
+    u8 count;
+    if ( ( unsigned char )packet->data[0] == ID_TIMESTAMP )
+    {
+      RakNetTime stamp;
+      inBitStream.IgnoreBits( 8 );
+      if ( !inBitStream.Read( stamp ) )
+      {
+        return;
+      }
+      LAGCOMP->ReceiveTimestamp( packet->playerId, stamp );
+    }
+    inBitStream.IgnoreBits( 8 ); // ID_CRIMSON_INPUT
+    if ( !inBitStream.Read( newest ) || !inBitStream.Read( count ) )
+    {
+      return;
+    }
+
+    SInputClient* client = NULL;
+    for ( u32 i = 0; i < inputClients.size(); i++ )
+    {
+      if ( inputClients[i].playerId == packet->playerId )
+      {
+        client = &inputClients[i];
+        break;
+      }
+    }
+    if ( !client )
+    {
+      SInputClient newClient;
+      newClient.playerId = packet->playerId;
+      newClient.lastApplied = 0;
+      newClient.last.sequence = 0;
+      newClient.last.actionKeys = 0;
+      newClient.last.mousePressed1 = newClient.last.mousePressed2 = false;
+      inputClients.push_back( newClient );
+      client = &inputClients.getLast();
+    }
+
+    // newest first, the older ones are repeats in case a message was lost
+    for ( u32 i = 0; i < count; i++ )
+    {
+      SInputCommand command;
+      command.sequence = newest - i;
+      command.vMousePosWorld.Z = 0.0f;
+      if ( !inBitStream.Read( command.actionKeys ) || !inBitStream.Read( command.mousePressed1 ) || !inBitStream.Read( command.mousePressed2 ) || !inBitStream.Read( command.vMousePosWorld.X ) || !inBitStream.Read( command.vMousePosWorld.Y ) )
+      {
+        return;
+      }
+      if ( command.sequence <= client->lastApplied )
+      {
+        break;
+      }
+
+      // kept in order, skip the ones we have
+      u32 j;
+      for ( j = 0; j < client->pending.size(); j++ )
+      {
+        if ( client->pending[j].sequence >= command.sequence )
+        {
+          break;
+        }
+      }
+      if ( ( j == client->pending.size() ) || ( client->pending[j].sequence != command.sequence ) )
+      {
+        client->pending.insert( command, j );
+      }
+    }
+
+    // a client that got ahead of us, a lag spike, drop the oldest
+    if ( client->pending.size() > PREDICTION_MAX_PENDING )
+    {
+      client->pending.erase( 0, client->pending.size() - PREDICTION_MAX_PENDING );
+    }
+}
+
+void CPrediction::ApplyCommand( CControls* controls, const SInputCommand& command )
+{
+    controls->SetActionKeys( command.actionKeys );
+    controls->mousePressed1 = command.mousePressed1;
+    controls->mousePressed2 = command.mousePressed2;
+    controls->mousePosWorld = command.vMousePosWorld;
+}
+
+void CPrediction::ApplyInputs()
+{
+    for ( u32 i = 0; i < inputClients.size(); i++ )
+    {
+      SInputClient& client = inputClients[i];
+
+      // one command per tick, with none waiting the keys stay as they were
+      if ( client.pending.size() )
+      {
+        client.last = client.pending[0];
+        client.lastApplied = client.last.sequence;
+        client.pending.erase( 0 );
+      }
+
+      CPlayer* player = WORLD.GetPlayers()->GetPlayer( client.playerId );
+      if ( player && player->getControls() && ( player->getControls() != &myControls ) )
+      {
+        ApplyCommand( player->getControls(), client.last );
+      }
+    }
+}
+
+void CPrediction::RemoveClient( PlayerID playerId )
+{
+    for ( u32 i = 0; i < inputClients.size(); i++ )
+    {
+      if ( inputClients[i].playerId == playerId )
+      {
+        inputClients.erase( i );
+        return;
+      }
+    }
+}
+
+u32 CPrediction::getInputAck( PlayerID playerId )
+{
+    for ( u32 i = 0; i < inputClients.size(); i++ )
+    {
+      if ( inputClients[i].playerId == playerId )
+      {
+        return inputClients[i].lastApplied;
+      }
+    }
+    return 0;
+}
+
+void CPrediction::PrintStats()
+{
+    if ( NET.rakServer->IsActive() )
+    {
+      for ( u32 i = 0; i < inputClients.size(); i++ )
+      {
+        CONSOLE.addx( "Input %u:%u: applied %u, %i waiting", inputClients[i].playerId.binaryAddress, inputClients[i].playerId.port, inputClients[i].lastApplied, inputClients[i].pending.size() );
+      }
+    }
+    else
+    {
+      CONSOLE.addx( "Prediction: command %u, %u corrections, %u moves replayed, %u shifted, %u snaps, last error %.3f", sequence, corrections, replayedMoves, shiftedMoves, hardSnaps, lastError );
+    }
+    CONSOLE.addx( "Fake lag %i ms, loss %i%% - %u sent, %u dropped", LAGSIM->fakeLag, LAGSIM->fakeLoss, LAGSIM->sent, LAGSIM->dropped );
+}
@@ -0,0 +1,118 @@
+#ifndef PREDICTION_H_INCLUDED
+#define PREDICTION_H_INCLUDED
+
+#include "network.h"
+#include "BitStream.h"
+
+class CActor;
+class CNewtonNode;
+class CControls;
+struct SEntityState;
+
+#define PREDICTION CPrediction::Instance()
+
+// moves kept for correction, older ones can not be corrected any more
+#define PREDICTION_HISTORY 64
+#define PREDICTION_CHANNEL 2
+// every input message repeats the last few commands so one lost message costs nothing
+#define PREDICTION_REDUNDANCY 4
+// commands the server holds for a client before it skips ahead
+#define PREDICTION_MAX_PENDING 16
+
+// what the player did in one tick
+struct SInputCommand
+{
+    u32 sequence;
+    u16 actionKeys;
+    bool mousePressed1, mousePressed2;
+    vector3df vMousePosWorld;
+};
+
+// where the predicted actor was when a command was sampled
+struct SPredictedMove
+{
+    u32 sequence;
+    NetworkID id;
+    vector3df vPos, vRot, vVel;
+};
+
+////////////////////////////////////////////
+// CPrediction
+// - the client sends its controls every tick as numbered commands and runs
+//   its own actor, or what it rides, on them right away
+// - the server applies each client's commands one per tick and says in
+//   every snapshot which was the last it applied
+// - when the snapshot disagrees with where the client predicted the actor
+//   after that command, the commands since are replayed through the node's
+//   PredictStep() from the server's state, the actor and the moves the
+//   server has not seen yet are corrected by it, the drawn actor slides over
+//   to the corrected place
+// - Newton can not step one body on its own, so PredictStep() is the node's
+//   own forces against the map's static shapes; nodes without one, the
+//   vehicles, only get the error at the acked command added
+////////////////////////////////////////////
+
+class CPrediction
+{
+  public:
+    static CPrediction* Instance()
+    {
+        static CPrediction inst;
+        return &inst;
+    }
+
+    // once per tick before the entities think
+    void Update();
+    void Clear();
+
+    // client
+    // the network ID of what the client predicts, UNASSIGNED_NETWORK_ID if nothing
+    NetworkID getPredictedID()
+    {
+        return predictedId;
+    }
+    void Reconcile( CNewtonNode* node, const SEntityState& state, u32 inputAck );
+
+    // server
+    void ReceiveInput( Packet* packet );
+    void RemoveClient( PlayerID playerId );
+    // the last command applied for the client, 0 if none
+    u32 getInputAck( PlayerID playerId );
+
+    void PrintStats();
+
+    int predictEnabled;
+    f32 predictTolerance, predictSmoothing, predictSnapDistance;
+
+  private:
+    CPrediction();
+
+    struct SInputClient
+    {
+        PlayerID playerId;
+        u32 lastApplied;
+        array<SInputCommand> pending;
+        SInputCommand last;
+    };
+
+    // client
+    void SampleInput();
+    void SendInput();
+    const SPredictedMove* FindMove( u32 moveSequence );
+
+    // server
+    void ApplyInputs();
+    static void ApplyCommand( CControls* controls, const SInputCommand& command );
+
+    u32 sequence;
+    SInputCommand commands[PREDICTION_HISTORY];
+    SPredictedMove moves[PREDICTION_HISTORY];
+    NetworkID predictedId;
+
+    array<SInputClient> inputClients;
+
+    u32 corrections, replayedMoves, shiftedMoves, hardSnaps;
+    f32 lastError;
+};
+
+#endif
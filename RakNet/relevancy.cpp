@@ -0,0 +1,175 @@
+#include "relevancy.h"
+
+// rough size of an update, see CSnapshots::WriteDelta()
+static s32 EstimateBytes( u8 fields )
+{
+    s32 bits = 16 + SNAPSHOT_FIELDS_BITS;
+    if ( fields & SNAPSHOT_POS )
+    {
+      bits += 3 * 12;
+    }
+    if ( fields & SNAPSHOT_ROT )
+    {
+      bits += 3 * 10;
+    }
+    if ( fields & SNAPSHOT_VEL )
+    {
+      bits += 3 * 12;
+    }
+    if ( fields & SNAPSHOT_HEALTH )
+    {
+      bits += 8;
+    }
+    if ( fields & SNAPSHOT_PARENT )
+    {
+      bits += 16;
+    }
+    return ( bits + 7 ) / 8;
+}
+
+static vector3df StatePosition( const SEntityState& state )
+{
+    return vector3df( ( f32 )state.pos[0], ( f32 )state.pos[1], ( f32 )state.pos[2] ) / SNAPSHOT_POS_SCALE;
+}
+
+static f32 DistanceXY( const vector3df& a, const vector3df& b )
+{
+    f32 x = a.X - b.X, y = a.Y - b.Y;
+    return sqrtf( x * x + y * y );
+}
+
+////////////////////////////////////////////
+// CRelevancy
+////////////////////////////////////////////
+
+CRelevancy::CRelevancy()
+{
+    world = NULL;
+    radius = 1.0f;
+    deferred = 0;
+}
+
+void CRelevancy::Build( const SSnapshot& snapshot, f32 relevancyRadius )
+{
+    world = &snapshot;
+    radius = max( relevancyRadius, 1.0f );
+
+    array<aabbox3df> boxes;
+    boxes.reallocate( snapshot.states.size() );
+    for ( u32 i = 0; i < snapshot.states.size(); i++ )
+    {
+      vector3df vPos = StatePosition( snapshot.states[i] );
+      boxes.push_back( aabbox3df( vPos, vPos ) );
+    }
+    grid.Build( boxes, radius, radius );
+}
+
+void CRelevancy::AddCandidate( u32 index, f32 weight, const SSnapshot* baseline, array<SEntityPriority>& priorities, SSnapshot& out )
+{
+    const SEntityState& state = world->states[index];
+    const SEntityState* base = CSnapshots::FindState( baseline, state.id );
+
+    SCandidate candidate;
+    candidate.index = index;
+    if ( base )
+    {
+      u8 fields = CSnapshots::ChangedFields( state, *base );
+      if ( !fields )
+      {
+        // up to date, costs nothing
+        out.states.push_back( state );
+        return;
+      }
+      candidate.bytes = EstimateBytes( fields );
+    }
+    else
+    {
+      candidate.bytes = EstimateBytes( SNAPSHOT_POS | SNAPSHOT_ROT | SNAPSHOT_VEL | SNAPSHOT_HEALTH | SNAPSHOT_PARENT );
+      weight = RELEVANCY_NEW_WEIGHT;
+    }
+
+    SEntityPriority key;
+    key.id = state.id;
+    s32 found = priorities.binary_search( key );
+    candidate.priority = ( ( found >= 0 ) ? priorities[found].priority : 0.0f ) + weight;
+    candidates.push_back( candidate );
+}
+
+void CRelevancy::Select( const SRelevancyView& view, const SSnapshot* baseline, array<SEntityPriority>& priorities, s32 budget, SSnapshot& out )
+{
+    u32 i;
+
+    out.states.set_used( 0 );
+    candidates.set_used( 0 );
+    newPriorities.set_used( 0 );
+    if ( !world )
+    {
+      return;
+    }
+
+    if ( !view.bViewer )
+    {
+      for ( i = 0; i < world->states.size(); i++ )
+      {
+        AddCandidate( i, 1.0f, baseline, priorities, out );
+      }
+    }
+    else
+    {
+      found.set_used( 0 );
+      vector3df vRadius( radius, radius, radius );
+      grid.Query( aabbox3df( view.vPos - vRadius, view.vPos + vRadius ), found );
+      for ( i = 0; i < found.size(); i++ )
+      {
+        f32 distance = DistanceXY( StatePosition( world->states[found[i]] ), view.vPos );
+        if ( distance <= radius )
+        {
+          AddCandidate( found[i], 1.0f - ( 1.0f - RELEVANCY_MIN_WEIGHT ) * distance / radius, baseline, priorities, out );
+        }
+      }
+
+      // team mates are followed across the map
+      for ( i = 0; i < world->states.size(); i++ )
+      {
+        const SEntityState& state = world->states[i];
+        if ( ( state.team == view.team ) && ( DistanceXY( StatePosition( state ), view.vPos ) > radius ) )
+        {
+          AddCandidate( i, RELEVANCY_MIN_WEIGHT, baseline, priorities, out );
+        }
+      }
+    }
+
+    // the most overdue go first, the rest wait with the state the client has
+    candidates.sort();
+    s32 spent = 0;
+    for ( i = 0; i < candidates.size(); i++ )
+    {
+      SCandidate& candidate = candidates[i];
+      const SEntityState& state = world->states[candidate.index];
+
+      if ( ( budget <= 0 ) || ( spent == 0 ) || ( spent + candidate.bytes <= budget ) )
+      {
+        out.states.push_back( state );
+        spent += candidate.bytes;
+        candidate.priority = 0.0f;
+      }
+      else
+      {
+        const SEntityState* base = CSnapshots::FindState( baseline, state.id );
+        if ( base )
+        {
+          out.states.push_back( *base );
+        }
+        deferred++;
+      }
+
+      SEntityPriority priority;
+      priority.id = state.id;
+      priority.priority = candidate.priority;
+      newPriorities.push_back( priority );
+    }
+
+    newPriorities.sort();
+    priorities = newPriorities;
+    out.states.sort();
+}
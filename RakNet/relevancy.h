@@ -0,0 +1,69 @@
+#ifndef RELEVANCY_H_INCLUDED
+#define RELEVANCY_H_INCLUDED
+
+#include "snapshot.h"
+#include "../World/mapgrid.h"
+
+// weight of an actor at the edge of the radius and of team mates beyond it
+#define RELEVANCY_MIN_WEIGHT 0.1f
+// actors a client has not seen yet jump the queue
+#define RELEVANCY_NEW_WEIGHT 100.0f
+
+// where a client looks from
+struct SRelevancyView
+{
+    // false for a client without an actor, it gets everything
+    bool bViewer;
+    vector3df vPos;
+    s32 team;
+};
+
+////////////////////////////////////////////
+// CRelevancy
+// - grid of the actors in a snapshot over the XY plane, queried around
+//   each client's view
+// - a relevant actor gains priority every snapshot it is not sent, more
+//   when it is close, and the client gets the highest ones that fit its
+//   byte budget, the rest keep the state the client already has
+////////////////////////////////////////////
+
+class CRelevancy
+{
+  public:
+    CRelevancy();
+
+    // world must stay alive until the last Select()
+    void Build( const SSnapshot& world, f32 radius );
+
+    // budget in bytes, 0 for no limit
+    void Select( const SRelevancyView& view, const SSnapshot* baseline, array<SEntityPriority>& priorities, s32 budget, SSnapshot& out );
+
+    // actors that changed but did not fit the budget
+    u32 deferred;
+
+  private:
+    struct SCandidate
+    {
+        u32 index;
+        f32 priority;
+        s32 bytes;
+
+        // highest first
+        bool operator <( const SCandidate& other ) const
+        {
+            return priority > other.priority;
+        }
+    };
+
+    void AddCandidate( u32 index, f32 weight, const SSnapshot* baseline, array<SEntityPriority>& priorities, SSnapshot& out );
+
+    const SSnapshot* world;
+    f32 radius;
+    CMapGrid grid;
+
+    array<s32> found;
+    array<SCandidate> candidates;
+    array<SEntityPriority> newPriorities;
+};
+
+#endif
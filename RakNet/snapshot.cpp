@@ -0,0 +1,948 @@
+#include "snapshot.h"
+#include "relevancy.h"
+#include "prediction.h"
+#include "lagsim.h"
+
+#include "../App/app.h"
+#include "../App/misc.h"
+#include "../Game/SingletonIncludes.h"
+#include "../IrrConsole/console_vars.h"
+
+#include "../World/actor.h"
+#include "../World/map.h"
+#include "../Newton/newton_node.h"
+
+#include "CustomPackets.h"
+
+static CRelevancy relevancy;
+
+void CSnapshots::ZeroState( SEntityState& state )
+{
+    state.id = UNASSIGNED_NETWORK_ID;
+    state.pos[0] = state.pos[1] = state.pos[2] = 0;
+    state.rot[0] = state.rot[1] = state.rot[2] = 0;
+    state.vel[0] = state.vel[1] = state.vel[2] = 0;
+    state.health = 0;
+    state.parent = UNASSIGNED_NETWORK_ID;
+    state.team = 0;
+}
+
+static s32 QuantizeFloat( f32 value, f32 scale )
+{
+    value *= scale;
+    return ( s32 )( value < 0.0f ? value - 0.5f : value + 0.5f );
+}
+
+// whole turn in 16 bits
+static u16 QuantizeAngle( f32 degrees )
+{
+    return ( u16 )( s32 )floorf( degrees * ( 65536.0f / 360.0f ) + 0.5f );
+}
+
+static f32 AngleDegrees( u16 angle )
+{
+    return angle * ( 360.0f / 65536.0f );
+}
+
+static void QuantizeState( SEntityState& state, NetworkID id, vector3df vPos, vector3df vRot, vector3df vVel, f32 health, NetworkID parent, s32 team )
+{
+    state.id = id;
+    state.pos[0] = QuantizeFloat( vPos.X, SNAPSHOT_POS_SCALE );
+    state.pos[1] = QuantizeFloat( vPos.Y, SNAPSHOT_POS_SCALE );
+    state.pos[2] = QuantizeFloat( vPos.Z, SNAPSHOT_POS_SCALE );
+    state.rot[0] = QuantizeAngle( vRot.X );
+    state.rot[1] = QuantizeAngle( vRot.Y );
+    state.rot[2] = QuantizeAngle( vRot.Z );
+    state.vel[0] = QuantizeFloat( vVel.X, SNAPSHOT_VEL_SCALE );
+    state.vel[1] = QuantizeFloat( vVel.Y, SNAPSHOT_VEL_SCALE );
+    state.vel[2] = QuantizeFloat( vVel.Z, SNAPSHOT_VEL_SCALE );
+    state.health = ( s16 )max( -32768, min( 32767, QuantizeFloat( health, 1.0f ) ) );
+    state.parent = parent;
+    state.team = team;
+}
+
+u8 CSnapshots::ChangedFields( const SEntityState& state, const SEntityState& base )
+{
+    u8 fields = 0;
+    if ( ( state.pos[0] != base.pos[0] ) || ( state.pos[1] != base.pos[1] ) || ( state.pos[2] != base.pos[2] ) )
+    {
+      fields |= SNAPSHOT_POS;
+    }
+    if ( ( state.rot[0] != base.rot[0] ) || ( state.rot[1] != base.rot[1] ) || ( state.rot[2] != base.rot[2] ) )
+    {
+      fields |= SNAPSHOT_ROT;
+    }
+    if ( ( state.vel[0] != base.vel[0] ) || ( state.vel[1] != base.vel[1] ) || ( state.vel[2] != base.vel[2] ) )
+    {
+      fields |= SNAPSHOT_VEL;
+    }
+    if ( state.health != base.health )
+    {
+      fields |= SNAPSHOT_HEALTH;
+    }
+    if ( state.parent != base.parent )
+    {
+      fields |= SNAPSHOT_PARENT;
+    }
+    return fields;
+}
+
+// states are sorted by id
+const SEntityState* CSnapshots::FindState( const SSnapshot* snapshot, const NetworkID& id )
+{
+    if ( !snapshot )
+    {
+      return NULL;
+    }
+
+    s32 left = 0, right = ( s32 )snapshot->states.size() - 1;
+    while ( left <= right )
+    {
+      s32 middle = ( left + right ) >> 1;
+      const SEntityState& state = snapshot->states[middle];
+      if ( state.id == id )
+      {
+        return &state;
+      }
+      if ( state.id < id )
+      {
+        left = middle + 1;
+      }
+      else
+      {
+        right = middle - 1;
+      }
+    }
+    return NULL;
+}
+
+// small deltas of either sign become small unsigned numbers that WriteCompressed() packs
+static void WriteSigned( RakNet::BitStream& bs, s32 delta )
+{
+    bs.WriteCompressed( ( u32 )( ( delta << 1 ) ^ ( delta >> 31 ) ) );
+}
+
+static bool ReadSigned( RakNet::BitStream& bs, s32& delta )
+{
+    u32 zigzag;
+    if ( !bs.ReadCompressed( zigzag ) )
+    {
+      return false;
+    }
+    delta = ( s32 )( zigzag >> 1 ) ^ -( s32 )( zigzag & 1 );
+    return true;
+}
+
+bool SEntityState::operator ==( const SEntityState& other ) const
+{
+    return ( id == other.id ) && !CSnapshots::ChangedFields( *this, other );
+}
+
+////////////////////////////////////////////
+// CSnapshots
+////////////////////////////////////////////
+
+CSnapshots::CSnapshots()
+{
+    Clear();
+
+    CONSOLE_VAR( "sv_snapshotrate", int, snapshotRate, 3, L"sv_snapshotrate [ticks]. Ex. sv_snapshotrate 3", L"Number of game ticks between the actor snapshots the server sends to clients." );
+    CONSOLE_VAR( "sv_relevancy", int, relevancyEnabled, 1, L"sv_relevancy [0/1]. Ex. sv_relevancy 0", L"Send clients only the actors near their own and their team mates." );
+    CONSOLE_VAR( "sv_relevancyradius", f32, relevancyRadius, 400.0f, L"sv_relevancyradius [units]. Ex. sv_relevancyradius 400", L"Distance from a client's actor within which other actors are sent to it." );
+    CONSOLE_VAR( "sv_clientrate", int, clientRate, 8000, L"sv_clientrate [bytes/sec]. Ex. sv_clientrate 8000", L"Snapshot bytes per second each client gets, the most overdue actors go first. 0 for no limit." );
+}
+
+void CSnapshots::Clear()
+{
+    for ( u32 c = 0; c < clients.size(); c++ )
+    {
+      delete[] clients[c].sent;
+    }
+    clients.clear();
+
+    world.sequence = 0;
+    world.states.clear();
+    for ( int i = 0; i < SNAPSHOT_HISTORY; i++ )
+    {
+      received[i].sequence = 0;
+      received[i].states.clear();
+    }
+    sequence = 0;
+    lastReceived = 0;
+    ticks = 0;
+}
+
+void CSnapshots::AddClient( PlayerID playerId )
+{
+    RemoveClient( playerId );
+
+    SClient client;
+    client.playerId = playerId;
+    client.ackedSequence = 0;
+    client.sent = new SSnapshot[SNAPSHOT_HISTORY];
+    client.bytesSent = client.bytesThisSecond = client.bytesPerSecond = 0;
+    client.fullSnapshots = client.deltaSnapshots = 0;
+    clients.push_back( client );
+}
+
+void CSnapshots::RemoveClient( PlayerID playerId )
+{
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      if ( clients[i].playerId == playerId )
+      {
+        delete[] clients[i].sent;
+        clients.erase( i );
+        return;
+      }
+    }
+}
+
+void CSnapshots::TakeState( CActor* actor, SEntityState& state )
+{
+    NetworkID parent = UNASSIGNED_NETWORK_ID;
+    if ( actor->isAttached() )
+    {
+      parent = actor->getParentAttachment()->GetNetworkID();
+    }
+    QuantizeState( state, actor->GetNetworkID(), actor->getPosition(), actor->getRotation(), actor->getVelocity(), ( f32 )actor->getHealth(), parent, actor->getTeam() );
+}
+
+void CSnapshots::TakeSnapshot( SSnapshot& snapshot )
+{
+    snapshot.states.set_used( 0 );
+
+    SEntityState state;
+    for ( u32 i = 0; i < CActor::actorsList.size(); i++ )
+    {
+      CActor* actor = CActor::actorsList[i];
+      if ( actor->isZombie() || ( actor->GetNetworkID() == UNASSIGNED_NETWORK_ID ) )
+      {
+        continue;
+      }
+      TakeState( actor, state );
+      snapshot.states.push_back( state );
+    }
+    snapshot.states.sort();
+}
+
+void CSnapshots::WriteDelta( RakNet::BitStream& bs, const SSnapshot& snapshot, const SSnapshot* baseline )
+{
+    u32 i;
+
+    array<NetworkID> removed;
+    if ( baseline )
+    {
+      for ( i = 0; i < baseline->states.size(); i++ )
+      {
+        if ( !FindState( &snapshot, baseline->states[i].id ) )
+        {
+          removed.push_back( baseline->states[i].id );
+        }
+      }
+    }
+
+    bs.WriteCompressed( ( u16 )removed.size() );
+    for ( i = 0; i < removed.size(); i++ )
+    {
+      bs.Write( removed[i] );
+    }
+
+    // actors the client does not know go against an empty state
+    SEntityState zero;
+    ZeroState( zero );
+
+    array<u32> changed;
+    array<u8> changedFields;
+    for ( i = 0; i < snapshot.states.size(); i++ )
+    {
+      const SEntityState* base = FindState( baseline, snapshot.states[i].id );
+      u8 fields = ChangedFields( snapshot.states[i], base ? *base : zero );
+      if ( fields || !base )
+      {
+        changed.push_back( i );
+        changedFields.push_back( fields );
+      }
+    }
+
+    bs.WriteCompressed( ( u16 )changed.size() );
+    for ( i = 0; i < changed.size(); i++ )
+    {
+      const SEntityState& state = snapshot.states[changed[i]];
+      const SEntityState* base = FindState( baseline, state.id );
+      if ( !base )
+      {
+        base = &zero;
+      }
+      u8 fields = changedFields[i];
+
+      bs.Write( state.id );
+      bs.WriteBits( &fields, SNAPSHOT_FIELDS_BITS );
+
+      int j;
+      if ( fields & SNAPSHOT_POS )
+      {
+        for ( j = 0; j < 3; j++ )
+        {
+          WriteSigned( bs, state.pos[j] - base->pos[j] );
+        }
+      }
+      if ( fields & SNAPSHOT_ROT )
+      {
+        // the short way round
+        for ( j = 0; j < 3; j++ )
+        {
+          WriteSigned( bs, ( s16 )( u16 )( state.rot[j] - base->rot[j] ) );
+        }
+      }
+      if ( fields & SNAPSHOT_VEL )
+      {
+        for ( j = 0; j < 3; j++ )
+        {
+          WriteSigned( bs, state.vel[j] - base->vel[j] );
+        }
+      }
+      if ( fields & SNAPSHOT_HEALTH )
+      {
+        WriteSigned( bs, state.health - base->health );
+      }
+      if ( fields & SNAPSHOT_PARENT )
+      {
+        bs.Write( state.parent );
+      }
+    }
+}
+
+bool CSnapshots::ReadDelta( RakNet::BitStream& bs, const SSnapshot* baseline, SSnapshot& snapshot )
+{
+    u32 i;
+    u16 removedNum, changedNum;
+
+    snapshot.states.set_used( 0 );
+
+    if ( !bs.ReadCompressed( removedNum ) )
+    {
+      return false;
+    }
+    array<NetworkID> removed;
+    for ( i = 0; i < removedNum; i++ )
+    {
+      NetworkID id;
+      if ( !bs.Read( id ) )
+      {
+        return false;
+      }
+      removed.push_back( id );
+    }
+
+    if ( !bs.ReadCompressed( changedNum ) )
+    {
+      return false;
+    }
+
+    SEntityState zero;
+    ZeroState( zero );
+
+    array<NetworkID> changed;
+    for ( i = 0; i < changedNum; i++ )
+    {
+      SEntityState state;
+      u8 fields = 0;
+      if ( !bs.Read( state.id ) || !bs.ReadBits( &fields, SNAPSHOT_FIELDS_BITS ) )
+      {
+        return false;
+      }
+
+      const SEntityState* base = FindState( baseline, state.id );
+      if ( !base )
+      {
+        base = &zero;
+      }
+      NetworkID id = state.id;
+      state = *base;
+      state.id = id;
+
+      int j;
+      s32 delta;
+      if ( fields & SNAPSHOT_POS )
+      {
+        for ( j = 0; j < 3; j++ )
+        {
+          if ( !ReadSigned( bs, delta ) )
+          {
+            return false;
+          }
+          state.pos[j] += delta;
+        }
+      }
+      if ( fields & SNAPSHOT_ROT )
+      {
+        for ( j = 0; j < 3; j++ )
+        {
+          if ( !ReadSigned( bs, delta ) )
+          {
+            return false;
+          }
+          state.rot[j] = ( u16 )( state.rot[j] + delta );
+        }
+      }
+      if ( fields & SNAPSHOT_VEL )
+      {
+        for ( j = 0; j < 3; j++ )
+        {
+          if ( !ReadSigned( bs, delta ) )
+          {
+            return false;
+          }
+          state.vel[j] += delta;
+        }
+      }
+      if ( fields & SNAPSHOT_HEALTH )
+      {
+        if ( !ReadSigned( bs, delta ) )
+        {
+          return false;
+        }
+        state.health = ( s16 )( state.health + delta );
+      }
+      if ( fields & SNAPSHOT_PARENT )
+      {
+        if ( !bs.Read( state.parent ) )
+        {
+          return false;
+        }
+      }
+
+      snapshot.states.push_back( state );
+      changed.push_back( id );
+    }
+
+    // the rest of the baseline did not change
+    if ( baseline )
+    {
+      for ( i = 0; i < baseline->states.size(); i++ )
+      {
+        const SEntityState& state = baseline->states[i];
+        if ( ( removed.linear_search( state.id ) == -1 ) && ( changed.linear_search( state.id ) == -1 ) )
+        {
+          snapshot.states.push_back( state );
+        }
+      }
+    }
+    snapshot.states.sort();
+
+    return true;
+}
+
+// the client's camera follows its actor or what the actor rides
+static void ClientView( PlayerID playerId, SRelevancyView& view )
+{
+    CActor* actor = CActor::getActorWithPlayerID( playerId );
+    view.bViewer = actor && !actor->isZombie();
+    if ( view.bViewer )
+    {
+      CNewtonNode* parent = actor->GetGreatestParent();
+      view.vPos = parent ? parent->getPosition() : actor->getPosition();
+      view.team = actor->getTeam();
+    }
+}
+
+void CSnapshots::Update()
+{
+    if ( !NET.rakServer->IsActive() )
+    {
+      return;
+    }
+
+    ticks++;
+    u32 i;
+
+    if ( ( ticks % GAME.goalTicks ) == 0 )
+    {
+      for ( i = 0; i < clients.size(); i++ )
+      {
+        clients[i].bytesPerSecond = clients[i].bytesThisSecond;
+        clients[i].bytesThisSecond = 0;
+      }
+    }
+
+    if ( ( clients.size() == 0 ) || ( ticks % max( snapshotRate, 1 ) ) )
+    {
+      return;
+    }
+
+    sequence++;
+    TakeSnapshot( world );
+    world.sequence = sequence;
+    if ( relevancyEnabled )
+    {
+      relevancy.Build( world, relevancyRadius );
+    }
+    s32 budget = clientRate * max( snapshotRate, 1 ) / GAME.goalTicks;
+
+    for ( i = 0; i < clients.size(); i++ )
+    {
+      SClient& client = clients[i];
+
+      const SSnapshot* baseline = NULL;
+      if ( client.ackedSequence && ( sequence - client.ackedSequence < SNAPSHOT_HISTORY ) )
+      {
+        baseline = &client.sent[client.ackedSequence % SNAPSHOT_HISTORY];
+        if ( baseline->sequence != client.ackedSequence )
+        {
+          baseline = NULL;
+        }
+      }
+
+      SSnapshot& snapshot = client.sent[sequence % SNAPSHOT_HISTORY];
+      if ( relevancyEnabled )
+      {
+        SRelevancyView view;
+        ClientView( client.playerId, view );
+        relevancy.Select( view, baseline, client.priorities, budget, snapshot );
+      }
+      else
+      {
+        snapshot.states = world.states;
+      }
+      snapshot.sequence = sequence;
+
+      RakNet::BitStream bs;
+      bs.Write( ( unsigned char )ID_CRIMSON_SNAPSHOT );
+      bs.Write( sequence );
+      bs.Write( baseline ? baseline->sequence : ( u32 )0 );
+      bs.Write( PREDICTION->getInputAck( client.playerId ) );
+      WriteDelta( bs, snapshot, baseline );
+
+      LAGSIM->Send( bs, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, SNAPSHOT_CHANNEL, client.playerId );
+
+      client.bytesSent += bs.GetNumberOfBytesUsed();
+      client.bytesThisSecond += bs.GetNumberOfBytesUsed();
+      if ( baseline )
+      {
+        client.deltaSnapshots++;
+      }
+      else
+      {
+        client.fullSnapshots++;
+      }
+    }
+}
+
+void CSnapshots::ReceiveAck( Packet* packet )
+{
+    RakNet::BitStream inBitStream( ( unsigned char* )packet->data, packet->length, false );
+    u32 acked;
+    inBitStream.IgnoreBits( 8 ); // ID_CRIMSON_SNAPSHOTACK
+    if ( !inBitStream.Read( acked ) )
+    {
+      return;
+    }
+
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      if ( clients[i].playerId == packet->playerId )
+      {
+        if ( ( acked > clients[i].ackedSequence ) && ( acked <= sequence ) )
+        {
+          clients[i].ackedSequence = acked;
+        }
+        return;
+      }
+    }
+}
+
+void CSnapshots::ReceiveSnapshot( Packet* packet )
+{
+    RakNet::BitStream inBitStream( ( unsigned char* )packet->data, packet->length, false );
+    u32 newSequence, baseSequence, inputAck;
+    inBitStream.IgnoreBits( 8 ); // ID_CRIMSON_SNAPSHOT
+    if ( !inBitStream.Read( newSequence ) || !inBitStream.Read( baseSequence ) || !inBitStream.Read( inputAck ) )
+    {
+      return;
+    }
+    if ( ( newSequence <= lastReceived ) || ( baseSequence >= newSequence ) )
+    {
+      return;
+    }
+
+    const SSnapshot* baseline = NULL;
+    if ( baseSequence )
+    {
+      baseline = &received[baseSequence % SNAPSHOT_HISTORY];
+      // we no longer have it, the next one will be against something we acked later
+      if ( baseline->sequence != baseSequence )
+      {
+        return;
+      }
+    }
+
+    SSnapshot& snapshot = received[newSequence % SNAPSHOT_HISTORY];
+    if ( !ReadDelta( inBitStream, baseline, snapshot ) )
+    {
+      snapshot.sequence = 0;
+      return;
+    }
+    snapshot.sequence = newSequence;
+    lastReceived = newSequence;
+
+#ifdef _CLIENT
+    RakNet::BitStream bs;
+    bs.Write( ( unsigned char )ID_CRIMSON_SNAPSHOTACK );
+    bs.Write( newSequence );
+    LAGSIM->Send( bs, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, SNAPSHOT_CHANNEL, UNASSIGNED_PLAYER_ID );
+#endif
+
+    // a listen server already has the real thing
+    if ( !NET.rakServer->IsActive() )
+    {
+      Apply( snapshot, inputAck );
+    }
+}
+
+void CSnapshots::Apply( const SSnapshot& snapshot, u32 inputAck )
+{
+    for ( u32 i = 0; i < snapshot.states.size(); i++ )
+    {
+      const SEntityState& state = snapshot.states[i];
+
+      // not created yet, ID_CRIMSON_NEWACTOR comes on another channel
+      CNewtonNode* object = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( state.id );
+      if ( !object || object->isZombie() || ( object->getType() == NODECLASS_DEFAULT ) || ( object->getType() == NODECLASS_PROP ) )
+      {
+        continue;
+      }
+      CActor* actor = static_cast<CActor*>( object );
+
+      CNewtonNode* parent = NULL;
+      if ( state.parent != UNASSIGNED_NETWORK_ID )
+      {
+        parent = ( CNewtonNode* )NetworkIDGenerator::GET_OBJECT_FROM_ID( state.parent );
+      }
+      if ( actor->getParentAttachment() != parent )
+      {
+        if ( actor->isAttached() )
+        {
+          actor->unAttachFromParent();
+        }
+        if ( parent )
+        {
+          actor->attachToParentNode( parent, actor->getControls() );
+        }
+      }
+
+      // attached actors follow their parent
+      if ( ( state.id == PREDICTION->getPredictedID() ) && actor->body )
+      {
+        PREDICTION->Reconcile( actor, state, inputAck );
+      }
+      else if ( !actor->isAttached() && actor->body )
+      {
+        actor->setPosition( vector3df( state.pos[0], state.pos[1], state.pos[2] ) / SNAPSHOT_POS_SCALE );
+        actor->setRotation( vector3df( AngleDegrees( state.rot[0] ), AngleDegrees( state.rot[1] ), AngleDegrees( state.rot[2] ) ) );
+        vector3df vVel = vector3df( state.vel[0], state.vel[1], state.vel[2] ) / SNAPSHOT_VEL_SCALE;
+        NewtonBodySetVelocity( actor->body, &vVel.X );
+      }
+
+      actor->setHealth( state.health );
+    }
+}
+
+void CSnapshots::PrintStats()
+{
+    CONSOLE.addx( "Snapshots: sequence %u, %i actors, one every %i ticks, %u updates deferred by the client rate", sequence, world.states.size(), snapshotRate, relevancy.deferred );
+    for ( u32 i = 0; i < clients.size(); i++ )
+    {
+      CONSOLE.addx( "  %u:%u - %.2f kbps, %u bytes sent, %u full, %u delta, acked %u", clients[i].playerId.binaryAddress, clients[i].playerId.port, clients[i].bytesPerSecond * 8 / 1000.0f, clients[i].bytesSent, clients[i].fullSnapshots, clients[i].deltaSnapshots, clients[i].ackedSequence );
+    }
+}
+
+////////////////////////////////////////////
+// Loopback
+////////////////////////////////////////////
+
+struct SLoopbackClient
+{
+    SSnapshot received[SNAPSHOT_HISTORY];
+    u32 ackedSequence;
+    u32 bytesSent;
+};
+
+// a made-up actor: most move in circles, some stand still, some keep dying and
+// coming back, some ride the one before them
+static bool LoopbackState( int index, int tick, SEntityState& state )
+{
+    if ( ( index % 7 == 3 ) && ( ( tick / 50 + index ) % 2 ) )
+    {
+      return false;
+    }
+
+    NetworkID id, parent = UNASSIGNED_NETWORK_ID;
+    id.playerId = UNASSIGNED_PLAYER_ID;
+    id.localSystemId = ( unsigned short )( index + 1 );
+    if ( index % 10 == 9 )
+    {
+      parent.playerId = UNASSIGNED_PLAYER_ID;
+      parent.localSystemId = ( unsigned short )index;
+    }
+
+    f32 radius = 5.0f + index;
+    f32 speed = ( index % 4 == 0 ) ? 0.0f : 0.02f * ( 1 + index % 3 );
+    f32 angle = tick * speed + index;
+    vector3df vPos( radius * cosf( angle ), radius * sinf( angle ), 0.0f );
+    vector3df vVel( -radius * speed * sinf( angle ), radius * speed * cosf( angle ), 0.0f );
+    vector3df vRot( 0.0f, 0.0f, angle * RADTODEG );
+    f32 health = ( index % 5 == 0 ) ? 100.0f - ( tick / 20 + index ) % 100 : 100.0f;
+
+    QuantizeState( state, id, vPos, vRot, vVel, health, parent, 0 );
+    return true;
+}
+
+void CSnapshots::Loopback( int clientsNum, int entitiesNum, int ticksNum, int lossPercent )
+{
+    int i, c;
+    int rate = max( snapshotRate, 1 );
+
+    SSnapshot* serverHistory = new SSnapshot[SNAPSHOT_HISTORY];
+    SLoopbackClient* loopClients = new SLoopbackClient[clientsNum];
+    for ( c = 0; c < clientsNum; c++ )
+    {
+      loopClients[c].ackedSequence = 0;
+      loopClients[c].bytesSent = 0;
+    }
+
+    u32 loopSequence = 0;
+    u32 packets = 0, lost = 0, decoded = 0, mismatches = 0;
+    u32 fullBytes = 0;
+    u32 encodeTime = 0, decodeTime = 0;
+    SEntityState state;
+
+    for ( int tick = 1; tick <= ticksNum; tick++ )
+    {
+      if ( tick % rate )
+      {
+        continue;
+      }
+
+      loopSequence++;
+      SSnapshot& snapshot = serverHistory[loopSequence % SNAPSHOT_HISTORY];
+      snapshot.states.set_used( 0 );
+      for ( i = 0; i < entitiesNum; i++ )
+      {
+        if ( LoopbackState( i, tick, state ) )
+        {
+          snapshot.states.push_back( state );
+        }
+      }
+      snapshot.states.sort();
+      snapshot.sequence = loopSequence;
+
+      RakNet::BitStream full;
+      WriteDelta( full, snapshot, NULL );
+      fullBytes += full.GetNumberOfBytesUsed();
+
+      for ( c = 0; c < clientsNum; c++ )
+      {
+        SLoopbackClient& client = loopClients[c];
+
+        const SSnapshot* baseline = NULL;
+        if ( client.ackedSequence && ( loopSequence - client.ackedSequence < SNAPSHOT_HISTORY ) )
+        {
+          baseline = &serverHistory[client.ackedSequence % SNAPSHOT_HISTORY];
+        }
+
+        u32 start = getMicroTime();
+        RakNet::BitStream bs;
+        bs.Write( ( unsigned char )ID_CRIMSON_SNAPSHOT );
+        bs.Write( loopSequence );
+        bs.Write( baseline ? baseline->sequence : ( u32 )0 );
+        bs.Write( ( u32 )0 );
+        WriteDelta( bs, snapshot, baseline );
+        encodeTime += getMicroTime() - start;
+
+        client.bytesSent += bs.GetNumberOfBytesUsed();
+        packets++;
+
+        if ( random( 100 ) < lossPercent )
+        {
+          lost++;
+          continue;
+        }
+
+        // the client side of ReceiveSnapshot()
+        start = getMicroTime();
+        u32 newSequence, baseSequence, inputAck;
+        bs.IgnoreBits( 8 );
+        bs.Read( newSequence );
+        bs.Read( baseSequence );
+        bs.Read( inputAck );
+        const SSnapshot* clientBaseline = NULL;
+        if ( baseSequence )
+        {
+          clientBaseline = &client.received[baseSequence % SNAPSHOT_HISTORY];
+          if ( clientBaseline->sequence != baseSequence )
+          {
+            mismatches++;
+            continue;
+          }
+        }
+        SSnapshot& result = client.received[newSequence % SNAPSHOT_HISTORY];
+        bool bRead = ReadDelta( bs, clientBaseline, result );
+        decodeTime += getMicroTime() - start;
+        decoded++;
+
+        bool bSame = bRead && ( result.states.size() == snapshot.states.size() );
+        for ( i = 0; bSame && ( i < ( int )result.states.size() ); i++ )
+        {
+          bSame = ( result.states[i] == snapshot.states[i] );
+        }
+        if ( !bSame )
+        {
+          mismatches++;
+          result.sequence = 0;
+          continue;
+        }
+        result.sequence = newSequence;
+
+        // the ack can get lost too
+        if ( random( 100 ) >= lossPercent )
+        {
+          client.ackedSequence = newSequence;
+        }
+      }
+    }
+
+    u32 bytesSent = 0;
+    for ( c = 0; c < clientsNum; c++ )
+    {
+      bytesSent += loopClients[c].bytesSent;
+    }
+
+    f32 perSnapshot = packets ? ( f32 )bytesSent / packets : 0.0f;
+    f32 fullPerSnapshot = loopSequence ? ( f32 )fullBytes / loopSequence : 0.0f;
+    f32 kbps = perSnapshot * 8 * GAME.goalTicks / rate / 1000.0f;
+
+    APPLOG.Write( "Snapshot loopback: %i clients, %i actors, %i ticks, a snapshot every %i ticks, %i%% loss", clientsNum, entitiesNum, ticksNum, rate, lossPercent );
+    APPLOG.Write( "Snapshot loopback: %u snapshots, %u sent, %u lost, %u decoded, %u mismatches", loopSequence, packets, lost, decoded, mismatches );
+    APPLOG.Write( "Snapshot loopback: %.1f bytes per client snapshot (%.2f kbps), %.1f bytes for a full one", perSnapshot, kbps, fullPerSnapshot );
+    APPLOG.Write( "Snapshot loopback: encode %.2f us, decode %.2f us per snapshot", packets ? ( f32 )encodeTime / packets : 0.0f, decoded ? ( f32 )decodeTime / decoded : 0.0f );
+    CONSOLE.addx( "Snapshot loopback: %.1f bytes per client snapshot against %.1f full, %u mismatches", perSnapshot, fullPerSnapshot, mismatches );
+
+    delete[] loopClients;
+    delete[] serverHistory;
+}
+
+////////////////////////////////////////////
+// RelevancyBenchmark
+////////////////////////////////////////////
+
+// planes spread over the map, each flying a small circle around its own spot
+static void BenchmarkState( int index, int tick, f32 width, f32 height, SEntityState& state )
+{
+    NetworkID id;
+    id.playerId = UNASSIGNED_PLAYER_ID;
+    id.localSystemId = ( unsigned short )( index + 1 );
+
+    vector3df vHome( fmodf( index * 7919.0f, 1000.0f ) / 1000.0f * width, fmodf( index * 104729.0f, 1000.0f ) / 1000.0f * height, 0.0f );
+    f32 angle = tick * 0.02f + index;
+    vector3df vPos = vHome + vector3df( 50.0f * cosf( angle ), 50.0f * sinf( angle ), 0.0f );
+    vector3df vVel( -sinf( angle ), cosf( angle ), 0.0f );
+    vector3df vRot( 0.0f, 0.0f, angle * RADTODEG );
+
+    QuantizeState( state, id, vPos, vRot, vVel, 100.0f, UNASSIGNED_NETWORK_ID, index % 2 );
+}
+
+void CSnapshots::RelevancyBenchmark( int entitiesNum, int ticksNum )
+{
+    static const int clientsNums[] = { 32, 64, 128 };
+    int rate = max( snapshotRate, 1 );
+    s32 budget = clientRate * rate / GAME.goalTicks;
+    f32 seconds = ( f32 )ticksNum / GAME.goalTicks;
+
+    // dogfight sized if there is no map
+    f32 width = 8000.0f, height = 2000.0f;
+    if ( WORLD.GetMap() )
+    {
+      width = max( WORLD.GetMap()->worldWidth, 100.0f );
+      height = max( WORLD.GetMap()->worldHeight, 100.0f );
+    }
+
+    APPLOG.Write( "Relevancy benchmark: %i actors over %.0f x %.0f, %i ticks, radius %.0f, %i bytes per client snapshot", entitiesNum, width, height, ticksNum, relevancyRadius, budget );
+
+    CRelevancy benchRelevancy;
+    SSnapshot benchWorld;
+    SEntityState state;
+
+    for ( int n = 0; n < 3; n++ )
+    {
+      for ( int relevant = 0; relevant < 2; relevant++ )
+      {
+        int clientsNum = clientsNums[n];
+
+        // nothing is lost, the previous snapshot is always the baseline
+        SSnapshot* sent = new SSnapshot[clientsNum * 2];
+        array<SEntityPriority>* priorities = new array<SEntityPriority>[clientsNum];
+        u32 bytes = 0, time = 0, snapshots = 0;
+        benchRelevancy.deferred = 0;
+
+        for ( int tick = 1; tick <= ticksNum; tick++ )
+        {
+          if ( tick % rate )
+          {
+            continue;
+          }
+          snapshots++;
+
+          benchWorld.states.set_used( 0 );
+          for ( int i = 0; i < entitiesNum; i++ )
+          {
+            BenchmarkState( i, tick, width, height, state );
+            benchWorld.states.push_back( state );
+          }
+          benchWorld.states.sort();
+
+          u32 start = getMicroTime();
+          if ( relevant )
+          {
+            benchRelevancy.Build( benchWorld, relevancyRadius );
+          }
+          for ( int c = 0; c < clientsNum; c++ )
+          {
+            SSnapshot& snapshot = sent[c * 2 + snapshots % 2];
+            const SSnapshot* baseline = ( snapshots > 1 ) ? &sent[c * 2 + ( snapshots + 1 ) % 2] : NULL;
+
+            if ( relevant )
+            {
+              // each client flies one of the planes
+              BenchmarkState( c % entitiesNum, tick, width, height, state );
+              SRelevancyView view;
+              view.bViewer = true;
+              view.vPos = vector3df( state.pos[0], state.pos[1], state.pos[2] ) / SNAPSHOT_POS_SCALE;
+              view.team = state.team;
+              benchRelevancy.Select( view, baseline, priorities[c], budget, snapshot );
+            }
+            else
+            {
+              snapshot.states = benchWorld.states;
+            }
+
+            RakNet::BitStream bs;
+            bs.Write( ( unsigned char )ID_CRIMSON_SNAPSHOT );
+            bs.Write( snapshots );
+            bs.Write( baseline ? snapshots - 1 : ( u32 )0 );
+            bs.Write( ( u32 )0 );
+            WriteDelta( bs, snapshot, baseline );
+            bytes += bs.GetNumberOfBytesUsed();
+          }
+          time += getMicroTime() - start;
+        }
+
+        APPLOG.Write( "Relevancy benchmark: %3i clients, relevancy %s - %8.1f us per snapshot, %7.2f kbps per client, %8.1f kB/s out, %u updates deferred", clientsNum, relevant ? "on " : "off", snapshots ? ( f32 )time / snapshots : 0.0f, bytes * 8 / ( clientsNum * seconds ) / 1000.0f, bytes / seconds / 1024.0f, benchRelevancy.deferred );
+
+        delete[] priorities;
+        delete[] sent;
+      }
+    }
+
+    CONSOLE.add( "Relevancy benchmark written to the application log." );
+}
@@ -0,0 +1,149 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include "network.h"
+#include "BitStream.h"
+
+class CActor;
+
+#define SNAPSHOTS CSnapshots::Instance()
+
+// snapshots kept on both ends, a client that acked an older one gets a full snapshot
+#define SNAPSHOT_HISTORY 32
+#define SNAPSHOT_CHANNEL 1
+
+// fixed point steps per unit
+#define SNAPSHOT_POS_SCALE 512.0f
+#define SNAPSHOT_VEL_SCALE 256.0f
+
+// fields that changed since the baseline
+enum { SNAPSHOT_POS = 1, SNAPSHOT_ROT = 2, SNAPSHOT_VEL = 4, SNAPSHOT_HEALTH = 8, SNAPSHOT_PARENT = 16 };
+#define SNAPSHOT_FIELDS_BITS 5
+
+// the replicated, quantized state of one actor
+struct SEntityState
+{
+    NetworkID id;
+    s32 pos[3];
+    u16 rot[3];
+    s32 vel[3];
+    s16 health;
+    NetworkID parent;
+    // server side only, not sent
+    s32 team;
+
+    // snapshots are sorted by id
+    bool operator <( const SEntityState& other ) const
+    {
+        return id < other.id;
+    }
+    bool operator ==( const SEntityState& other ) const;
+};
+
+struct SSnapshot
+{
+    SSnapshot()
+    {
+        sequence = 0;
+    }
+
+    // 0 for none
+    u32 sequence;
+    array<SEntityState> states;
+};
+
+// how long an actor has been waiting to be sent to a client
+struct SEntityPriority
+{
+    NetworkID id;
+    f32 priority;
+
+    bool operator <( const SEntityPriority& other ) const
+    {
+        return id < other.id;
+    }
+};
+
+////////////////////////////////////////////
+// CSnapshots
+// - the server takes a snapshot of all actors every sv_snapshotrate ticks,
+//   picks what is relevant to each client within its sv_clientrate and
+//   sends it as the difference from the last snapshot that client
+//   acknowledged, unreliable sequenced
+// - the client rebuilds the snapshot from its own copy of that baseline,
+//   applies it and acknowledges it
+////////////////////////////////////////////
+
+class CSnapshots
+{
+  public:
+    static CSnapshots* Instance()
+    {
+        static CSnapshots inst;
+        return &inst;
+    }
+
+    // server
+    void AddClient( PlayerID playerId );
+    void RemoveClient( PlayerID playerId );
+    void Update();
+    void ReceiveAck( Packet* packet );
+
+    // client
+    void ReceiveSnapshot( Packet* packet );
+
+    void Clear();
+    void PrintStats();
+
+    // runs a server and clientsNum clients that lose lossPercent of the snapshots
+    // and acks in this process, over a made-up world of entitiesNum actors
+    void Loopback( int clientsNum, int entitiesNum, int ticksNum, int lossPercent );
+    // server time and bytes sent with and without relevancy, for 32, 64 and 128 clients
+    void RelevancyBenchmark( int entitiesNum, int ticksNum );
+
+    static void TakeState( CActor* actor, SEntityState& state );
+    static void ZeroState( SEntityState& state );
+    // SNAPSHOT_ fields that differ
+    static u8 ChangedFields( const SEntityState& state, const SEntityState& base );
+    // NULL if the snapshot is NULL or does not hold id
+    static const SEntityState* FindState( const SSnapshot* snapshot, const NetworkID& id );
+    // baseline NULL writes a full snapshot
+    static void WriteDelta( RakNet::BitStream& bs, const SSnapshot& snapshot, const SSnapshot* baseline );
+    static bool ReadDelta( RakNet::BitStream& bs, const SSnapshot* baseline, SSnapshot& snapshot );
+
+    int snapshotRate;
+    int relevancyEnabled;
+    f32 relevancyRadius;
+    // bytes per second, 0 for no limit
+    int clientRate;
+
+  private:
+    CSnapshots();
+
+    struct SClient
+    {
+        PlayerID playerId;
+        u32 ackedSequence;
+        // what this client was sent, SNAPSHOT_HISTORY of them
+        SSnapshot* sent;
+        array<SEntityPriority> priorities;
+        u32 bytesSent, bytesThisSecond, bytesPerSecond;
+        u32 fullSnapshots, deltaSnapshots;
+    };
+
+    void TakeSnapshot( SSnapshot& snapshot );
+    // the actor the client predicts is reconciled with inputAck instead
+    void Apply( const SSnapshot& snapshot, u32 inputAck );
+
+    // server
+    SSnapshot world;
+    u32 sequence;
+    array<SClient> clients;
+    int ticks;
+
+    // client
+    SSnapshot received[SNAPSHOT_HISTORY];
+    u32 lastReceived;
+};
+
+#endif
@@ -10,13 +10,15 @@
 // CActor 
 ////////////////////////////////////////////
 
-array<CActor*> CActor::actorsList;
+CSlotMap<CActor*> CActor::actorsList;
 
 CActor::CActor()
 {
     Reset();
 
-    actorsList.push_back( this );
+    config = NULL;
+
+    actorHandle = actorsList.Add( this );
 }
 
 CActor::CActor( const c8* scriptFilename )
@@ -26,8 +28,9 @@ CActor::CActor( const c8* scriptFilename )
     setDebugText( scriptFilename );
 
     configFilename = scriptFilename;
+    config = NULL;
 
-    actorsList.push_back( this );
+    actorHandle = actorsList.Add( this );
 }
 
 
@@ -42,9 +45,7 @@ CActor::CActor( const c8* scriptFilename )
 
 CActor::~CActor()
 {
-    //printf( "a 1 size %i\n", actorsList.size() );
-    actorsList.erase( actorsList.binary_search( ( CActor * )this ) );
-    //printf( "a 2 size %i\n", actorsList.size() );
+    actorsList.Remove( actorHandle );
 }
 
 void CActor::Render()
@@ -52,6 +53,29 @@ void CActor::Render()
     CControllable::Render();
 }
 
+void CActor::LoadConfig( const c8* filename )
+{
+    // no script to key on, the values are whatever the globals hold now
+    if ( filename[0] == 0 )
+    {
+      Load( filename );
+      Unserialize( loadedBitStream );
+      return;
+    }
+
+    config = CONFIGS->Find( filename );
+    if ( !config )
+    {
+      Load( filename );
+      config = CONFIGS->Add( filename, loadedBitStream );
+      loadedBitStream.Reset();
+    }
+
+    // read the cached values in place
+    RakNet::BitStream bt( ( unsigned char * )config->data.const_pointer(), config->data.size(), false );
+    Unserialize( bt );
+}
+
 void CActor::Reset()
 {
     CControllable::Reset();
@@ -80,7 +104,9 @@ void CActor::Think()
 
     // update the debug position
     //if (APP.DebugMode)
+#ifdef _CLIENT
     setDebugPos( IRR.smgr->getSceneCollisionManager()->getScreenCoordinatesFrom3DPosition( getPosition(), IRR.smgr->getActiveCamera() ) );
+#endif
 
     ////    //HACK: should be after if (bZombie), here because of network disconnect crash
 
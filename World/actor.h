@@ -13,6 +13,7 @@
 #include "../IrrConsole/console_vars.h"
 
 #include "../RakNet/BitStream.h"
+#include "configcache.h"
 
 
 class CScreenText;
@@ -75,16 +76,28 @@ class CActor : public CControllable, public CNewtonNode
 
     virtual void Serialize( RakNet::BitStream& bt )
     {
-        bt.Write( &loadedBitStream );
+        if ( config )
+        {
+          bt.WriteBits( config->data.const_pointer(), config->bits, false );
+        }
     }
     virtual void Unserialize( RakNet::BitStream& bt )
     {
     }
+    // NULL if the actor has no config
+    const SActorConfig* getConfig()
+    {
+        return config;
+    }
 
     int getHealth()
     {
         return fHealth;
     }
+    void setHealth( f32 health )
+    {
+        fHealth = health;
+    }
 
     virtual void setRespawnable( bool respawn )
     {
@@ -97,7 +110,7 @@ class CActor : public CControllable, public CNewtonNode
 
     // STATIC
     static CActor* getActorWithPlayerID( PlayerID pid );
-    static array<CActor*> actorsList;
+    static CSlotMap<CActor*> actorsList;
 
     // is network broadcasted!
     static CActor* CreateActor( const c8* classname, const c8* scriptname, int control, int camerafollow, vector3df vPos, const c8* debugname );
@@ -108,6 +121,9 @@ class CActor : public CControllable, public CNewtonNode
     {
     }
 
+    // runs Load() the first time a config is used, then Unserialize() with its values
+    void LoadConfig( const c8* filename );
+
     virtual bool onChildAttached( CNewtonNode* what, void* data );
     virtual void onChildUnAttached( CNewtonNode* what );
 
@@ -128,6 +144,7 @@ class CActor : public CControllable, public CNewtonNode
     String factoryName;
     int factoryIndex;
     RakNet::BitStream loadedBitStream;
+    const SActorConfig* config;
 
     int team;
     PlayerID ownerPlayerID;
@@ -137,6 +154,9 @@ class CActor : public CControllable, public CNewtonNode
 
     //will this actor respawn after death?
     bool bRespawn;
+
+  private:
+    SSlotHandle actorHandle;
 };
 
 // CONFIG LOADING MACROS
@@ -1,6 +1,7 @@
 #include "bot.h"
 #include "world.h"
 #include "rules.h"
+#include "demo.h"
 
 CBot::CBot() : CEntity()
 {
@@ -12,6 +13,7 @@ CBot::CBot() : CEntity()
     player = WORLD.GetPlayers()->AddPlayer( playerId );
     WORLD.GetRules()->OnNewPlayerJoin( player );
     player->getControls()->MapKeys( false );
+    player->bBot = true;
 }
 
 CBot::~CBot()
@@ -28,6 +30,13 @@ void CBot::Reset()
 
 void CBot::Think()
 {
+    // played back, the keys are the ones it chose when recorded
+    if ( DEMO->isPlaying() )
+    {
+      DEMO->ApplyControls( player );
+      return;
+    }
+
     targetDistance = getTargetDistance();
 
     if ( myActor )
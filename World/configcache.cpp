@@ -0,0 +1,54 @@
+#include "configcache.h"
+
+////////////////////////////////////////////
+// CConfigCache
+////////////////////////////////////////////
+
+CConfigCache::CConfigCache()
+{
+    hits = misses = 0;
+}
+
+CConfigCache::~CConfigCache()
+{
+    Clear();
+}
+
+const SActorConfig* CConfigCache::Find( const c8* filename )
+{
+    for ( u32 i = 0; i < configs.size(); i++ )
+    {
+      if ( configs[i]->filename == filename )
+      {
+        hits++;
+        return configs[i];
+      }
+    }
+
+    misses++;
+    return NULL;
+}
+
+const SActorConfig* CConfigCache::Add( const c8* filename, RakNet::BitStream& bt )
+{
+    SActorConfig* config = new SActorConfig;
+    config->filename = filename;
+    config->bits = bt.GetNumberOfBitsUsed();
+    config->data.set_used( bt.GetNumberOfBytesUsed() );
+    if ( config->data.size() )
+    {
+      memcpy( config->data.pointer(), bt.GetData(), config->data.size() );
+    }
+
+    configs.push_back( config );
+    return config;
+}
+
+void CConfigCache::Clear()
+{
+    for ( u32 i = 0; i < configs.size(); i++ )
+    {
+      delete configs[i];
+    }
+    configs.clear();
+}
@@ -0,0 +1,54 @@
+#ifndef CONFIGCACHE_H_INCLUDED
+#define CONFIGCACHE_H_INCLUDED
+
+#include "../Engine/engine.h"
+#include "../RakNet/BitStream.h"
+
+#define CONFIGS CConfigCache::Instance()
+
+////////////////////////////////////////////
+// SActorConfig
+// - the values an actor config script produced, in the order the actor's
+//   Load() wrote them, never changed once cached
+////////////////////////////////////////////
+
+struct SActorConfig
+{
+    String filename;
+    array<unsigned char> data;
+    int bits;
+};
+
+////////////////////////////////////////////
+// CConfigCache
+// - actor config scripts are run once per world, every later spawn of the
+//   same config reads the cached values
+////////////////////////////////////////////
+
+class CConfigCache
+{
+  public:
+    static CConfigCache* Instance()
+    {
+        static CConfigCache inst;
+        return &inst;
+    }
+
+    ~CConfigCache();
+
+    // NULL if the config was not loaded yet
+    const SActorConfig* Find( const c8* filename );
+    // takes a copy of what Load() wrote to bt
+    const SActorConfig* Add( const c8* filename, RakNet::BitStream& bt );
+    // configs are read again on the next spawn, actors must not hold on to them
+    void Clear();
+
+    int hits, misses;
+
+  private:
+    CConfigCache();
+
+    array<SActorConfig*> configs;
+};
+
+#endif
@@ -12,6 +12,8 @@ static bool keys_loaded = false;
 CControls::CControls()
 {
     ClearKeys();
+    // remote players' controls are set through the action keys
+    MapKeys( false );
 
     menu = NULL;
 }
@@ -95,6 +97,27 @@ void CControls::SetActionKey( s32 ak, bool pressed )
     }
 }
 
+u16 CControls::GetActionKeys()
+{
+    u16 bits = 0;
+    for ( s32 ak = 0; ak < AK_NUM; ak++ )
+    {
+      if ( ActionKeyPressed( ak ) )
+      {
+        bits |= 1 << ak;
+      }
+    }
+    return bits;
+}
+
+void CControls::SetActionKeys( u16 bits )
+{
+    for ( s32 ak = 0; ak < AK_NUM; ak++ )
+    {
+      SetActionKey( ak, ( bits & ( 1 << ak ) ) != 0 );
+    }
+}
+
 bool CControls::KeyPressed( s32 keycode )
 {
     if ( ( keycode > -1 ) && ( keycode < irr::KEY_KEY_CODES_COUNT ) )
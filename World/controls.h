@@ -26,6 +26,10 @@ class CControls
     void MapActionKey( s32 ak, s32 keycode );
     void SetActionKey( s32 ak, bool pressed );
 
+    // action keys as bits, 1 << AK_
+    u16 GetActionKeys();
+    void SetActionKeys( u16 bits );
+
     bool KeyPressed( s32 keycode );
     void SetKey( s32 keycode, bool pressed );
     bool NoKeysPressed();
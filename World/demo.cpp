@@ -0,0 +1,338 @@
+#include "demo.h"
+
+#include "../App/app.h"
+#include "../Engine/misc.h"
+#include "../Game/SingletonIncludes.h"
+#include "../Newton/newton_physics.h"
+
+#include "world.h"
+#include "player.h"
+#include "controls.h"
+
+static void CopyName( c8* dest, const c8* name )
+{
+    strncpy( dest, name, DEMO_NAME_LENGTH - 1 );
+    dest[DEMO_NAME_LENGTH - 1] = 0;
+}
+
+////////////////////////////////////////////
+// CDemo
+////////////////////////////////////////////
+
+CDemo::CDemo()
+{
+    pFile = NULL;
+    maxTicks = 0;
+    readPos = 0;
+    bPlaying = bBenchmark = false;
+    tick = 0;
+    startTime = 0;
+}
+
+bool CDemo::StartWorld( const c8* worldScript, u32 seed )
+{
+    // bots pick their ids and the respawns their points with rand()
+    srand( seed );
+    KERNEL.SetLockstep( true, bBenchmark );
+
+    if ( !SCRIPT.RunFile( worldScript ) || !GAME.worldLoaded )
+    {
+      APPLOG.Write( "Demo: '%s' did not start a world", worldScript );
+      KERNEL.SetLockstep( false, false );
+      return false;
+    }
+
+    controls.clear();
+    tick = 0;
+    return true;
+}
+
+bool CDemo::Record( const c8* filename, const c8* worldScript, u32 ticks )
+{
+    Stop();
+
+    memset( &header, 0, sizeof( header ) );
+    header.magic = DEMO_MAGIC;
+    header.version = DEMO_VERSION;
+    header.seed = ( u32 )time( 0 );
+    header.goalTicks = GAME.goalTicks;
+    CopyName( header.worldScript, worldScript );
+    CopyName( header.rulesScript, STARTRULES );
+    // a script that changed since the recording plays out differently
+    header.worldHash = HashFile( header.worldScript );
+    header.rulesHash = HashFile( header.rulesScript );
+
+    bBenchmark = false;
+    if ( !StartWorld( worldScript, header.seed ) )
+    {
+      return false;
+    }
+    header.physicsRate = WORLD.GetPhysics()->stepRate;
+    header.physicsTimeStep = WORLD.GetPhysics()->timeStep;
+
+    pFile = fopen( filename, "wb" );
+    if ( !pFile )
+    {
+      APPLOG.Write( "Demo: could not write '%s'", filename );
+      KERNEL.SetLockstep( false, false );
+      return false;
+    }
+    // the ticks are filled in when it stops
+    fwrite( &header, sizeof( header ), 1, pFile );
+    maxTicks = ticks;
+
+    CONSOLE.addx( "Recording demo '%s'", filename );
+    return true;
+}
+
+bool CDemo::Play( const c8* filename, bool benchmark )
+{
+    Stop();
+
+    FILE* f = fopen( filename, "rb" );
+    if ( !f )
+    {
+      APPLOG.Write( "Demo: could not read '%s'", filename );
+      return false;
+    }
+    fseek( f, 0, SEEK_END );
+    u32 size = ( u32 )ftell( f );
+    fseek( f, 0, SEEK_SET );
+    data.set_used( size );
+    if ( !size || ( fread( data.pointer(), 1, size, f ) != size ) )
+    {
+      size = 0;
+    }
+    fclose( f );
+
+    if ( size < sizeof( header ) )
+    {
+      APPLOG.Write( "Demo: '%s' is too short", filename );
+      data.clear();
+      return false;
+    }
+    memcpy( &header, data.pointer(), sizeof( header ) );
+    if ( ( header.magic != DEMO_MAGIC ) || ( header.version != DEMO_VERSION ) )
+    {
+      APPLOG.Write( "Demo: '%s' is not a version %i demo", filename, DEMO_VERSION );
+      data.clear();
+      return false;
+    }
+    header.worldScript[DEMO_NAME_LENGTH - 1] = header.rulesScript[DEMO_NAME_LENGTH - 1] = 0;
+
+    // it may still play out the same, but likely not
+    if ( HashFile( header.worldScript ) != header.worldHash )
+    {
+      APPLOG.Write( "Demo: '%s' changed since the recording", header.worldScript );
+    }
+    if ( HashFile( header.rulesScript ) != header.rulesHash )
+    {
+      APPLOG.Write( "Demo: '%s' changed since the recording", header.rulesScript );
+    }
+
+    GAME.goalTicks = header.goalTicks;
+    KERNEL.SetGoalTicks( header.goalTicks );
+
+    bBenchmark = benchmark;
+    if ( !StartWorld( header.worldScript, header.seed ) )
+    {
+      data.clear();
+      return false;
+    }
+    WORLD.GetPhysics()->stepRate = header.physicsRate;
+    WORLD.GetPhysics()->timeStep = header.physicsTimeStep;
+
+    readPos = sizeof( header );
+    bPlaying = true;
+
+    APPLOG.Write( "Demo: playing '%s', %u ticks at %i a second%s", filename, header.ticks, header.goalTicks, bBenchmark ? " as fast as possible" : "" );
+    if ( bBenchmark )
+    {
+      KERNEL.TimeTasks( true );
+    }
+    startTime = getPreciseTime();
+    return true;
+}
+
+void CDemo::Stop()
+{
+    if ( pFile )
+    {
+      header.ticks = tick;
+      fseek( pFile, 0, SEEK_SET );
+      fwrite( &header, sizeof( header ), 1, pFile );
+      fclose( pFile );
+      pFile = NULL;
+
+      KERNEL.SetLockstep( false, false );
+      CONSOLE.addx( "Recorded %u ticks", tick );
+    }
+
+    if ( bPlaying )
+    {
+      EndPlayback( false );
+    }
+}
+
+void CDemo::EndPlayback( bool bFinished )
+{
+    u32 time = max( getPreciseTime() - startTime, ( u32 )1 );
+    bPlaying = false;
+    data.clear();
+    KERNEL.SetLockstep( false, false );
+
+    APPLOG.Write( "Demo: %s after %u of %u ticks, %u ms, %.1f ticks a second", bFinished ? "finished" : "stopped", tick, header.ticks, time, tick * 1000.0f / time );
+    CONSOLE.addx( "Demo %s after %u ticks, %.1f ticks a second", bFinished ? "finished" : "stopped", tick, tick * 1000.0f / time );
+
+    if ( bBenchmark )
+    {
+      KERNEL.LogTaskTimes( tick );
+      KERNEL.TimeTasks( false );
+      APP.Shutdown();
+    }
+}
+
+bool CDemo::ReadTick()
+{
+    if ( readPos >= data.size() )
+    {
+      return false;
+    }
+    u32 num = data[readPos++];
+
+    SDemoControls blank;
+    blank.keys = 0;
+    blank.vMouse = vector3df( 0.0f, 0.0f, 0.0f );
+    while ( controls.size() < num )
+    {
+      controls.push_back( blank );
+    }
+    controls.set_used( num );
+
+    for ( u32 i = 0; i < num; i++ )
+    {
+      if ( readPos + sizeof( u16 ) > data.size() )
+      {
+        return false;
+      }
+      u16 keys;
+      memcpy( &keys, &data[readPos], sizeof( u16 ) );
+      readPos += sizeof( u16 );
+
+      if ( keys & DEMO_MOUSE_BIT )
+      {
+        if ( readPos + sizeof( vector3df ) > data.size() )
+        {
+          return false;
+        }
+        memcpy( &controls[i].vMouse.X, &data[readPos], sizeof( vector3df ) );
+        readPos += sizeof( vector3df );
+      }
+      controls[i].keys = keys & ~DEMO_MOUSE_BIT;
+    }
+    return true;
+}
+
+void CDemo::BeginTick()
+{
+    if ( !bPlaying )
+    {
+      return;
+    }
+
+    if ( tick >= header.ticks )
+    {
+      EndPlayback( true );
+      return;
+    }
+    if ( !ReadTick() )
+    {
+      APPLOG.Write( "Demo: the file ends at tick %u", tick );
+      EndPlayback( false );
+      return;
+    }
+
+    // bots set theirs when they think
+    CPlayerManager* players = WORLD.GetPlayers();
+    for ( s32 i = 0; i < players->GetPlayersNum(); i++ )
+    {
+      CPlayer* player = players->GetPlayerByIndex( i );
+      if ( !player->bBot )
+      {
+        ApplyControls( player );
+      }
+    }
+}
+
+void CDemo::ApplyControls( CPlayer* player )
+{
+    s32 i = WORLD.GetPlayers()->GetPlayerIndex( player );
+    if ( ( i < 0 ) || ( i >= ( s32 )controls.size() ) )
+    {
+      return;
+    }
+
+    CControls* c = player->getControls();
+    c->SetActionKeys( controls[i].keys );
+    c->mousePosWorld = controls[i].vMouse;
+}
+
+void CDemo::EndTick()
+{
+    CPlayerManager* players = WORLD.GetPlayers();
+    s32 num = players->GetPlayersNum();
+
+    if ( bPlaying )
+    {
+      // players join and leave in the tick, the recording has the count after it
+      if ( num != ( s32 )controls.size() )
+      {
+        APPLOG.Write( "Demo: out of sync at tick %u, %u players recorded, %i in the world", tick, controls.size(), num );
+        EndPlayback( false );
+        return;
+      }
+      tick++;
+      return;
+    }
+
+    if ( !pFile )
+    {
+      return;
+    }
+
+    num = min( num, 255 );
+    u8 count = ( u8 )num;
+    fwrite( &count, 1, 1, pFile );
+
+    SDemoControls blank;
+    blank.keys = 0;
+    blank.vMouse = vector3df( 0.0f, 0.0f, 0.0f );
+    while ( ( s32 )controls.size() < num )
+    {
+      controls.push_back( blank );
+    }
+    controls.set_used( num );
+
+    // the aim is only written when it moved
+    for ( s32 i = 0; i < num; i++ )
+    {
+      CControls* c = players->GetPlayerByIndex( i )->getControls();
+      u16 keys = c->GetActionKeys();
+      bool bMouse = ( c->mousePosWorld != controls[i].vMouse );
+      u16 written = bMouse ? ( keys | DEMO_MOUSE_BIT ) : keys;
+
+      fwrite( &written, sizeof( u16 ), 1, pFile );
+      if ( bMouse )
+      {
+        fwrite( &c->mousePosWorld.X, sizeof( vector3df ), 1, pFile );
+      }
+      controls[i].keys = keys;
+      controls[i].vMouse = c->mousePosWorld;
+    }
+
+    tick++;
+    if ( maxTicks && ( tick >= maxTicks ) )
+    {
+      Stop();
+    }
+}
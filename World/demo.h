@@ -0,0 +1,99 @@
+#ifndef DEMO_H_INCLUDED
+#define DEMO_H_INCLUDED
+
+#include "../Engine/engine.h"
+
+#define DEMO CDemo::Instance()
+
+#define DEMO_MAGIC 0x4d454443 // 'CDEM'
+#define DEMO_VERSION 1
+#define DEMO_NAME_LENGTH 64
+// in a player's keys, the mouse position follows
+#define DEMO_MOUSE_BIT 0x8000
+
+class CPlayer;
+
+struct DemoHeader
+{
+    u32 magic;
+    u32 version;
+    u32 seed;
+    u32 ticks;
+    s32 goalTicks;
+    s32 physicsRate;
+    f32 physicsTimeStep;
+    u32 worldHash, rulesHash;
+    c8 worldScript[DEMO_NAME_LENGTH];
+    c8 rulesScript[DEMO_NAME_LENGTH];
+};
+
+////////////////////////////////////////////
+// CDemo
+// - a demo is the world script, the rand() seed and every player's action
+//   keys and aim each tick, the players in the order they joined
+// - the kernel runs in lockstep while recording and playing, a tick always
+//   moves the same time so the same input plays out the same
+// - a player count that differs from the recording (players added from
+//   the console, clients) stops the playback as out of sync
+// - a benchmark plays as fast as it can, logs the ticks per second and the
+//   task times and quits, headless on the dedicated server or v_driver 0
+////////////////////////////////////////////
+
+class CDemo
+{
+  public:
+    static CDemo* Instance()
+    {
+        static CDemo inst;
+        return &inst;
+    }
+
+    // ticks 0 records until demoStop or the world stops
+    bool Record( const c8* filename, const c8* worldScript, u32 ticks );
+    bool Play( const c8* filename, bool benchmark );
+    void Stop();
+
+    bool isRecording()
+    {
+        return pFile != NULL;
+    }
+    bool isPlaying()
+    {
+        return bPlaying;
+    }
+
+    // world, before anything thinks and after everything moved
+    void BeginTick();
+    void EndTick();
+    // a bot sets its recorded keys where it would set its own
+    void ApplyControls( CPlayer* player );
+
+  private:
+    CDemo();
+
+    struct SDemoControls
+    {
+        u16 keys;
+        vector3df vMouse;
+    };
+
+    bool StartWorld( const c8* worldScript, u32 seed );
+    bool ReadTick();
+    void EndPlayback( bool bFinished );
+
+    DemoHeader header;
+    // last written while recording, this tick's while playing
+    array<SDemoControls> controls;
+
+    FILE* pFile;
+    u32 maxTicks;
+
+    array<u8> data;
+    u32 readPos;
+    bool bPlaying, bBenchmark;
+
+    u32 tick;
+    u32 startTime;
+};
+
+#endif
@@ -190,8 +190,9 @@ void CEditor::DeleteActorAtCursor( f32 pickradius )
       return;
     }
 
-    int i = actorPick;
-    CNewtonNode* childnode = CActor::actorsList[i]->DropChild();
+    // removing the weapons reorders actorsList
+    CActor* picked = CActor::actorsList[actorPick];
+    CNewtonNode* childnode = picked->DropChild();
     while ( childnode )
     {
       if ( childnode->getType() == NODECLASS_WEAPON )
@@ -199,10 +200,10 @@ void CEditor::DeleteActorAtCursor( f32 pickradius )
         CActor* actor = static_cast<CActor*>( childnode );
         WORLD.RemoveEntity( actor );
       }
-      childnode = CActor::actorsList[i]->DropChild();
+      childnode = picked->DropChild();
     }
 
-    WORLD.RemoveEntity( CActor::actorsList[i] );
+    WORLD.RemoveEntity( picked );
     actorPick = -1;
 }
 
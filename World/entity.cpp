@@ -13,7 +13,7 @@ CEntity::CEntity()
 {
     Reset();
 
-    WORLD.AddEntity( this );
+    entityHandle = WORLD.AddEntity( this );
 }
 
 CEntity::~CEntity()
@@ -61,3 +61,13 @@ void CEntity::Die()
 {
     WORLD.RemoveEntity( this );
 }
+
+void CEntity::LeaveWorld()
+{
+    WORLD.DetachEntity( this );
+}
+
+void CEntity::JoinWorld()
+{
+    entityHandle = WORLD.AddEntity( this );
+}
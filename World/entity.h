@@ -43,6 +43,11 @@ class CEntity// : public CRenderable
     {
         return ( !bInvalidEntity && !bCanDie );
     }
+    // stays valid for WORLD.GetEntityByHandle() until the entity dies
+    SSlotHandle getHandle()
+    {
+        return entityHandle;
+    }
 
   protected:
     friend class CWorldTask;
@@ -50,12 +55,17 @@ class CEntity// : public CRenderable
     bool bInvalidEntity;
     int alive, timeOut;
 
-    void Die();
+    virtual void Die();
     bool bCanDie;
 
+    // for entities that are recycled instead of deleted
+    void LeaveWorld();
+    void JoinWorld();
+
   private:
     String debugText;
     core::position2d<s32> debugScreenPos;
+    SSlotHandle entityHandle;
 };
 
 
@@ -1,6 +1,5 @@
 #include "item.h"
 
-#include "bullet.h"
 #include "character.h"
 
 ////////////////////////////////////////////
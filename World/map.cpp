@@ -3,6 +3,7 @@
 
 #include "world.h"
 #include "../Newton/newton_physics.h"
+#include "../Newton/collisioncache.h"
 #include "boolblock.h"
 
 #include "../Irrlicht/CSkyBackSceneNode.h"
@@ -25,6 +26,13 @@
 #define OPTIMIZE2D_COLLISION
 #define OPTIMIZE2D_COLLISION_DIF 2.0f
 
+// names the way BuildMeshCollision() builds trees in the collision cache
+#ifdef OPTIMIZE2D_COLLISION
+#define MAP_COLLISION_VARIANT "dmf2d"
+#else
+#define MAP_COLLISION_VARIANT "dmf"
+#endif
+
 ////////////////////////////////////////////
 // CMap_Cloud 
 ////////////////////////////////////////////
@@ -218,7 +226,9 @@ CMap_Zone::CMap_Zone( aabbox3df box, int type )
     vSize.Y = ( edges[0] - edges[1] ).getLength();
     vSize.X = ( edges[5] - edges[1] ).getLength();
 
+    surface.setPlane( edges[0], edges[2], edges[4] );
 
+#ifdef _CLIENT
     // Add some reflective water 
     if ( GAME.bShaderWater )
     {
@@ -243,6 +253,7 @@ CMap_Zone::CMap_Zone( aabbox3df box, int type )
       node->setVisible( true );
       node->setMaterialFlag( EMF_FOG_ENABLE, true );
     }
+#endif
 }
 
 CMap_Zone::~CMap_Zone()
@@ -324,6 +335,7 @@ CMap::CMap()
     worldHeight = WORLD_BOUND;
     worldDepth = WORLD_WIDTH;
     planeSize = PLANE_SIZE;
+    bGridDirty = true;
 
     //  if ( strlen(fileName) < 2 )
     //{
@@ -436,18 +448,6 @@ CMap::CMap()
     //else
     //  Load( "Maps/test.cmp" );
 
-    // init optimization grid
-    //int i;
-    //optCellWidth = OPTCELL_WIDTH;
-    //optCellHeight = OPTCELL_HEIGHT;
-    //optRows = worldHeight / optCellHeight;
-    //optColumns = worldWidth / optCellWidth;
-    //optGrid = new optCell*[ optRows ]; 
-    //for( i = 0; i < optRows; ++i ) 
-    //  optGrid[i] = new optCell[ optColumns ];
-
-    //GenerateOptimizationGrid();
-
     //SOUND.playSound("Sounds/init.wav");
 
     //ISceneNode *billnode = new CBackSpriteSceneNode(IRR.smgr->getRootSceneNode(), IRR.smgr, -1, 
@@ -496,10 +496,6 @@ CMap::~CMap()
 	if ( atmo )
 		delete atmo;
 
-    //for( i = 0; i < optRows; ++i ) 
-    //  for( j = 0; j < optColumns; ++j ) 
-    //      optGrid[i][j].Planes.clear();
-
     if ( respawn )
     {
       delete respawn;
@@ -509,10 +505,6 @@ CMap::~CMap()
     {
       delete editor;
     }
-
-    //for( i = 0; i < optRows; ++i ) 
-    //  delete[] optGrid[i];
-    //delete[] optGrid;
 }
 
 void CMap::Add2DPlane( vector3df p1, vector3df p2 )
@@ -548,18 +540,15 @@ void CMap::Render()
       m.BackfaceCulling = false;
       IRR.video->setMaterial( m );
 
-      // draw optGrid
+      // draw the optimization grids
       if ( APP.DebugMode > 1 )
       {
-        for ( i = 0; i < optRows; i++ )
+        if ( bGridDirty )
         {
-          for ( j = 0; j < optColumns; j++ )
-          {
-            IRR.video->draw3DLine( getOptGridRealPos( i, j ), getOptGridRealPos( i + 1, j ), SColor( 0, 255, 0, 150 ) );
-            IRR.video->draw3DLine( getOptGridRealPos( i, j ), getOptGridRealPos( i, j + 1 ), SColor( 0, 255, 0, 150 ) );
-            IRR.video->draw3DLine( getOptGridRealPos( i + 1, j ), getOptGridRealPos( i + 1, j + 1 ), SColor( 0, 255, 0, 150 ) );
-          }
+          GenerateOptimizationGrid();
         }
+        zoneGrid.Render( SColor( 0, 0, 150, 255 ) );
+        planeGrid.Render( SColor( 0, 255, 0, 150 ) );
       }
 
 
@@ -607,7 +596,28 @@ void CMap::Render()
 
 void CMap::Load( const c8* filename )
 {
-    s32 i, j;
+    if ( CMapFile::IsMapFile( filename ) )
+    {
+      if ( !LoadBinary( filename ) )
+      {
+        CONSOLE.addx( COLOR_ERROR, "Could not load binary map '%s'", filename );
+        return;
+      }
+    }
+    else
+    {
+      LoadLegacy( filename );
+    }
+
+    if ( APP.DebugMode )
+    {
+      CONSOLE.addx( "Map loaded from '%s'", filename );
+    }
+}
+
+void CMap::LoadLegacy( const c8* filename )
+{
+    s32 i;
     MapHeader mh;
     MapPlane mp;
 
@@ -642,42 +652,238 @@ void CMap::Load( const c8* filename )
     }
 
     fclose( pFile );
+}
 
-    if ( APP.DebugMode )
+// reads a serialized Newton tree straight out of the mapped file
+struct SMapCollisionReader
+{
+    const u8* p;
+};
+
+static void MapCollisionRead( void* serializeHandle, void* buffer, size_t size )
+{
+    SMapCollisionReader* reader = ( SMapCollisionReader* )serializeHandle;
+    memcpy( buffer, reader->p, size );
+    reader->p += size;
+}
+
+static void MapCollisionWrite( void* serializeHandle, const void* buffer, size_t size )
+{
+    array<u8>* out = ( array<u8>* )serializeHandle;
+    for ( size_t i = 0; i < size; i++ )
     {
-      CONSOLE.addx( "Map loaded from '%s'", filename );
+      out->push_back( ( ( const u8 * )buffer )[i] );
     }
 }
 
-void CMap::Save( const c8* filename )
+bool CMap::LoadBinary( const c8* filename )
 {
-    s32 i, j;
-    MapHeader mh;
-    MapPlane mp;
+    u32 i, count, size;
+
+    // the grids may point into the file being replaced
+    bGridDirty = true;
+    if ( !binary.Open( filename ) )
+    {
+      return false;
+    }
+
+    const MapFileEnvironment* env = ( const MapFileEnvironment* )binary.GetSection( MAPSECTION_ENVIRONMENT, MAPSECTION_ENVIRONMENT_VERSION, &size );
+    if ( env && ( size >= sizeof( MapFileEnvironment ) ) )
+    {
+      worldWidth = env->worldWidth;
+      worldHeight = env->worldHeight;
+      worldDepth = env->worldDepth;
+      planeSize = env->planeSize;
+      if ( env->skyfile[0] )
+      {
+        c8 sky[sizeof( env->skyfile ) + 1];
+        memcpy( sky, env->skyfile, sizeof( env->skyfile ) );
+        sky[sizeof( env->skyfile )] = 0;
+        NewSky( sky, -1, -1 );
+      }
+    }
+
+    const MapFilePlane* planes = binary.GetRecords<MapFilePlane>( MAPSECTION_PLANES, MAPSECTION_PLANES_VERSION, count );
+    for ( i = 0; i < count; i++ )
+    {
+      AddPlane( new CMap_Plane( planes[i].triangle[0].pointC, planes[i].triangle[0].pointB, planes[i].triangle[0].pointA, planes[i].triangle[1].pointA, planes[i].size ) );
+    }
 
-    FILE* pFile = fopen( filename, "wb" );
+    const MapFileBox* zones = binary.GetRecords<MapFileBox>( MAPSECTION_ZONES, MAPSECTION_ZONES_VERSION, count );
+    for ( i = 0; i < count; i++ )
+    {
+      AddZone( zones[i].box, zones[i].type );
+    }
 
-    mh.version = MAPFILE_VERSION;
-    mh.planesNum = Planes.size();
-    mh.worldWidth = worldWidth;
-    mh.worldHeight = worldHeight;
-    mh.worldDepth = worldDepth;
+    const MapFileBox* clouds = binary.GetRecords<MapFileBox>( MAPSECTION_CLOUDS, MAPSECTION_CLOUDS_VERSION, count );
+    for ( i = 0; i < count; i++ )
+    {
+      addCloud( new CMap_Cloud( clouds[i].box, clouds[i].type ) );
+    }
 
-    memset( mh.skyfile, 0, 255 );
-    memcpy( mh.skyfile, skyFilename.c_str(), skyFilename.size() );
+    const MapFileRespawn* points = binary.GetRecords<MapFileRespawn>( MAPSECTION_RESPAWNS, MAPSECTION_RESPAWNS_VERSION, count );
+    for ( i = 0; i < count; i++ )
+    {
+      respawn->AddPoint( points[i].vPos, points[i].actorName, points[i].team, points[i].direction, points[i].parentActorName, points[i].parentActorScriptName );
+    }
 
-    fwrite( &mh, sizeof( MapHeader ), 1, pFile );
+    // meshes take their collision from the file, a tree that is missing is rebuilt
+    u32 collisionSize = 0;
+    const u8* collision = binary.GetSection( MAPSECTION_COLLISION, MAPSECTION_COLLISION_VERSION, &collisionSize );
+    const u8* collisionEnd = collision + collisionSize;
 
-    for ( i = 0; i < mh.planesNum; i++ )
+    const MapFileMesh* meshes = binary.GetRecords<MapFileMesh>( MAPSECTION_MESHES, MAPSECTION_MESHES_VERSION, count );
+    for ( i = 0; i < count; i++ )
     {
-      mp.size = Planes[i]->GetSize();
+      c8 meshFile[sizeof( meshes[i].filename ) + 1];
+      memcpy( meshFile, meshes[i].filename, sizeof( meshes[i].filename ) );
+      meshFile[sizeof( meshes[i].filename )] = 0;
+
+      // step past this mesh's tree first, a mesh that fails to load still has one
+      const u8* treeData = NULL;
+      u32 treeSize = 0;
+      if ( collision && ( collision + sizeof( u32 ) <= collisionEnd ) )
+      {
+        treeSize = *( const u32 * )collision;
+        treeData = collision + sizeof( u32 );
+        collision += sizeof( u32 ) + ( ( treeSize + 3 ) & ~3 );
+      }
+
+      IAnimatedMesh* mesh = AddMeshNode( meshFile, meshes[i].vPos, meshes[i].vScale );
+      if ( !mesh )
+      {
+        continue;
+      }
+
+      SMapMesh m;
+      m.filename = meshFile;
+      m.vPos = meshes[i].vPos;
+      m.vScale = meshes[i].vScale;
+
+      NewtonCollision* tree = NULL;
+      if ( treeData && ( treeData + treeSize <= collisionEnd ) )
+      {
+        SMapCollisionReader reader;
+        reader.p = treeData;
+        tree = NewtonCreateTreeCollisionFromSerialization( WORLD.GetPhysics()->nWorld, NULL, MapCollisionRead, &reader );
+      }
+      if ( !tree )
+      {
+        tree = BuildMeshCollision( meshFile, mesh, m.vPos, m.vScale );
+      }
+
+      AddMeshBody( tree, m );
+    }
+
+    // the grids are used in place when they were saved for these zones and planes
+    const MapFileGrid* grid = ( const MapFileGrid* )binary.GetSection( MAPSECTION_ZONEGRID, MAPSECTION_GRID_VERSION, &size );
+    bool bZones = zoneGrid.Attach( grid, size ) && ( zoneGrid.getItemsNum() == ( s32 )Zones.size() );
+    grid = ( const MapFileGrid* )binary.GetSection( MAPSECTION_PLANEGRID, MAPSECTION_GRID_VERSION, &size );
+    bool bPlanes = planeGrid.Attach( grid, size ) && ( planeGrid.getItemsNum() == ( s32 )Planes.size() );
+    bGridDirty = !( bZones && bPlanes );
+
+    return true;
+}
+
+void CMap::Save( const c8* filename )
+{
+    u32 i;
+    CMapFileWriter writer;
+
+    if ( bGridDirty )
+    {
+      GenerateOptimizationGrid();
+    }
+
+    MapFileEnvironment env;
+    memset( &env, 0, sizeof( MapFileEnvironment ) );
+    env.worldWidth = worldWidth;
+    env.worldHeight = worldHeight;
+    env.worldDepth = worldDepth;
+    env.planeSize = planeSize;
+    strncpy( env.skyfile, skyFilename.c_str(), sizeof( env.skyfile ) - 1 );
+    writer.BeginSection( MAPSECTION_ENVIRONMENT, MAPSECTION_ENVIRONMENT_VERSION );
+    writer.Append( &env, sizeof( MapFileEnvironment ) );
+
+    writer.BeginSection( MAPSECTION_PLANES, MAPSECTION_PLANES_VERSION );
+    for ( i = 0; i < Planes.size(); i++ )
+    {
+      MapFilePlane mp;
       mp.triangle[0] = Planes[i]->GetTriangle( 0 );
       mp.triangle[1] = Planes[i]->GetTriangle( 1 );
+      mp.size = Planes[i]->GetSize();
+      writer.Append( &mp, sizeof( MapFilePlane ) );
+    }
 
-      fwrite( &mp, sizeof( MapPlane ), 1, pFile );
+    writer.BeginSection( MAPSECTION_ZONES, MAPSECTION_ZONES_VERSION );
+    for ( i = 0; i < Zones.size(); i++ )
+    {
+      MapFileBox mz;
+      mz.box = *Zones[i]->getBox();
+      mz.type = Zones[i]->getType();
+      writer.Append( &mz, sizeof( MapFileBox ) );
     }
 
-    fclose( pFile );
+    writer.BeginSection( MAPSECTION_CLOUDS, MAPSECTION_CLOUDS_VERSION );
+    for ( i = 0; i < Clouds.size(); i++ )
+    {
+      MapFileBox mc;
+      mc.box = *Clouds[i]->getBox();
+      mc.type = Clouds[i]->getType();
+      writer.Append( &mc, sizeof( MapFileBox ) );
+    }
+
+    writer.BeginSection( MAPSECTION_RESPAWNS, MAPSECTION_RESPAWNS_VERSION );
+    for ( i = 0; i < respawn->points.size(); i++ )
+    {
+      CRespawnPoint* p = respawn->points[i];
+      MapFileRespawn mr;
+      memset( &mr, 0, sizeof( MapFileRespawn ) );
+      mr.vPos = p->vPosition;
+      mr.team = p->team;
+      mr.direction = p->fDirection;
+      strncpy( mr.actorName, p->actorName.c_str(), sizeof( mr.actorName ) - 1 );
+      strncpy( mr.parentActorName, p->parentActorName.c_str(), sizeof( mr.parentActorName ) - 1 );
+      strncpy( mr.parentActorScriptName, p->parentActorScriptName.c_str(), sizeof( mr.parentActorScriptName ) - 1 );
+      writer.Append( &mr, sizeof( MapFileRespawn ) );
+    }
+
+    writer.BeginSection( MAPSECTION_MESHES, MAPSECTION_MESHES_VERSION );
+    for ( i = 0; i < Meshes.size(); i++ )
+    {
+      MapFileMesh mm;
+      memset( &mm, 0, sizeof( MapFileMesh ) );
+      strncpy( mm.filename, Meshes[i].filename.c_str(), sizeof( mm.filename ) - 1 );
+      mm.vPos = Meshes[i].vPos;
+      mm.vScale = Meshes[i].vScale;
+      writer.Append( &mm, sizeof( MapFileMesh ) );
+    }
+
+    writer.BeginSection( MAPSECTION_ZONEGRID, MAPSECTION_GRID_VERSION );
+    zoneGrid.Write( writer );
+    writer.BeginSection( MAPSECTION_PLANEGRID, MAPSECTION_GRID_VERSION );
+    planeGrid.Write( writer );
+
+    writer.BeginSection( MAPSECTION_COLLISION, MAPSECTION_COLLISION_VERSION );
+    array<u8> tree;
+    for ( i = 0; i < Meshes.size(); i++ )
+    {
+      tree.clear();
+      NewtonTreeCollisionSerialize( NewtonBodyGetCollision( Meshes[i].body ), MapCollisionWrite, &tree );
+      while ( tree.size() % 4 )
+      {
+        tree.push_back( 0 );
+      }
+      u32 treeSize = tree.size();
+      writer.Append( &treeSize, sizeof( u32 ) );
+      writer.Append( tree.pointer(), treeSize );
+    }
+
+    if ( !writer.Write( filename ) )
+    {
+      CONSOLE.addx( COLOR_ERROR, "Could not write map '%s'", filename );
+      return;
+    }
 
     if ( APP.DebugMode )
     {
@@ -698,15 +904,17 @@ void CMap::NewSky( const c8* filename, int hour, int minute)
 
     skyFilename = filename;
 
+#ifdef _CLIENT
 	if ( (hour > -1)&&(minute > -1) )
 	{
 		atmo = new ATMOsphere(hour, minute);
 		atmo->start(IRR.device, IRR.video, IRR.smgr->getRootSceneNode(), IRR.smgr, -1);
 		atmo->setDaysPerDay((f64)WORLD.getDaySpeed());
 	}
+#endif
 }
 
-void CMap::NewFog( SColor color=SColor(0,255,255,255), bool linearFog=true, f32 start=50.0f, f32 end=100.0f,
+void CMap::NewFog( SColor color=SColor(0,255,255,255), bool linearFog=true, f32 start=50.0f, f32 end=100.0f,
 			f32 density=0.01f, bool pixelFog=false, bool rangeFog=false )
 {
 	IRR.video->setFog( color, linearFog, start, end, density, pixelFog, rangeFog );
@@ -735,13 +943,16 @@ void CMap::Think()
     if ( editor )
     {
       editor->Think();
+#ifdef _CLIENT
       if ( NET.rakClient->IsConnected() )
       {
         delete editor;
         editor = NULL;
       }
+#endif
     }
 
+#ifdef _CLIENT
     int i;
     for ( i = 0; i < Sprites.size(); i++ )
     {
@@ -758,110 +969,59 @@ void CMap::Think()
 
 	if (atmo)
 		atmo->update( IRR.video );
+#endif
 }
 
-vector3df CMap::getOptGridRealPos( int r, int c )
+void CMap::GenerateOptimizationGrid()
 {
-    return vector3df( c * optCellWidth, r * optCellHeight, 0 );
-}
+    u32 i;
+    array<aabbox3df> boxes;
 
-void CMap::CheckPlanesInCell( int i, int j, CMap_Plane* plane, vector3df vP1, vector3df vP2, int im )
-{
-    if ( PointInOptGrid( i, j ) )
+    for ( i = 0; i < Zones.size(); i++ )
     {
-      for ( int k = 0; k < optGrid[i][j].Planes.size(); k++ )
-      {
-        if ( optGrid[i][j].Planes[k] == Planes[im] )
-        {
-          return;
-        }
-      }
+      boxes.push_back( *Zones[i]->getBox() );
+    }
+    zoneGrid.Build( boxes, OPTCELL_WIDTH, OPTCELL_HEIGHT );
 
-      line3d<f32> line1, line2, line3, line4;
-      vector3df vOut;
+    boxes.clear();
+    for ( i = 0; i < Planes.size(); i++ )
+    {
+      triangle3df t0 = Planes[i]->GetTriangle( 0 ), t1 = Planes[i]->GetTriangle( 1 );
+      aabbox3df box( t0.pointA );
+      box.addInternalPoint( t0.pointB );
+      box.addInternalPoint( t0.pointC );
+      box.addInternalPoint( t1.pointA );
+      boxes.push_back( box );
+    }
+    planeGrid.Build( boxes, OPTCELL_WIDTH, OPTCELL_HEIGHT );
 
-      if ( ( ( vP1.X >= getOptGridRealPos( i, j ).X ) && ( vP1.X < getOptGridRealPos( i, j + 1 ).X ) && ( vP1.Y >= getOptGridRealPos( i, j ).Y ) && ( vP1.Y < getOptGridRealPos( i + 1, j ).Y ) ) || ( ( vP2.X >= getOptGridRealPos( i, j ).X ) && ( vP2.X < getOptGridRealPos( i, j + 1 ).X ) && ( vP2.Y >= getOptGridRealPos( i, j ).Y ) && ( vP2.Y < getOptGridRealPos( i + 1, j ).Y ) ) )
-      {
-        //  CONSOLE.addx("point x%i y%i plane %i", j, i, im);
-        optGrid[i][j].Planes.push_back( Planes[im] );
-      }
-      else
-      {
-        line1.setLine( getOptGridRealPos( i, j ), getOptGridRealPos( i, j + 1 ) );
-        line2.setLine( getOptGridRealPos( i, j + 1 ), getOptGridRealPos( i + 1, j + 1 ) );
-        line3.setLine( getOptGridRealPos( i + 1, j + 1 ), getOptGridRealPos( i + 1, j ) );
-        line4.setLine( getOptGridRealPos( i + 1, j ), getOptGridRealPos( i, j ) );   
+    bGridDirty = false;
+}
 
-        if ( ( plane->getIntersectionWithLimitedLine( line1.start, line1.end, vOut ) ) || ( plane->getIntersectionWithLimitedLine( line2.start, line2.end, vOut ) ) || ( plane->getIntersectionWithLimitedLine( line3.start, line2.end, vOut ) ) || ( plane->getIntersectionWithLimitedLine( line4.start, line4.end, vOut ) ) )
-        {
-          //    CONSOLE.addx("line x%i y%i plane %i", j, i, im);
-          optGrid[i][j].Planes.push_back( Planes[im] );
-        }
-      }
+void CMap::GetZonesTouching( const aabbox3df& box, array<s32>& out )
+{
+    if ( bGridDirty )
+    {
+      GenerateOptimizationGrid();
     }
+    zoneGrid.Query( box, out );
 }
-void CMap::GenerateOptimizationGrid()
-{
-    int i, j, im;
-    //
 
-    CMap_Plane* plane = new CMap_Plane( vector3df( 0, 0, -100 ), vector3df( 0, 1000, -100 ), vector3df( 0, 0, 100 ), vector3df( 0, 1000, 100 ), 1.0f );
-
-    vector3df vP1, vP2, vPoint, vStep;
-    int px, py, tx, ty, stepsNum, step;
-
-    for ( im = 0; im < Planes.size(); im++ )
+void CMap::GetPlanesTouching( const aabbox3df& box, array<s32>& out )
+{
+    if ( bGridDirty )
     {
-      vP1 = vector3df( Planes[im]->GetTriangle( 0 ).pointB.X, Planes[im]->GetTriangle( 0 ).pointB.Y, 0 );
-      vP2 = vector3df( Planes[im]->GetTriangle( 0 ).pointC.X, Planes[im]->GetTriangle( 0 ).pointC.Y, 0 );
-
-      plane->setPlane( vector3df( Planes[im]->GetTriangle( 0 ).pointB.X, Planes[im]->GetTriangle( 0 ).pointB.Y, -100 ), vector3df( Planes[im]->GetTriangle( 0 ).pointC.X, Planes[im]->GetTriangle( 0 ).pointC.Y, -100 ), vector3df( Planes[im]->GetTriangle( 0 ).pointB.X, Planes[im]->GetTriangle( 0 ).pointB.Y, 100 ), vector3df( Planes[im]->GetTriangle( 0 ).pointC.X, Planes[im]->GetTriangle( 0 ).pointC.Y, 100 ) );
-
-      //for (i = 0; i < optRows-1; i++)
-      //    for (j = 0; j < optColumns-1; j++)
-      //    f32 lineLength = ( vP2 - vP1 ).getLength();
-      tx = OptGridColumn( vP1.X );
-      ty = OptGridRow( vP1.Y );
-      vStep.X = ( vP1.X - vP2.X ) / optColumns;
-      vStep.Y = ( vP1.Y - vP2.Y ) / optRows;
-
-      stepsNum = ( int )( vP2 - vP1 ).getLength() / vStep.getLength();
-
-      vPoint = vP2;
-      px = OptGridColumn( vPoint.X );
-      py = OptGridRow( vPoint.Y );
-
-      //if ( im == 0 )
-      //{
-      //    CONSOLE.addx("a x%i y%i plane %i", px, py, im);
-      //    CONSOLE.addx("b x%f y%f plane %i", stepX, stepY, im);
-      //    CONSOLE.addx("t x%f y%f plane %i", vP1.X, vP1.Y, im);
-      //    CONSOLE.addx("p x%f y%f plane %i", vP2.X, vP2.Y, im);
-      //}
-
-      step = i = j = -1;
-      do
-      {
-        step++;
-        if ( ( i != py ) || ( j != px ) )
-        {
-          i = py; j = px;
-          CheckPlanesInCell( i, j, plane, vP1, vP2, im );
-          CheckPlanesInCell( i + 1, j, plane, vP1, vP2, im );
-          CheckPlanesInCell( i - 1, j, plane, vP1, vP2, im );
-          CheckPlanesInCell( i, j + 1, plane, vP1, vP2, im );
-          CheckPlanesInCell( i, j - 1, plane, vP1, vP2, im );
-        }
-
-        vPoint.X += vStep.X;
-        vPoint.Y += vStep.Y;
-        px = OptGridColumn( vPoint.X );
-        py = OptGridRow( vPoint.Y );
-      }
-      while ( step < stepsNum );
+      GenerateOptimizationGrid();
     }
+    planeGrid.Query( box, out );
+}
 
-    delete plane;
+void CMap::UpdateGrids()
+{
+    if ( bGridDirty )
+    {
+      GenerateOptimizationGrid();
+    }
 }
 
 
@@ -940,6 +1100,21 @@ void CMap::GenerateOptimizationGrid()
 //}
 
 void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
+{
+    IAnimatedMesh* g_map = AddMeshNode( filename, vPos, vScale );
+    if ( !g_map )
+    {
+      return;
+    }
+
+    SMapMesh m;
+    m.filename = filename;
+    m.vPos = vPos;
+    m.vScale = vScale;
+    AddMeshBody( BuildMeshCollision( filename, g_map, vPos, vScale ), m );
+}
+
+IAnimatedMesh* CMap::LoadMesh( const c8* filename, vector3df vScale )
 {
     //////////////////////////////////////////////////////////////////////////
     //
@@ -947,22 +1122,34 @@ void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
     //
     //////////////////////////////////////////////////////////////////////////
     scene::IAnimatedMesh* g_map = 0;
-    scene::ISceneNode* g_mapnode = 0;
     //g_map = IRR.smgr->getMesh(filename);
 
     CDMFLoader* loader = new CDMFLoader( IRR.video, IRR.smgr );
     IReadFile* file;
     file = IRR.device->getFileSystem()->createAndOpenFile( APP.useFile( filename ).c_str() );
+    if ( !file )
+    {
+      delete loader;
+      return NULL;
+    }
 
     g_map = loader->createMesh( file, vScale );
 
     file->drop();
     delete loader;
 
+    return g_map;
+}
+
+IAnimatedMesh* CMap::AddMeshNode( const c8* filename, vector3df vPos, vector3df vScale )
+{
+    scene::IAnimatedMesh* g_map = LoadMesh( filename, vScale );
+    scene::ISceneNode* g_mapnode = 0;
+
     if ( !g_map )
     {
       //CONSOLE.addx( COLOR_ERROR, "Could not load mesh map: %s", filename );
-      return;
+      return NULL;
     }
     g_mapnode = IRR.smgr->addOctTreeSceneNode( g_map->getMesh( 0 ) );
     g_mapnode->setPosition( vPos );
@@ -997,7 +1184,16 @@ void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
     g_mapnode->setMaterialFlag( EMF_FOG_ENABLE, true );
     g_mapnode->setMaterialFlag( EMF_LIGHTING, (bool)IRR.useLighting );
 
+    return g_map;
+}
 
+NewtonCollision* CMap::BuildMeshCollision( const c8* filename, IAnimatedMesh* g_map, vector3df vPos, vector3df vScale )
+{
+    NewtonCollision* newtonmap = COLLISIONCACHE->LoadTree( WORLD.GetPhysics()->nWorld, filename, MAP_COLLISION_VARIANT, vPos, vScale );
+    if ( newtonmap )
+    {
+      return newtonmap;
+    }
 
     //////////////////////////////////////////////////////////////////////////
     //
@@ -1007,7 +1203,6 @@ void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
     // for your level. (Like a .x or .3ds level)
     //
     //////////////////////////////////////////////////////////////////////////
-    NewtonCollision* newtonmap;
     newtonmap = NewtonCreateTreeCollision( WORLD.GetPhysics()->nWorld, NULL );
     NewtonTreeCollisionBeginBuild( newtonmap );
     int cMeshBuffer, j;
@@ -1072,7 +1267,53 @@ void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
     // we definilte wan to optimize the mesh (improve performace and vehaviuor a lot)
     NewtonTreeCollisionEndBuild( newtonmap, 1 );
 
+    COLLISIONCACHE->SaveTree( WORLD.GetPhysics()->nWorld, filename, MAP_COLLISION_VARIANT, vPos, vScale, newtonmap );
+    return newtonmap;
+}
+
+void CMap::BenchmarkMeshCollision( const c8* filename, vector3df vPos, vector3df vScale, int runs )
+{
+    int i;
+    NewtonWorld* nWorld = WORLD.GetPhysics()->nWorld;
+
+    u32 t = getPreciseTime();
+    IAnimatedMesh* mesh = LoadMesh( filename, vScale );
+    u32 meshTime = getPreciseTime() - t;
+    if ( !mesh )
+    {
+      CONSOLE.addx( COLOR_ERROR, "Could not load mesh map: %s", filename );
+      return;
+    }
+
+    bool bEnabled = COLLISIONCACHE->enabled;
 
+    COLLISIONCACHE->enabled = false;
+    t = getPreciseTime();
+    for ( i = 0; i < runs; i++ )
+    {
+      NewtonReleaseCollision( nWorld, BuildMeshCollision( filename, mesh, vPos, vScale ) );
+    }
+    u32 buildTime = getPreciseTime() - t;
+
+    // the first call fills the cache if it was empty
+    COLLISIONCACHE->enabled = true;
+    NewtonReleaseCollision( nWorld, BuildMeshCollision( filename, mesh, vPos, vScale ) );
+    t = getPreciseTime();
+    for ( i = 0; i < runs; i++ )
+    {
+      NewtonReleaseCollision( nWorld, BuildMeshCollision( filename, mesh, vPos, vScale ) );
+    }
+    u32 cacheTime = getPreciseTime() - t;
+
+    COLLISIONCACHE->enabled = bEnabled;
+    mesh->drop();
+
+    APPLOG.Write( "Collision benchmark '%s': mesh load %u ms, tree build %.1f ms, tree from cache %.1f ms (%i runs)", filename, meshTime, ( f32 )buildTime / runs, ( f32 )cacheTime / runs, runs );
+    CONSOLE.addx( "%s: build %.1f ms, cache %.1f ms", filename, ( f32 )buildTime / runs, ( f32 )cacheTime / runs );
+}
+
+void CMap::AddMeshBody( NewtonCollision* newtonmap, SMapMesh& mesh )
+{
     // create a ridid body to represent the world
     NewtonBody* newtonmapbody;
     newtonmapbody = NewtonCreateBody( WORLD.GetPhysics()->nWorld, newtonmap );
@@ -1091,18 +1332,23 @@ void CMap::addMeshMap( const c8* filename, vector3df vPos, vector3df vScale )
 
     // the world uses the ground material
     NewtonBodySetMaterialGroupID( newtonmapbody, CNewton::levelID );
+
+    mesh.body = newtonmapbody;
+    Meshes.push_back( mesh );
 }
 
 void CMap::AddZone( vector3df vPos, vector3df vSize, int zonetype )
 {
     CMap_Zone* zone = new CMap_Zone( aabbox3df( vector3df( vPos.X - vSize.X, vPos.Y - vSize.Y, vPos.Z - vSize.Z ), vector3df( vPos.X + vSize.X, vPos.Y + vSize.Y, vPos.Z + vSize.Z ) ), ( ZoneType )zonetype );
     Zones.push_back( zone );
+    bGridDirty = true;
 }
 
 void CMap::AddZone( aabbox3df box, int zonetype )
 {
     CMap_Zone* zone = new CMap_Zone( box, ( ZoneType )zonetype );
     Zones.push_back( zone );
+    bGridDirty = true;
 }
 
 void CMap::addSprite( CAnimSpriteSceneNode* Sprite )
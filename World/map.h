@@ -6,6 +6,9 @@
 
 #include "respawn.h"
 #include "editor.h"
+#include "mapgrid.h"
+#include "mapfile.h"
+#include "../Newton/newton_physics.h"
 #include "../Irrlicht/CAnimSprite.h"
 
 class CReflectedWater;
@@ -70,6 +73,11 @@ class CMap_Zone
     {
         return fLWF;
     }
+    // the plane things cross when they enter the water
+    const plane3d<f32>& getSurface()
+    {
+        return surface;
+    }
 
     void Scale( vector3df vScale );
 
@@ -81,6 +89,7 @@ class CMap_Zone
     int type;
     //scene::ISceneNode* node;
     vector3df vSize;
+    plane3d<f32> surface;
 
     f32 fLWF;
 };
@@ -114,6 +123,14 @@ class CMap_Plane
     f32 size;
 };
 
+// a mesh map and the level body built from it
+struct SMapMesh
+{
+    String filename;
+    vector3df vPos, vScale;
+    NewtonBody* body;
+};
+
 ////////////////////////////////////////////
 // CMap 
 ////////////////////////////////////////////
@@ -124,9 +141,18 @@ class CMap : public CEntity
     virtual ~CMap();
     // AUTO_SIZE;
 
-    //CMap_Plane* GetPlane(s32 i)               { if (PlaneExists(i)) return Planes[i]; else return NULL; }
-    //s32 GetPlanesNum()                        { return Planes.size(); }
-    //bool PlaneExists(s32 i)                   { if ((i<0)||(i>(s32)Planes.size()-1)) return false; else return true;  }
+    CMap_Plane* GetPlane( s32 i )
+    {
+        if ( ( i < 0 ) || ( i > ( s32 )Planes.size() - 1 ) )
+        {
+          return NULL;
+        }
+        return Planes[i];
+    }
+    s32 GetPlanesNum()
+    {
+        return Planes.size();
+    }
 
     CMap_Zone* GetZone( s32 i )
     {
@@ -159,6 +185,7 @@ class CMap : public CEntity
     void AddPlane( CMap_Plane* p )
     {
         Planes.push_back( p );
+        bGridDirty = true;
     }
     // method for adding 2d map plane based on two points
     void Add2DPlane( vector3df p1, vector3df p2 );
@@ -168,6 +195,8 @@ class CMap : public CEntity
     void AddZone( vector3df vPos, vector3df vSize, int zonetype );
     void AddZone( aabbox3df box, int zonetype );
     void addMeshMap( const c8* filename, vector3df vPos, vector3df vScale );
+    // logs how long the mesh's collision tree takes to build and to load from the cache
+    void BenchmarkMeshCollision( const c8* filename, vector3df vPos, vector3df vScale, int runs );
     void addSprite( CAnimSpriteSceneNode* Sprite );
     void addCloud( CMap_Cloud* cloud );
     void setSunLight( ISceneNode* l )
@@ -184,7 +213,10 @@ class CMap : public CEntity
     virtual void Think();
     virtual void Render();
 
+    // reads the binary format or a legacy .map
     void Load( const c8* filename );
+    // writes everything the map holds in the binary format, this is how a
+    // .map plus its world script get converted
     void Save( const c8* filename );
 
     CRespawn* GetRespawn()
@@ -193,56 +225,46 @@ class CMap : public CEntity
     }
     CEditor* GetEditor();
 
-    struct optCell
-    {
-        array<CMap_Plane*> Planes;
-    };
-    optCell getOptCell( int c, int r )
-    {
-        if ( PointInOptGrid( c, r ) )
-        {
-          return optGrid[r][c];
-        } return optGrid[0][0];
-    }
-    s32 OptGridRow( f32 y )
-    {
-        return ( floor( y / optCellHeight ) );
-    }
-    s32 OptGridColumn( f32 x )
-    {
-        return ( floor( x / optCellWidth ) );
-    }
-    bool PointInOptGrid( s32 x, s32 y )
-    {
-        if ( ( x > -1 ) && ( x < optColumns - 1 ) && ( y > -1 ) && ( y < optRows - 1 ) )
-        {
-          return true;
-        } return false;
-    }
+    // appends the indices of the zones/planes whose bounds overlap box in X and Y,
+    // the grids are rebuilt on the first query after the map changed
+    void GetZonesTouching( const aabbox3df& box, array<s32>& out );
+    void GetPlanesTouching( const aabbox3df& box, array<s32>& out );
+    // rebuilds the grids now, so queries from the physics threads only read
+    void UpdateGrids();
 
     f32 worldWidth, worldHeight, worldDepth, planeSize;
 
   private:
     friend class CEditor;
-    vector3df getOptGridRealPos( int r, int c );
-    void CheckPlanesInCell( int i, int j, CMap_Plane* plane, vector3df vP1, vector3df vP2, int im );
     void GenerateOptimizationGrid();
 
+    void LoadLegacy( const c8* filename );
+    bool LoadBinary( const c8* filename );
+
+    IAnimatedMesh* LoadMesh( const c8* filename, vector3df vScale );
+    IAnimatedMesh* AddMeshNode( const c8* filename, vector3df vPos, vector3df vScale );
+    // takes the tree from the collision cache when it can
+    NewtonCollision* BuildMeshCollision( const c8* filename, IAnimatedMesh* mesh, vector3df vPos, vector3df vScale );
+    void AddMeshBody( NewtonCollision* collision, SMapMesh& mesh );
+
     //  void createCollisionFromBlock( CBoolblock *block, vector3df vPos = vector3df(0.0f, 0.0f, 0.0f), vector3df vScale = vector3df(1.0f, 1.0f, 1.0f) );
 
     array<CMap_Plane*> Planes;
     array<CMap_Zone*> Zones;
     array<CAnimSpriteSceneNode*> Sprites;
     array<CMap_Cloud*> Clouds;
+    array<SMapMesh> Meshes;
+
+    // the binary map the grids may point into
+    CMapFile binary;
 
     ISceneNode* sky;
     String skyFilename;
     ISceneNode* sunLight;
 	ATMOsphere* atmo;
 
-    optCell** optGrid;
-    int optRows, optColumns;
-    f32 optCellWidth, optCellHeight;
+    CMapGrid zoneGrid, planeGrid;
+    bool bGridDirty;
 
     CRespawn* respawn;
     CEditor* editor;
@@ -252,7 +274,7 @@ class CMap : public CEntity
 };
 
 
-// Map File Structure
+// Legacy Map File Structure, see mapfile.h for the current format
 #define MAPFILE_VERSION 1
 
 struct MapHeader
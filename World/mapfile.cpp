@@ -0,0 +1,273 @@
+#include "mapfile.h"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+////////////////////////////////////////////
+// CMapFile
+////////////////////////////////////////////
+
+CMapFile::CMapFile()
+{
+    data = NULL;
+    dataSize = 0;
+#ifdef WIN32
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    file = -1;
+#endif
+}
+
+CMapFile::~CMapFile()
+{
+    Close();
+}
+
+bool CMapFile::IsMapFile( const c8* filename )
+{
+    MapFileHeader header;
+
+    FILE* pFile = fopen( filename, "rb" );
+    if ( pFile == NULL )
+    {
+      return false;
+    }
+
+    bool bResult = ( fread( &header, sizeof( MapFileHeader ), 1, pFile ) == 1 ) && ( header.magic == MAPFILE_MAGIC );
+    fclose( pFile );
+    return bResult;
+}
+
+bool CMapFile::Open( const c8* filename )
+{
+    Close();
+
+#ifdef WIN32
+    file = CreateFile( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+      return false;
+    }
+    dataSize = GetFileSize( file, NULL );
+    mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( mapping )
+    {
+      data = ( const u8 * )MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    }
+#else
+    file = open( filename, O_RDONLY );
+    if ( file < 0 )
+    {
+      return false;
+    }
+    struct stat st;
+    fstat( file, &st );
+    dataSize = ( u32 )st.st_size;
+    void* view = mmap( NULL, dataSize, PROT_READ, MAP_PRIVATE, file, 0 );
+    data = ( view == MAP_FAILED ) ? NULL : ( const u8 * )view;
+#endif
+
+    if ( !Validate() )
+    {
+      APPLOG.Write( "CMapFile: '%s' is not a valid binary map", filename );
+      Close();
+      return false;
+    }
+
+    return true;
+}
+
+void CMapFile::Close()
+{
+#ifdef WIN32
+    if ( data )
+    {
+      UnmapViewOfFile( data );
+    }
+    if ( mapping )
+    {
+      CloseHandle( mapping );
+    }
+    if ( file != INVALID_HANDLE_VALUE )
+    {
+      CloseHandle( file );
+    }
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    if ( data )
+    {
+      munmap( ( void * )data, dataSize );
+    }
+    if ( file >= 0 )
+    {
+      close( file );
+    }
+    file = -1;
+#endif
+    data = NULL;
+    dataSize = 0;
+}
+
+bool CMapFile::Validate()
+{
+    if ( !data || ( dataSize < sizeof( MapFileHeader ) ) )
+    {
+      return false;
+    }
+
+    const MapFileHeader* header = ( const MapFileHeader* )data;
+    if ( ( header->magic != MAPFILE_MAGIC ) || ( header->version != MAPFILE_BINARY_VERSION ) || ( header->fileSize != dataSize ) )
+    {
+      return false;
+    }
+
+    if ( sizeof( MapFileHeader ) + header->sectionsNum * sizeof( MapFileSection ) > dataSize )
+    {
+      return false;
+    }
+
+    // sections must lie inside the file, GetSection() trusts them from here on
+    const MapFileSection* table = ( const MapFileSection* )( header + 1 );
+    for ( u32 i = 0; i < header->sectionsNum; i++ )
+    {
+      if ( ( table[i].offset > dataSize ) || ( table[i].size > dataSize - table[i].offset ) || ( table[i].offset % MAPFILE_ALIGN ) )
+      {
+        return false;
+      }
+    }
+
+    return true;
+}
+
+const u8* CMapFile::GetSection( u32 id, u32 version, u32* size ) const
+{
+    if ( !data )
+    {
+      return NULL;
+    }
+
+    const MapFileHeader* header = ( const MapFileHeader* )data;
+    const MapFileSection* table = ( const MapFileSection* )( header + 1 );
+    for ( u32 i = 0; i < header->sectionsNum; i++ )
+    {
+      if ( table[i].id != id )
+      {
+        continue;
+      }
+      if ( table[i].version != version )
+      {
+        APPLOG.Write( "CMapFile: section %u has version %u, expected %u", id, table[i].version, version );
+        return NULL;
+      }
+      if ( size )
+      {
+        *size = table[i].size;
+      }
+      return data + table[i].offset;
+    }
+
+    return NULL;
+}
+
+////////////////////////////////////////////
+// CMapFileWriter
+////////////////////////////////////////////
+
+CMapFileWriter::CMapFileWriter()
+{
+    current = -1;
+}
+
+void CMapFileWriter::Pad( u32 alignment )
+{
+    while ( blob.size() % alignment )
+    {
+      blob.push_back( 0 );
+    }
+}
+
+void CMapFileWriter::BeginSection( u32 id, u32 version )
+{
+    EndSection();
+    Pad( MAPFILE_ALIGN );
+
+    MapFileSection s;
+    s.id = id;
+    s.version = version;
+    s.offset = blob.size();    // relative to the blob until Write()
+    s.size = 0;
+    sections.push_back( s );
+    current = sections.size() - 1;
+}
+
+void CMapFileWriter::Append( const void* buffer, u32 size )
+{
+    if ( size == 0 )
+    {
+      return;
+    }
+    u32 at = blob.size();
+    if ( blob.allocated_size() < at + size )
+    {
+      // set_used() grows to the exact size, grow geometrically instead
+      blob.reallocate( max( blob.allocated_size() * 2, at + size ) );
+    }
+    blob.set_used( at + size );
+    memcpy( blob.pointer() + at, buffer, size );
+}
+
+void CMapFileWriter::EndSection()
+{
+    if ( current < 0 )
+    {
+      return;
+    }
+    sections[current].size = blob.size() - sections[current].offset;
+    current = -1;
+}
+
+bool CMapFileWriter::Write( const c8* filename )
+{
+    EndSection();
+
+    // the blob starts at the first aligned offset after the section table
+    u32 tableEnd = sizeof( MapFileHeader ) + sections.size() * sizeof( MapFileSection );
+    u32 blobStart = ( tableEnd + MAPFILE_ALIGN - 1 ) / MAPFILE_ALIGN * MAPFILE_ALIGN;
+
+    MapFileHeader header;
+    header.magic = MAPFILE_MAGIC;
+    header.version = MAPFILE_BINARY_VERSION;
+    header.sectionsNum = sections.size();
+    header.fileSize = blobStart + blob.size();
+
+    FILE* pFile = fopen( filename, "wb" );
+    if ( pFile == NULL )
+    {
+      return false;
+    }
+
+    fwrite( &header, sizeof( MapFileHeader ), 1, pFile );
+    for ( u32 i = 0; i < sections.size(); i++ )
+    {
+      MapFileSection s = sections[i];
+      s.offset += blobStart;
+      fwrite( &s, sizeof( MapFileSection ), 1, pFile );
+    }
+
+    u8 zero[MAPFILE_ALIGN];
+    memset( zero, 0, MAPFILE_ALIGN );
+    fwrite( zero, 1, blobStart - tableEnd, pFile );
+
+    if ( blob.size() )
+    {
+      fwrite( blob.pointer(), 1, blob.size(), pFile );
+    }
+
+    fclose( pFile );
+    return true;
+}
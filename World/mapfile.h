@@ -0,0 +1,177 @@
+#ifndef MAPFILE_H_INCLUDED
+#define MAPFILE_H_INCLUDED
+
+#include "../Engine/engine.h"
+
+////////////////////////////////////////////
+// Binary map file
+// - header, section table, then the sections, each 16 byte aligned
+// - everything is little-endian and stored the way it is used, so the
+//   loader reads records straight out of the mapped file
+// - every section carries its own version, a loader skips sections it
+//   does not know and rebuilds the ones with a version it does not read
+////////////////////////////////////////////
+
+#define MAPFILE_MAGIC 0x50414D43 // 'CMAP'
+#define MAPFILE_BINARY_VERSION 1
+#define MAPFILE_ALIGN 16
+
+enum MapSectionId
+{
+    MAPSECTION_ENVIRONMENT = 1,
+    MAPSECTION_PLANES,
+    MAPSECTION_ZONES,
+    MAPSECTION_CLOUDS,
+    MAPSECTION_RESPAWNS,
+    MAPSECTION_MESHES,
+    MAPSECTION_ZONEGRID,
+    MAPSECTION_PLANEGRID,
+    MAPSECTION_COLLISION,
+};
+
+// section versions
+#define MAPSECTION_ENVIRONMENT_VERSION 1
+#define MAPSECTION_PLANES_VERSION 1
+#define MAPSECTION_ZONES_VERSION 1
+#define MAPSECTION_CLOUDS_VERSION 1
+#define MAPSECTION_RESPAWNS_VERSION 1
+#define MAPSECTION_MESHES_VERSION 1
+#define MAPSECTION_GRID_VERSION 1
+#define MAPSECTION_COLLISION_VERSION 1
+
+struct MapFileHeader
+{
+    u32 magic;
+    u32 version;
+    u32 sectionsNum;
+    u32 fileSize;
+};
+
+struct MapFileSection
+{
+    u32 id;
+    u32 version;
+    u32 offset;     // from the start of the file
+    u32 size;
+};
+
+struct MapFileEnvironment
+{
+    f32 worldWidth, worldHeight, worldDepth, planeSize;
+    c8 skyfile[128];
+};
+
+struct MapFilePlane
+{
+    triangle3df triangle[2];
+    f32 size;
+};
+
+// zones and clouds
+struct MapFileBox
+{
+    aabbox3df box;
+    s32 type;
+};
+
+struct MapFileRespawn
+{
+    vector3df vPos;
+    s32 team;
+    f32 direction;
+    c8 actorName[64];
+    c8 parentActorName[64];
+    c8 parentActorScriptName[128];
+};
+
+struct MapFileMesh
+{
+    c8 filename[128];
+    vector3df vPos, vScale;
+};
+
+// followed by s32 cellStart[columns * rows + 1], s32 cellItems[cellItemsNum],
+// aabbox3df itemBoxes[itemsNum], s32 itemColumn[itemsNum], s32 itemRow[itemsNum]
+struct MapFileGrid
+{
+    f32 originX, originY;
+    f32 cellW, cellH;
+    s32 columns, rows;
+    s32 itemsNum, cellItemsNum;
+};
+
+// the collision section holds one entry per mesh, in mesh order:
+// u32 size followed by the serialized Newton tree, padded to 4 bytes
+
+////////////////////////////////////////////
+// CMapFile
+// - read only view of a binary map, the file stays mapped until Close()
+////////////////////////////////////////////
+
+class CMapFile
+{
+  public:
+    CMapFile();
+    ~CMapFile();
+
+    // true if filename starts with the binary map header
+    static bool IsMapFile( const c8* filename );
+
+    bool Open( const c8* filename );
+    void Close();
+
+    bool isOpen()
+    {
+        return data != NULL;
+    }
+
+    // NULL if the section is missing or has a different version
+    const u8* GetSection( u32 id, u32 version, u32* size = NULL ) const;
+
+    // a section made of fixed size records
+    template <class T>
+    const T* GetRecords( u32 id, u32 version, u32& count ) const
+    {
+        u32 size;
+        const T* records = ( const T* )GetSection( id, version, &size );
+        count = records ? size / sizeof( T ) : 0;
+        return records;
+    }
+
+  private:
+    bool Validate();
+
+    const u8* data;
+    u32 dataSize;
+
+#ifdef WIN32
+    HANDLE file, mapping;
+#else
+    int file;
+#endif
+};
+
+////////////////////////////////////////////
+// CMapFileWriter
+////////////////////////////////////////////
+
+class CMapFileWriter
+{
+  public:
+    CMapFileWriter();
+
+    void BeginSection( u32 id, u32 version );
+    void Append( const void* buffer, u32 size );
+    void EndSection();
+
+    bool Write( const c8* filename );
+
+  private:
+    void Pad( u32 alignment );
+
+    array<MapFileSection> sections;
+    array<u8> blob;
+    s32 current;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#include "mapgrid.h"
+
+// IRR.
+#include "../irrlicht/IrrlichtTask.h"
+
+// the cell size grows for huge maps so the grid stays small
+#define MAPGRID_MAX_CELLS 128
+
+////////////////////////////////////////////
+// CMapGrid 
+////////////////////////////////////////////
+
+CMapGrid::CMapGrid()
+{
+    Clear();
+}
+
+void CMapGrid::Clear()
+{
+    originX = originY = 0.0f;
+    cellW = cellH = 1.0f;
+    columns = rows = 0;
+    itemsNum = cellItemsNum = 0;
+    cellStart.clear();
+    cellItems.clear();
+    itemBoxes.clear();
+    itemColumn.clear();
+    itemRow.clear();
+
+    pCellStart = pCellItems = NULL;
+    pItemBoxes = NULL;
+    pItemColumn = pItemRow = NULL;
+}
+
+s32 CMapGrid::Column( f32 x ) const
+{
+    s32 c = ( s32 )floor( ( x - originX ) / cellW );
+    return c < 0 ? 0 : ( c >= columns ? columns - 1 : c );
+}
+
+s32 CMapGrid::Row( f32 y ) const
+{
+    s32 r = ( s32 )floor( ( y - originY ) / cellH );
+    return r < 0 ? 0 : ( r >= rows ? rows - 1 : r );
+}
+
+void CMapGrid::Build( const array<aabbox3df>& boxes, f32 cellWidth, f32 cellHeight )
+{
+    u32 i;
+    s32 r, c;
+
+    Clear();
+    if ( boxes.size() == 0 )
+    {
+      return;
+    }
+
+    aabbox3df bounds = boxes[0];
+    for ( i = 1; i < boxes.size(); i++ )
+    {
+      bounds.addInternalBox( boxes[i] );
+    }
+
+    originX = bounds.MinEdge.X;
+    originY = bounds.MinEdge.Y;
+    f32 width = bounds.MaxEdge.X - bounds.MinEdge.X;
+    f32 height = bounds.MaxEdge.Y - bounds.MinEdge.Y;
+    cellW = max( cellWidth, width / MAPGRID_MAX_CELLS );
+    cellH = max( cellHeight, height / MAPGRID_MAX_CELLS );
+    columns = ( s32 )floor( width / cellW ) + 1;
+    rows = ( s32 )floor( height / cellH ) + 1;
+
+    // count, then fill
+    cellStart.set_used( columns * rows + 1 );
+    for ( i = 0; i < cellStart.size(); i++ )
+    {
+      cellStart[i] = 0;
+    }
+
+    for ( i = 0; i < boxes.size(); i++ )
+    {
+      itemBoxes.push_back( boxes[i] );
+      itemColumn.push_back( Column( boxes[i].MinEdge.X ) );
+      itemRow.push_back( Row( boxes[i].MinEdge.Y ) );
+
+      for ( r = itemRow[i]; r <= Row( boxes[i].MaxEdge.Y ); r++ )
+      {
+        for ( c = itemColumn[i]; c <= Column( boxes[i].MaxEdge.X ); c++ )
+        {
+          cellStart[r * columns + c + 1]++;
+        }
+      }
+    }
+
+    for ( i = 1; i < cellStart.size(); i++ )
+    {
+      cellStart[i] += cellStart[i - 1];
+    }
+
+    array<s32> fill;
+    fill.set_used( columns * rows );
+    for ( i = 0; i < fill.size(); i++ )
+    {
+      fill[i] = cellStart[i];
+    }
+
+    cellItems.set_used( cellStart[columns * rows] );
+    for ( i = 0; i < boxes.size(); i++ )
+    {
+      for ( r = itemRow[i]; r <= Row( boxes[i].MaxEdge.Y ); r++ )
+      {
+        for ( c = itemColumn[i]; c <= Column( boxes[i].MaxEdge.X ); c++ )
+        {
+          cellItems[fill[r * columns + c]++] = i;
+        }
+      }
+    }
+
+    itemsNum = boxes.size();
+    cellItemsNum = cellItems.size();
+    pCellStart = cellStart.pointer();
+    pCellItems = cellItems.pointer();
+    pItemBoxes = itemBoxes.pointer();
+    pItemColumn = itemColumn.pointer();
+    pItemRow = itemRow.pointer();
+}
+
+bool CMapGrid::Attach( const MapFileGrid* grid, u32 size )
+{
+    Clear();
+    if ( !grid || ( size < sizeof( MapFileGrid ) ) || ( grid->columns < 0 ) || ( grid->rows < 0 ) || ( grid->itemsNum < 0 ) || ( grid->cellItemsNum < 0 ) )
+    {
+      return false;
+    }
+
+    s32 cells = grid->columns * grid->rows;
+    u32 needed = sizeof( MapFileGrid ) + ( cells + 1 + grid->cellItemsNum + 2 * grid->itemsNum ) * sizeof( s32 ) + grid->itemsNum * sizeof( aabbox3df );
+    if ( size < needed )
+    {
+      return false;
+    }
+
+    originX = grid->originX;
+    originY = grid->originY;
+    cellW = grid->cellW;
+    cellH = grid->cellH;
+    columns = grid->columns;
+    rows = grid->rows;
+    itemsNum = grid->itemsNum;
+    cellItemsNum = grid->cellItemsNum;
+
+    pCellStart = ( const s32 * )( grid + 1 );
+    pCellItems = pCellStart + cells + 1;
+    pItemBoxes = ( const aabbox3df * )( pCellItems + cellItemsNum );
+    pItemColumn = ( const s32 * )( pItemBoxes + itemsNum );
+    pItemRow = pItemColumn + itemsNum;
+    return true;
+}
+
+void CMapGrid::Write( CMapFileWriter& writer )
+{
+    MapFileGrid grid;
+    grid.originX = originX;
+    grid.originY = originY;
+    grid.cellW = cellW;
+    grid.cellH = cellH;
+    grid.columns = columns;
+    grid.rows = rows;
+    grid.itemsNum = itemsNum;
+    grid.cellItemsNum = cellItemsNum;
+    writer.Append( &grid, sizeof( MapFileGrid ) );
+
+    if ( columns == 0 )
+    {
+      return;
+    }
+    writer.Append( pCellStart, ( columns * rows + 1 ) * sizeof( s32 ) );
+    writer.Append( pCellItems, cellItemsNum * sizeof( s32 ) );
+    writer.Append( pItemBoxes, itemsNum * sizeof( aabbox3df ) );
+    writer.Append( pItemColumn, itemsNum * sizeof( s32 ) );
+    writer.Append( pItemRow, itemsNum * sizeof( s32 ) );
+}
+
+void CMapGrid::Query( const aabbox3df& box, array<s32>& out ) const
+{
+    if ( columns == 0 )
+    {
+      return;
+    }
+
+    // nothing lies outside the grid bounds
+    if ( ( box.MaxEdge.X < originX ) || ( box.MaxEdge.Y < originY ) || ( box.MinEdge.X > originX + columns * cellW ) || ( box.MinEdge.Y > originY + rows * cellH ) )
+    {
+      return;
+    }
+
+    s32 c0 = Column( box.MinEdge.X ), c1 = Column( box.MaxEdge.X );
+    s32 r0 = Row( box.MinEdge.Y ), r1 = Row( box.MaxEdge.Y );
+
+    for ( s32 r = r0; r <= r1; r++ )
+    {
+      for ( s32 c = c0; c <= c1; c++ )
+      {
+        s32 cell = r * columns + c;
+        for ( s32 k = pCellStart[cell]; k < pCellStart[cell + 1]; k++ )
+        {
+          s32 item = pCellItems[k];
+
+          // report each item from the first cell of the query it is in
+          if ( ( c != max( pItemColumn[item], c0 ) ) || ( r != max( pItemRow[item], r0 ) ) )
+          {
+            continue;
+          }
+
+          const aabbox3df& b = pItemBoxes[item];
+          if ( ( b.MinEdge.X <= box.MaxEdge.X ) && ( b.MaxEdge.X >= box.MinEdge.X ) && ( b.MinEdge.Y <= box.MaxEdge.Y ) && ( b.MaxEdge.Y >= box.MinEdge.Y ) )
+          {
+            out.push_back( item );
+          }
+        }
+      }
+    }
+}
+
+void CMapGrid::Render( SColor color )
+{
+    s32 i;
+    f32 right = originX + columns * cellW;
+    f32 top = originY + rows * cellH;
+
+    for ( i = 0; i <= rows; i++ )
+    {
+      IRR.video->draw3DLine( vector3df( originX, originY + i * cellH, 0 ), vector3df( right, originY + i * cellH, 0 ), color );
+    }
+    for ( i = 0; i <= columns; i++ )
+    {
+      IRR.video->draw3DLine( vector3df( originX + i * cellW, originY, 0 ), vector3df( originX + i * cellW, top, 0 ), color );
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef MAPGRID_H_INCLUDED
+#define MAPGRID_H_INCLUDED
+
+#include "../Engine/engine.h"
+#include "mapfile.h"
+
+////////////////////////////////////////////
+// CMapGrid 
+// - uniform grid over the XY plane holding item indices, built once from
+//   the items' bounding boxes
+// - cells are stored back to back, an item spanning several cells is
+//   reported only from the first cell a query visits
+// - a grid can also be attached to a MapFileGrid section and used in place
+////////////////////////////////////////////
+
+class CMapGrid
+{
+  public:
+    CMapGrid();
+
+    void Build( const array<aabbox3df>& boxes, f32 cellWidth, f32 cellHeight );
+    void Clear();
+
+    // uses the section as is, it has to stay mapped while the grid is used
+    bool Attach( const MapFileGrid* grid, u32 size );
+    void Write( CMapFileWriter& writer );
+
+    // appends the indices of the items whose box overlaps box in X and Y,
+    // the caller does the exact test
+    void Query( const aabbox3df& box, array<s32>& out ) const;
+
+    void Render( SColor color );
+
+    s32 getColumns()
+    {
+        return columns;
+    }
+    s32 getRows()
+    {
+        return rows;
+    }
+    s32 getItemsNum()
+    {
+        return itemsNum;
+    }
+
+  private:
+    s32 Column( f32 x ) const;
+    s32 Row( f32 y ) const;
+
+    f32 originX, originY;
+    f32 cellW, cellH;
+    s32 columns, rows;
+    s32 itemsNum, cellItemsNum;
+
+    // items of cell c are cellItems[cellStart[c]] .. cellItems[cellStart[c + 1] - 1]
+    array<s32> cellStart;
+    array<s32> cellItems;
+
+    array<aabbox3df> itemBoxes;
+    array<s32> itemColumn, itemRow;
+
+    // what Query() reads, either the arrays above or an attached section
+    const s32* pCellStart;
+    const s32* pCellItems;
+    const aabbox3df* pItemBoxes;
+    const s32* pItemColumn;
+    const s32* pItemRow;
+};
+
+#endif
@@ -50,7 +50,9 @@ void CPhys_Part::Think()
     CEntity::Think();
 
     // update the debug position
+#ifdef _CLIENT
     setDebugPos( IRR.smgr->getSceneCollisionManager()->getScreenCoordinatesFrom3DPosition( Pos, IRR.smgr->getActiveCamera() ) );
+#endif
 
     if ( oneOverMass == 0.0f )
     {
@@ -37,6 +37,8 @@ CPlayer::CPlayer( PlayerID pID )
 
     info.name = "Unnamed player";
     info.team = 0;
+
+    bBot = false;
 }
 
 CPlayer::~CPlayer()
@@ -172,8 +174,9 @@ void CPlayerManager::RemovePlayer( PlayerID playerID )
     }
 
 
+    // not binary_search, that would sort the players by address
     int i = -1;
-    i = Players.binary_search( p );
+    i = Players.linear_search( p );
     if ( i > -1 )
     {
       Players.erase( i );
@@ -48,6 +48,9 @@ class CPlayer
 
     String className;
 
+    // the controls are set by a CBot
+    bool bBot;
+
   private:
     CControls* controls;
     bool bCustomControls;
@@ -68,6 +71,20 @@ class CPlayerManager
     CPlayer* AddPlayer( PlayerID playerID );
     void RemovePlayer( PlayerID playerID );
 
+    // in the order they joined
+    s32 GetPlayersNum()
+    {
+        return Players.size();
+    }
+    CPlayer* GetPlayerByIndex( s32 i )
+    {
+        return Players[i];
+    }
+    s32 GetPlayerIndex( CPlayer* p )
+    {
+        return Players.linear_search( p );
+    }
+
     void DumpToConsole();
 
     String getPlayerName( PlayerID playerID );
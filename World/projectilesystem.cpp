@@ -0,0 +1,445 @@
+#include "projectilesystem.h"
+
+#include "../App/app.h"
+// IRR.
+#include "../irrlicht/IrrlichtTask.h"
+// CONSOLE.
+#include "../IrrConsole/console.h"
+
+#include "../FreeSL/SoundTask.h"
+
+#include "world.h"
+#include "map.h"
+#include "prop.h"
+#include "character.h"
+#include "../Effects/effectpool.h"
+#include "../RakNet/lagcomp.h"
+
+#define PROJECTILE_DAMPING 0.999f
+#define PROJECTILE_ELASTICITY 1.0f
+// a oneOverMass of 0 is an immovable projectile, gravity and forces leave it
+// alone and it hits with this mass, as does anything heavier
+#define PROJECTILE_MAX_IMPACT_MASS 1000.0f
+#define POINT_DRAW 0.2f
+
+////////////////////////////////////////////
+// CProjectileSystem
+////////////////////////////////////////////
+
+CProjectileSystem::CProjectileSystem()
+{
+    fDamping = PROJECTILE_DAMPING;
+    fGravity = 0.0f;
+    castIndex = 0;
+
+    beamEffect = EFFECTS->GetType( "beam" );
+    dustEffect = EFFECTS->GetType( "dust" );
+    bubbleEffect = EFFECTS->GetType( "bubble" );
+    machineHitEffect = EFFECTS->GetType( "machinehit" );
+    gunSplashEffect = EFFECTS->GetType( "gunsplash" );
+    surfaceSplashEffect = EFFECTS->GetType( "surfacesplash" );
+    waterCircleEffect = EFFECTS->GetType( "watercircle" );
+}
+
+CProjectileSystem::~CProjectileSystem()
+{
+}
+
+s32 CProjectileSystem::Spawn( vector3df vPos, vector3df vVelocity, PlayerID ownerPID, f32 oneOverMassConst, f32 radiusConst, int aliveTime, f32 power )
+{
+    posX.push_back( vPos.X );
+    posY.push_back( vPos.Y );
+    oldX.push_back( vPos.X - vVelocity.X );
+    oldY.push_back( vPos.Y - vVelocity.Y );
+    altOldX.push_back( vPos.X - vVelocity.X );
+    altOldY.push_back( vPos.Y - vVelocity.Y );
+    forceX.push_back( 0.0f );
+    forceY.push_back( 0.0f );
+    oneOverMass.push_back( max( oneOverMassConst, 0.0f ) );
+    radius.push_back( radiusConst );
+    hitPower.push_back( power );
+    life.push_back( aliveTime );
+    owner.push_back( ownerPID );
+    dead.push_back( 0 );
+
+    return posX.size() - 1;
+}
+
+void CProjectileSystem::Update()
+{
+    PROFILE( "Projectiles" );
+
+    if ( posX.size() == 0 )
+    {
+      return;
+    }
+
+    Integrate();
+    CastRays();
+    ResolveHits();
+    CheckZones();
+    SpawnEffects();
+    RemoveDead();
+}
+
+void CProjectileSystem::Clear()
+{
+    posX.clear(); posY.clear();
+    oldX.clear(); oldY.clear();
+    altOldX.clear(); altOldY.clear();
+    forceX.clear(); forceY.clear();
+    oneOverMass.clear(); radius.clear();
+    hitPower.clear();
+    life.clear();
+    owner.clear();
+    dead.clear();
+    hitBody.clear(); hitParam.clear();
+    hitPoint.clear(); hitNormal.clear();
+}
+
+// every projectile is stepped on its own, batches run on the job threads
+#define INTEGRATE_GRAIN 256
+
+void CProjectileSystem::Integrate()
+{
+    fGravity = WORLD.GetPhysics()->dGravity;
+    JOBS.ParallelFor( "Projectiles integrate", IntegrateJob, this, posX.size(), INTEGRATE_GRAIN );
+}
+
+void CProjectileSystem::IntegrateJob( void* data, u32 begin, u32 end )
+{
+    CProjectileSystem* ps = ( CProjectileSystem* )data;
+    f32 gravity = ps->fGravity;
+    f32 damping = ps->fDamping;
+    f32 posFactor = 1.0f + damping;
+
+    f32* px = &ps->posX[0];
+    f32* py = &ps->posY[0];
+    f32* ox = &ps->oldX[0];
+    f32* oy = &ps->oldY[0];
+    f32* ax = &ps->altOldX[0];
+    f32* ay = &ps->altOldY[0];
+    f32* fx = &ps->forceX[0];
+    f32* fy = &ps->forceY[0];
+    f32* im = &ps->oneOverMass[0];
+    s32* lf = &ps->life[0];
+    u8* dd = &ps->dead[0];
+
+    // Verlet integration, same as CPhys_Part::Think but over all projectiles at once
+    // and without branches so the compiler can vectorize it
+    for ( u32 i = begin; i < end; i++ )
+    {
+      f32 nx = px[i] * posFactor - ox[i] * damping + fx[i] * im[i];
+      f32 ny = py[i] * posFactor - oy[i] * damping + ( fy[i] + gravity ) * im[i];
+      ox[i] = ax[i] = px[i];
+      oy[i] = ay[i] = py[i];
+      px[i] = nx;
+      py[i] = ny;
+      fx[i] = fy[i] = 0.0f;
+    }
+
+    // lifetime, a negative life never runs out
+    for ( u32 i = begin; i < end; i++ )
+    {
+      s32 ticking = ( lf[i] > 0 );
+      lf[i] -= ticking;
+      dd[i] |= ( u8 )( ticking & ( lf[i] == 0 ) );
+    }
+}
+
+void CProjectileSystem::CastRays()
+{
+    u32 n = posX.size();
+
+    hitBody.set_used( n );
+    hitParam.set_used( n );
+    hitPoint.set_used( n );
+    hitNormal.set_used( n );
+
+    u32 i, j;
+
+    // shots of lagged players wait for the world to be rewound
+    lagOwners.set_used( 0 );
+    for ( i = 0; i < n; i++ )
+    {
+      hitBody[i] = NULL;
+      hitParam[i] = 999999.0f;
+      if ( LAGCOMP->getViewDelay( owner[i] ) )
+      {
+        if ( lagOwners.linear_search( owner[i] ) < 0 )
+        {
+          lagOwners.push_back( owner[i] );
+        }
+        continue;
+      }
+      CastRay( i );
+    }
+
+    // one rewind per owner, around all of its shots
+    for ( j = 0; j < lagOwners.size(); j++ )
+    {
+      aabbox3df area;
+      bool bFirst = true;
+      for ( i = 0; i < n; i++ )
+      {
+        if ( owner[i] == lagOwners[j] )
+        {
+          if ( bFirst )
+          {
+            area.reset( oldX[i], oldY[i], 0.0f );
+            bFirst = false;
+          }
+          area.addInternalPoint( oldX[i], oldY[i], 0.0f );
+          area.addInternalPoint( posX[i], posY[i], 0.0f );
+        }
+      }
+
+      LAGCOMP->Rewind( lagOwners[j], area );
+      for ( i = 0; i < n; i++ )
+      {
+        if ( owner[i] == lagOwners[j] )
+        {
+          CastRay( i );
+        }
+      }
+      LAGCOMP->Restore();
+    }
+}
+
+void CProjectileSystem::CastRay( u32 i )
+{
+    castIndex = i;
+    vCastStart = vector3df( oldX[i], oldY[i], 0.0f );
+    vCastEnd = vector3df( posX[i], posY[i], 0.0f );
+    NewtonWorldRayCast( WORLD.GetPhysics()->nWorld, &vCastStart.X, &vCastEnd.X, CProjectileSystem::RayCastFilter, this );
+}
+
+dFloat CProjectileSystem::RayCastFilter( const NewtonBody* body, const dFloat* normal, int collisionID, void* userData, dFloat intersetParam )
+{
+    CProjectileSystem* ps = ( CProjectileSystem* )userData;
+    u32 i = ps->castIndex;
+    if ( intersetParam < ps->hitParam[i] )
+    {
+      ps->hitParam[i] = intersetParam;
+      ps->hitBody[i] = ( NewtonBody * )body;
+      ps->hitPoint[i] = ps->vCastStart + ( ps->vCastEnd - ps->vCastStart ) * intersetParam;
+      memcpy( &ps->hitNormal[i].X, normal, sizeof( f32 ) * 3 );
+    }
+
+    return intersetParam;
+}
+
+void CProjectileSystem::ResolveHits()
+{
+    // only the projectiles that were ray cast, hit callbacks may spawn new ones
+    u32 n = hitBody.size();
+
+    for ( u32 i = 0; i < n; i++ )
+    {
+      if ( !hitBody[i] )
+      {
+        continue;
+      }
+
+      // bounce off the surface
+      vector3df vVelocity( posX[i] - oldX[i], posY[i] - oldY[i], 0.0f );
+      vector3df vN = vVelocity;
+      vN.normalize();
+      vector3df vReflect = hitNormal[i] * ( -vN.dotProduct( hitNormal[i] ) ) * 2 + vN;
+      //R= 2*(-I dot N)*N + I
+
+      vector3df vPos = hitPoint[i] + vReflect * 0.0001f;
+      vector3df vOld = vPos - vReflect * vVelocity.getLength() * PROJECTILE_ELASTICITY;
+      altOldX[i] = oldX[i]; altOldY[i] = oldY[i];
+      posX[i] = vPos.X; posY[i] = vPos.Y;
+      oldX[i] = vOld.X; oldY[i] = vOld.Y;
+
+      f32 fImpactMass = PROJECTILE_MAX_IMPACT_MASS;
+      if ( oneOverMass[i] * PROJECTILE_MAX_IMPACT_MASS > 1.0f )
+      {
+        fImpactMass = 1 / oneOverMass[i];
+      }
+
+      dFloat mass;
+      dFloat Ixx;
+      dFloat Iyy;
+      dFloat Izz;
+      NewtonBodyGetMassMatrix( hitBody[i], &mass, &Ixx, &Iyy, &Izz );
+
+      if ( mass != 0.0f )
+      {
+        CNewtonNode* newtonNode = ( CNewtonNode * )NewtonBodyGetUserData( hitBody[i] );
+        if ( newtonNode )
+        {
+          OnHitNewtonNode( i, newtonNode, vVelocity, fImpactMass );
+        }
+
+        vector3df vImpulse = vVelocity* fImpactMass* fImpactMass* fImpactMass * 0.00001f;
+        vector3df vHitPos( posX[i], posY[i], 0.0f );
+        NewtonAddBodyImpulse( hitBody[i], &vImpulse.X, &vHitPos.X );
+      }
+      else
+      {
+        OnHitLevel( i, vVelocity, fImpactMass );
+      }
+    }
+}
+
+void CProjectileSystem::CheckZones()
+{
+    CMap* map = WORLD.GetMap();
+    if ( !map )
+    {
+      return;
+    }
+
+    u32 n = posX.size();
+    vector3df vIntersection;
+
+    for ( u32 i = 0; i < n; i++ )
+    {
+      vector3df vFrom( altOldX[i], altOldY[i], 0.0f );
+      vector3df vTo( posX[i], posY[i], 0.0f );
+
+      aabbox3df segment( vFrom );
+      segment.addInternalPoint( vTo );
+      zoneHits.set_used( 0 );
+      map->GetZonesTouching( segment, zoneHits );
+
+      for ( u32 z = 0; z < zoneHits.size(); z++ )
+      {
+        if ( map->GetZone( zoneHits[z] )->getSurface().getIntersectionWithLimitedLine( vFrom, vTo, vIntersection ) )
+        {
+          // create water splash effect
+          EFFECTS->Spawn( gunSplashEffect, vIntersection, vIntersection, 0.00001f, 5.0f * radius[i], 30 );
+          EFFECTS->Spawn( surfaceSplashEffect, vIntersection, vIntersection, 0.0f, radius[i] * 0.3f, 60 );
+          EFFECTS->Spawn( waterCircleEffect, vIntersection, vIntersection, 0.0f, radius[i] * 0.02f, 100 );
+          MakeBubbles( i, vIntersection );
+          SOUND.playSound( "Sounds/bullet_water4.wav", vIntersection, vIntersection, 1.0f, 1.0f, SOUND_PRIORITY_LOW );
+        }
+      }
+    }
+}
+
+void CProjectileSystem::SpawnEffects()
+{
+    u32 n = posX.size();
+
+    for ( u32 i = 0; i < n; i++ )
+    {
+      EFFECTS->Spawn( beamEffect, vector3df( altOldX[i], altOldY[i], 0.0f ), vector3df( posX[i], posY[i], 0.0f ), 0.0f, radius[i], 5 );
+    }
+}
+
+void CProjectileSystem::RemoveDead()
+{
+    for ( s32 i = posX.size() - 1; i >= 0; i-- )
+    {
+      if ( dead[i] )
+      {
+        Remove( i );
+      }
+    }
+}
+
+void CProjectileSystem::Remove( u32 i )
+{
+    u32 last = posX.size() - 1;
+    if ( i != last )
+    {
+      posX[i] = posX[last]; posY[i] = posY[last];
+      oldX[i] = oldX[last]; oldY[i] = oldY[last];
+      altOldX[i] = altOldX[last]; altOldY[i] = altOldY[last];
+      forceX[i] = forceX[last]; forceY[i] = forceY[last];
+      oneOverMass[i] = oneOverMass[last];
+      radius[i] = radius[last];
+      hitPower[i] = hitPower[last];
+      life[i] = life[last];
+      owner[i] = owner[last];
+      dead[i] = dead[last];
+    }
+
+    posX.set_used( last ); posY.set_used( last );
+    oldX.set_used( last ); oldY.set_used( last );
+    altOldX.set_used( last ); altOldY.set_used( last );
+    forceX.set_used( last ); forceY.set_used( last );
+    oneOverMass.set_used( last );
+    radius.set_used( last );
+    hitPower.set_used( last );
+    life.set_used( last );
+    owner.set_used( last );
+    dead.set_used( last );
+}
+
+void CProjectileSystem::OnHitLevel( u32 i, vector3df vImpactVel, f32 fImpactMass )
+{
+    dead[i] = 1;
+
+    vector3df vPos( posX[i], posY[i], 0.0f );
+    EFFECTS->Spawn( dustEffect, vPos, vPos, 0.5f, radius[i] * 8.0f, 80 );
+}
+
+void CProjectileSystem::OnHitNewtonNode( u32 i, CNewtonNode* hitnode, vector3df vImpactVel, f32 fImpactMass )
+{
+    dead[i] = 1;
+
+    vector3df vPos( posX[i], posY[i], 0.0f );
+
+    if ( ( hitnode->getType() == NODECLASS_MACHINE ) || ( hitnode->getType() == NODECLASS_CHARACTER ) )
+    {
+      CActor* actor = static_cast<CActor*>( hitnode );
+      actor->takeDamage( hitPower[i], owner[i] );
+    }
+
+    if ( hitnode->getType() == NODECLASS_MACHINE )
+    {
+      EFFECTS->Spawn( machineHitEffect, vPos, vPos, 0.0f, radius[i] * 12.5f, 30 );
+    }
+
+    if ( hitnode->getType() == NODECLASS_CHARACTER )
+    {
+      EFFECTS->Spawn( gunSplashEffect, vPos, vPos, 0.00001f, 5.0f * radius[i], 30 );
+    }
+
+    if ( hitnode->getType() == NODECLASS_PROP )
+    {
+      CProp* prop = static_cast<CProp*>( hitnode );
+
+      prop->fHealth -= hitPower[i];
+      if ( prop->fHealth <= 0.0f )
+      {
+        prop->BreakAtPoint( vPos, vImpactVel );
+      }
+
+      EFFECTS->Spawn( machineHitEffect, vPos, vPos, 0.0f, radius[i] * 12.5f, 30 );
+    }
+}
+
+void CProjectileSystem::MakeBubbles( u32 i, vector3df vIntersect )
+{
+    int amount = 2 + cosmeticRandom( 4 );
+    vector3df vel = ( vector3df( posX[i], posY[i], 0.0f ) - vIntersect ) / amount;
+    vector3df currPos = vIntersect;
+    vector3df randPos;
+    int rad = 2;
+
+    for ( int j = 0; j < amount; j++ )
+    {
+      currPos += vel;
+      randPos = vector3df( -rad + cosmeticRandom( 2 * rad ), -rad + cosmeticRandom( 2 * rad ), -rad + cosmeticRandom( 2 * rad ) ) / 10.0f;
+      EFFECTS->Spawn( bubbleEffect, currPos + randPos, currPos + randPos, -0.00004f, 2.0f * radius[i], 140 - j * 10 );
+    }
+}
+
+void CProjectileSystem::Render()
+{
+    if ( APP.DebugMode > 1 )
+    {
+      for ( u32 i = 0; i < posX.size(); i++ )
+      {
+        vector3df vPos( posX[i], posY[i], 0.0f );
+        IRR.video->draw3DLine( vPos - vector3df( POINT_DRAW, 0, 0 ), vPos + vector3df( POINT_DRAW, 0, 0 ), SColor( 0, 255, 0, 100 ) );
+        IRR.video->draw3DLine( vPos - vector3df( 0, POINT_DRAW, 0 ), vPos + vector3df( 0, POINT_DRAW, 0 ), SColor( 0, 255, 0, 100 ) );
+      }
+    }
+}
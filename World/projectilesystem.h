@@ -0,0 +1,89 @@
+#ifndef PROJECTILESYSTEM_H_INCLUDED
+#define PROJECTILESYSTEM_H_INCLUDED
+
+#include "../Engine/engine.h"
+
+#include "../Newton/newton_physics.h"
+#include "player.h"
+
+class CNewtonNode;
+
+////////////////////////////////////////////
+// CProjectileSystem
+// - all bullets in flight, stored as structure of arrays and stepped in
+//   phases: integrate, ray cast, resolve hits, water zones, effects, compact
+// - projectiles live in the XY plane, Z is always 0 like CPhys_Part
+////////////////////////////////////////////
+
+class CProjectileSystem
+{
+  public:
+    CProjectileSystem();
+    ~CProjectileSystem();
+
+    // returns the projectile index for this tick, indices change after Update()
+    s32 Spawn( vector3df vPos, vector3df vVelocity, PlayerID ownerPID, f32 oneOverMass, f32 radius, int aliveTime, f32 power );
+
+    void Update();
+    void Render();
+    void Clear();
+
+    u32 getCount()
+    {
+        return posX.size();
+    }
+
+  private:
+    void Integrate();
+    static void IntegrateJob( void* data, u32 begin, u32 end );
+    void CastRays();
+    void CastRay( u32 i );
+    void ResolveHits();
+    void CheckZones();
+    void SpawnEffects();
+    void RemoveDead();
+
+    void Remove( u32 i );
+
+    void OnHitLevel( u32 i, vector3df vImpactVel, f32 fImpactMass );
+    void OnHitNewtonNode( u32 i, CNewtonNode* hitnode, vector3df vImpactVel, f32 fImpactMass );
+    void MakeBubbles( u32 i, vector3df vIntersect );
+
+    static dFloat RayCastFilter( const NewtonBody* body, const dFloat* normal, int collisionID, void* userData, dFloat intersetParam );
+
+    // state
+    array<f32> posX, posY;
+    array<f32> oldX, oldY;
+    // position before this tick's integration, the beam and water check run from here
+    array<f32> altOldX, altOldY;
+    array<f32> forceX, forceY;
+    array<f32> oneOverMass, radius;
+    array<f32> hitPower;
+    array<s32> life;
+    array<PlayerID> owner;
+    array<u8> dead;
+
+    // ray cast results, filled by CastRays() and consumed by ResolveHits()
+    array<NewtonBody*> hitBody;
+    array<f32> hitParam;
+    array<vector3df> hitPoint, hitNormal;
+
+    // zones touched by the projectile CheckZones() is looking at
+    array<s32> zoneHits;
+
+    // owners whose shots are cast against the past, see CLagCompensation
+    array<PlayerID> lagOwners;
+
+    // the ray currently being cast
+    u32 castIndex;
+    vector3df vCastStart, vCastEnd;
+
+    f32 fDamping;
+    f32 fGravity;
+
+    // effect types for EFFECTS->Spawn()
+    s32 beamEffect, dustEffect, bubbleEffect, machineHitEffect;
+    s32 gunSplashEffect, surfaceSplashEffect, waterCircleEffect;
+};
+
+#endif
@@ -54,10 +54,12 @@ void CProp::Think()
     CEntity::Think();
 
     // update the debug position
+#ifdef _CLIENT
     if ( APP.DebugMode )
     {
       setDebugPos( IRR.smgr->getSceneCollisionManager()->getScreenCoordinatesFrom3DPosition( getNodeCenter(), IRR.smgr->getActiveCamera() ) );
     }
+#endif
 }
 
 void CProp::Render()
@@ -14,8 +14,7 @@ CScriptWeapon::CScriptWeapon( const c8* scriptFilename )
 
     if ( scriptFilename != "" )
     {
-      Load( scriptFilename );
-      Unserialize( loadedBitStream );
+      LoadConfig( scriptFilename );
     }
 }
 
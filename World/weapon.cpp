@@ -1,6 +1,6 @@
 #include "weapon.h"
 
-#include "bullet.h"
+#include "projectilesystem.h"
 #include "character.h"
 
 // SOUND.
@@ -163,9 +163,8 @@ void CWeapon::FireBullet( vector3df NewPos, vector3df VelocityNormal, WeaponBull
       ownerID = UNASSIGNED_PLAYER_ID;
     }
 
-    CBullet* p = new CBullet( vPos, vVel, ownerID, 1 / bdata->fMass, bdata->fRadius, bdata->aliveTime, bdata->fHitPower );
+    WORLD.GetProjectiles()->Spawn( vPos, vVel, ownerID, 1 / bdata->fMass, bdata->fRadius, bdata->aliveTime, bdata->fHitPower );
 
-    p->beamTexture = bdata->textureName;
     //p->beam = new CBeamNode( IRR.smgr->getRootSceneNode( ), IRR.smgr, -1, bdata->textureName.c_str() ); 
     //p->beam->SetBeamScale( bdata->fRadius );
     //p->beam->SetBeamColorStart( bdata->beamColorStart ); 
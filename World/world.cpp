@@ -10,9 +10,17 @@
 #include "map.h"
 #include "controls.h"
 #include "respawn.h"
+#include "configcache.h"
 #include "../Effects/effect.h"
+#include "../Effects/effectpool.h"
 #include "player.h"
 #include "rules.h"
+#include "projectilesystem.h"
+#include "demo.h"
+#include "../RakNet/snapshot.h"
+#include "../RakNet/prediction.h"
+#include "../RakNet/lagsim.h"
+#include "../RakNet/lagcomp.h"
 
 #define ANGLE_DIVIDE 3
 //#define DEFAULT_CAMERA_FOV -PI / 1.09f
@@ -23,8 +31,6 @@
 #define DEFAULT_CAMERA_POSLAG 3.0f
 #define DEFAULT_CAMERA_TARGETLAG 5.0f
 
-#define STARTRULES "Scripts/rules_dogfight.gm"
-
 ////////////////////////////////////
 // CWorldTask                     //
 ////////////////////////////////////
@@ -32,10 +38,15 @@
 CWorldTask::CWorldTask()
 {
     newtonTask = new CNewton();
-    ADDTASK( newtonTask, 55, true );
+    // the world applies forces, physics steps with them
+    newtonTask->DependsOn( this );
+    // physics keeps its own fixed step and runs every frame to interpolate,
+    // Start() has the renderer wait for it
+    ADDTASK( newtonTask, 55, false );
     newtonTask->Stop();
 
     players = new CPlayerManager();
+    projectiles = new CProjectileSystem();
 
     CONSOLE_VAR( "w_camera_poslag", f32, fCamPosLag, 3.0f, L"w_camera_poslag [real]. Ex. w_camera_poslag 3.0f", L"Lag of camera position movement. Higher value - more lag." );
     CONSOLE_VAR( "w_camera_targetlag", f32, fCamTargetLag, 5.0f, L"w_camera_targetlag [real]. Ex. w_camera_targetlag 5.0f", L"Lag of camera target movement. Higher value - more lag." );
@@ -64,6 +75,8 @@ CWorldTask::~CWorldTask()
 {
     delete players;
     players = NULL;
+    delete projectiles;
+    projectiles = NULL;
 }
 
 bool CWorldTask::Start()
@@ -86,6 +99,10 @@ void CWorldTask::Update()
 
     int i;
 
+    // input goes in before anything thinks
+    PREDICTION->Update();
+    DEMO->BeginTick();
+
     for ( i = 0; i < Entitys.size(); i++ )
     {
       if ( Entitys[i]->ValidEntity() )
@@ -93,14 +110,20 @@ void CWorldTask::Update()
         Entitys[i]->Think();
       }
     }
+    projectiles->Update();
+
+    dyingEntitys.set_used( 0 );
     for ( i = 0; i < Entitys.size(); i++ )
     {
       if ( Entitys[i]->bCanDie )
       {
-        Entitys[i]->Die();
-        i = 0;
+        dyingEntitys.push_back( Entitys[i] );
       }
     }
+    for ( i = 0; i < dyingEntitys.size(); i++ )
+    {
+      dyingEntitys[i]->Die();
+    }
 
     //if ((KERNEL.GetTicks() % 30) == 0)
     //{
@@ -124,6 +147,12 @@ void CWorldTask::Update()
       rules->waveRespawnTime = waveRespawnTime;
       rules->playerRespawnTime = playerRespawnTime;
     }
+
+    // after everything moved this tick
+    LAGCOMP->Record();
+    SNAPSHOTS->Update();
+    LAGSIM->Update();
+    DEMO->EndTick();
 }
 
 void CWorldTask::Stop()
@@ -139,6 +168,16 @@ void CWorldTask::Stop()
       delete Entitys[i];
     }
     Entitys.clear();
+    // actors are gone, configs are read again in the next world
+    CONFIGS->Clear();
+    projectiles->Clear();
+    // pooled effects own scene nodes, free them before the scene is cleared
+    EFFECTS->Clear();
+    SNAPSHOTS->Clear();
+    PREDICTION->Clear();
+    LAGSIM->Clear();
+    LAGCOMP->Clear();
+    DEMO->Stop();
 
     delete camera;
     camera = NULL;
@@ -153,17 +192,27 @@ void CWorldTask::Stop()
     worldRender->Kill();
 }
 
-void CWorldTask::AddEntity( CEntity* e )
+SSlotHandle CWorldTask::AddEntity( CEntity* e )
 {
-    Entitys.push_back( e );
+    return Entitys.Add( e );
 }
 
 void CWorldTask::RemoveEntity( CEntity* e )
 {
-    Entitys.erase( Entitys.binary_search( e ) );
+    Entitys.Remove( e->entityHandle );
     delete e;
 }
 
+void CWorldTask::DetachEntity( CEntity* e )
+{
+    Entitys.Remove( e->entityHandle );
+}
+
+s32 CWorldTask::GetEntityIndex( CEntity* Entity )
+{
+    return Entitys.GetIndex( Entity->entityHandle );
+}
+
 ////////////////////////////////////
 // CWorldRender                   //
 ////////////////////////////////////
@@ -173,6 +222,7 @@ void CWorldRender::Render()
     //   if ( APP.DebugMode )
     {
         WORLD.GetPhysics()->Render();
+        WORLD.GetProjectiles()->Render();
 
         for ( int i = 0; i < WORLD.GetEntitysNum(); i++ )
         {
@@ -223,6 +273,8 @@ void CCamera::Reset()
     vOverride.Z = DEFAULT_CAMERA_OVERRIDEZ;
     vRealPos = vOverride;
     vRealTargetPos = vRealPos;
+    vOldPos = vRealPos;
+    vOldTargetPos = vRealTargetPos;
     fPosLag = DEFAULT_CAMERA_POSLAG;
     iOrtho = false;
     IrrCamera->setFOV( DEFAULT_CAMERA_FOV );
@@ -241,6 +293,7 @@ void CCamera::Think()
     vector3df vP, vT;
 
     vOldPos = vRealPos;
+    vOldTargetPos = vRealTargetPos;
 
     if ( !target )
     {
@@ -362,3 +415,14 @@ void CCamera::Think()
 
     //target = NULL;
 }
+
+void CCamera::Interpolate( f32 alpha )
+{
+    IrrCamera->setPosition( vOldPos + ( vRealPos - vOldPos ) * alpha );
+    IrrCamera->setTarget( vOldTargetPos + ( vRealTargetPos - vOldTargetPos ) * alpha );
+
+    if ( !APP.DebugMode )
+    {
+      IrrCamera->updateAbsolutePosition();
+    }
+}
@@ -3,6 +3,9 @@
 
 #include "../Engine/engine.h"
 
+// the rules every world starts with, demos keep their hash
+#define STARTRULES "Scripts/rules_dogfight.gm"
+
 class CNewton;
 class CWorldRender;
 class CMap;
@@ -19,6 +22,7 @@ class CPlayer;
 class CPlayerManager;
 struct PlayerID;
 class CRules;
+class CProjectileSystem;
 
 ////////////////////////////////////////////
 // CWorldTask 
@@ -57,6 +61,10 @@ class CWorldTask : public Singleton<CWorldTask>, public ITask
     {
         return rules;
     }
+    CProjectileSystem* GetProjectiles()
+    {
+        return projectiles;
+    }
 
     CEntity* GetEntity( s32 i )
     {
@@ -84,13 +92,18 @@ class CWorldTask : public Singleton<CWorldTask>, public ITask
           return true;
         }
     }
-    s32 GetEntityIndex( CEntity* Entity )
+    s32 GetEntityIndex( CEntity* Entity );
+    // NULL if the entity the handle pointed to is gone
+    CEntity* GetEntityByHandle( const SSlotHandle& h )
     {
-        return Entitys.binary_search( Entity );
+        CEntity** e = Entitys.Get( h );
+        return e ? *e : NULL;
     }
 
-    void AddEntity( CEntity* e );
+    SSlotHandle AddEntity( CEntity* e );
     void RemoveEntity( CEntity* e );
+    // removes without deleting
+    void DetachEntity( CEntity* e );
 
     f32 getDaySpeed()
     {
@@ -107,8 +120,11 @@ class CWorldTask : public Singleton<CWorldTask>, public ITask
     CCamera* camera;
     CPlayerManager* players;
     CRules* rules;
+    CProjectileSystem* projectiles;
 
-    array<CEntity*> Entitys;
+    CSlotMap<CEntity*> Entitys;
+    // entities that asked to die this tick, removed after all have thought
+    array<CEntity*> dyingEntitys;
 
     // TEMP?
     f32 fCamPosLag, fCamTargetLag, fCamDistance, fCamSpeedFactor, fCamMountFactor;
@@ -155,6 +171,8 @@ class CCamera// : public CEntity
 
     virtual void Reset();
     virtual void Think();
+    // places the Irrlicht camera between the last two Think() positions
+    void Interpolate( f32 alpha );
     virtual void Render()
     {
     }
@@ -196,7 +214,7 @@ class CCamera// : public CEntity
     matrix4 ProjMatrix;
 
     vector3df vRealPos, vRealTargetPos;
-    vector3df vOldPos;
+    vector3df vOldPos, vOldTargetPos;
     vector3df vSetPos, vSetTargetPos;
 
 	bool bSetCamera;
@@ -10,6 +10,7 @@
 
 #include "world.h"
 #include "map.h"
+#include "../Effects/effectpool.h"
 
 ////////////////////////////////////////////
 // CWorldPart 
@@ -82,21 +83,25 @@ void CWorldPart::Think()
 
       // map zones (water)
       vector3df vIntersection;
-      plane3d<f32> plane;
-      for ( int i = 0; i < WORLD.GetMap()->GetZonesNum(); i++ )
+      static array<s32> zones;
+      zones.set_used( 0 );
+      aabbox3df segment( AltOldPos );
+      segment.addInternalPoint( Pos );
+      WORLD.GetMap()->GetZonesTouching( segment, zones );
+      for ( u32 i = 0; i < zones.size(); i++ )
       {
-        static vector3df edges[8];
-        WORLD.GetMap()->GetZone( i )->getBox()->getEdges( edges );
-        plane.setPlane( edges[0], edges[2], edges[4] );
-        if ( plane.getIntersectionWithLimitedLine( AltOldPos, Pos, vIntersection ) )
+        if ( WORLD.GetMap()->GetZone( zones[i] )->getSurface().getIntersectionWithLimitedLine( AltOldPos, Pos, vIntersection ) )
         {
           // create water splash effect
           //                CSplashEffect *se = new CSplashEffect( vIntersection, 0.0005f, 1.33f*radius, 25 );
-          FACTORY->Effects.Create( "gunsplash", vIntersection, vIntersection, 0.00001f, 5.0f * radius, 30 );
-          FACTORY->Effects.Create( "surfacesplash", vIntersection, vIntersection, 0.0f, radius * 0.3f, 60 );
-          FACTORY->Effects.Create( "watercircle", vIntersection, vIntersection, 0.0f, radius * 0.02f, 100 );
+          static s32 gunSplashEffect = EFFECTS->GetType( "gunsplash" );
+          static s32 surfaceSplashEffect = EFFECTS->GetType( "surfacesplash" );
+          static s32 waterCircleEffect = EFFECTS->GetType( "watercircle" );
+          EFFECTS->Spawn( gunSplashEffect, vIntersection, vIntersection, 0.00001f, 5.0f * radius, 30 );
+          EFFECTS->Spawn( surfaceSplashEffect, vIntersection, vIntersection, 0.0f, radius * 0.3f, 60 );
+          EFFECTS->Spawn( waterCircleEffect, vIntersection, vIntersection, 0.0f, radius * 0.02f, 100 );
           MakeBubbles( vIntersection ); 
-          SOUND.playSound( "Sounds/bullet_water4.wav", vIntersection, vIntersection, 1.0f, 1.0f );
+          SOUND.playSound( "Sounds/bullet_water4.wav", vIntersection, vIntersection, 1.0f, 1.0f, SOUND_PRIORITY_LOW );
         }
       }
     }
@@ -148,16 +153,17 @@ void CWorldPart::ResolveRayCastCollision()
 
 void CWorldPart::MakeBubbles( vector3df vIntersect )
 {
-    int amount = 2 + random( 4 );
+    int amount = 2 + cosmeticRandom( 4 );
     vector3df vel = ( Pos - vIntersect ) / amount;
     vector3df currPos = vIntersect;
     vector3df randPos;
     int rad = 2;
+    static s32 bubbleEffect = EFFECTS->GetType( "bubble" );
 
     for ( int i = 0; i < amount; i++ )
     {
       currPos += vel;
-      randPos = vector3df( -rad + random( 2 * rad ), -rad + random( 2 * rad ), -rad + random( 2 * rad ) ) / 10.0f;
-      FACTORY->Effects.Create( "bubble", currPos + randPos, currPos + randPos, -0.00004f, 2.0f * radius, 140 - i * 10 );
+      randPos = vector3df( -rad + cosmeticRandom( 2 * rad ), -rad + cosmeticRandom( 2 * rad ), -rad + cosmeticRandom( 2 * rad ) ) / 10.0f;
+      EFFECTS->Spawn( bubbleEffect, currPos + randPos, currPos + randPos, -0.00004f, 2.0f * radius, 140 - i * 10 );
     }
 }
\ No newline at end of file